@@ -30,7 +30,7 @@ namespace Cosmos::command {
         GENERATE,         // generate a wallet
         RESTORE,          // restore a wallet
         ACCEPT,           // accept a payment
-        UPDATE,           // depricated: check if txs in pending have been mined.
+        UPDATE,           // depricated: the server checks whether pending txs have been mined in the background.
         VALUE,            // the value in the wallet.
         DETAILS,
         SEND,             // (depricated)
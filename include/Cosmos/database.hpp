@@ -5,6 +5,7 @@
 #include <Cosmos/database/price_data.hpp>
 #include <Cosmos/history.hpp>
 #include <Cosmos/options.hpp>
+#include <Cosmos/network/peers.hpp>
 
 #include <Diophant/symbol.hpp>
 
@@ -34,7 +35,7 @@ namespace Cosmos {
     std::ostream &operator << (std::ostream &, hash_function);
     std::istream &operator << (std::istream &, hash_function &);
 
-    struct controller : local_TXDB, local_price_data {
+    struct controller : local_TXDB, local_price_data, peer_store {
 
         virtual bool set_invert_hash (slice<const byte> digest, hash_function, slice<const byte> data) = 0;
         virtual maybe<tuple<hash_function, bytes>> get_invert_hash (slice<const byte>) = 0;
@@ -75,6 +76,11 @@ namespace Cosmos {
 
         virtual Cosmos::account get_wallet_account (const std::string &wallet_name) = 0;
 
+        // apply the changes that txs make to the outputs of a wallet, all at once.
+        // Throw account::cannot_apply_diff and change nothing if a diff removes
+        // an output that the wallet doesn't have.
+        virtual void update_wallet_account (const std::string &wallet_name, list<account_diff>) = 0;
+
     };
 
     bool inline supported (hash_function f) {
@@ -0,0 +1,127 @@
+#ifndef COSMOS_DATABASE_IMPORT
+#define COSMOS_DATABASE_IMPORT
+
+#include <map>
+#include <set>
+#include <vector>
+#include <gigamonkey/merkle/BUMP.hpp>
+#include <Cosmos/database/txdb.hpp>
+
+namespace Cosmos {
+
+    // read a BEEF (BRC-62 or BRC-96, optionally atomic) as its
+    // bytes arrive, without holding all of it in memory.
+    struct BEEF_stream {
+        struct tx {
+            Bitcoin::TxID TxID;
+
+            // empty if the BEEF gives only the txid.
+            maybe<Bitcoin::transaction> Transaction;
+
+            maybe<uint64> BUMPIndex;
+        };
+
+        using element = either<Merkle::BUMP, tx>;
+
+        BEEF_stream (): Buffer {}, Stage {stage::version}, Remaining {0} {}
+
+        // return everything that can be read with these bytes and those that came before.
+        // Throws if the bytes cannot be part of a BEEF.
+        list<element> feed (data::byte_slice);
+
+        // whether we have read a whole BEEF.
+        bool complete () const {
+            return Stage == stage::done;
+        }
+
+    private:
+        // bytes that we have not been able to read yet.
+        bytes Buffer;
+
+        enum class stage {
+            version,
+            BUMPs,
+            txs,
+            done
+        } Stage;
+
+        uint32 Version;
+
+        // number of BUMPs or txs left to read.
+        uint64 Remaining;
+    };
+
+    // check the txs of a BEEF and put those that are good in the database.
+    // BUMPs are checked against our headers, scripts of unmined txs are
+    // checked on the script pool, and txs are inserted in batches.
+    struct BEEF_importer {
+        struct options {
+            // number of txs to check and insert at once.
+            uint32 BatchSize {500};
+        };
+
+        struct result {
+            // in the order in which they appear in the BEEF.
+            list<Bitcoin::TxID> Accepted {};
+
+            // txs that were in the database already.
+            list<Bitcoin::TxID> Known {};
+
+            // with the reason why.
+            map<Bitcoin::TxID, std::string> Rejected {};
+
+            explicit operator JSON () const;
+        };
+
+        // headers may be a cached_remote_TXDB so that we can get headers we don't have.
+        BEEF_importer (local_TXDB &local, SPV::database &headers, const options &);
+
+        BEEF_importer (local_TXDB &local, SPV::database &headers):
+            BEEF_importer {local, headers, options {}} {}
+
+        // throws if the bytes are not a valid BEEF.
+        void feed (data::byte_slice);
+
+        // check and insert whatever is left. Throws if the BEEF is incomplete.
+        result finish ();
+
+    private:
+        local_TXDB &Local;
+        SPV::database &Headers;
+        options Options;
+
+        BEEF_stream Stream;
+
+        // the paths and root of each BUMP in order, or
+        // nothing for those that did not check out.
+        std::vector<maybe<Merkle::dual>> BUMPs;
+
+        struct pending {
+            Bitcoin::TxID TxID;
+            ptr<const Bitcoin::transaction> Transaction;
+
+            // mined txs come with a proof and don't need their scripts checked.
+            maybe<Merkle::proof> Proof;
+        };
+
+        // txs that have been read but not yet checked, in order.
+        std::vector<pending> Pending;
+
+        // the txs in Pending by txid so that children can find their inputs.
+        std::map<Bitcoin::TxID, ptr<const Bitcoin::transaction>> Batch;
+
+        std::set<Bitcoin::TxID> Seen;
+
+        result Result;
+
+        void accept (const Merkle::BUMP &);
+        void accept (const BEEF_stream::tx &);
+        void reject (const Bitcoin::TxID &, const std::string &why);
+
+        // check everything in Pending and insert what is good.
+        void flush ();
+    };
+
+}
+
+#endif
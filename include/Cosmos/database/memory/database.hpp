@@ -1,6 +1,7 @@
 #ifndef COSMOS_DATABASE_MEMORY_DATABASE
 #define COSMOS_DATABASE_MEMORY_DATABASE
 
+#include <set>
 #include <Cosmos/database.hpp>
 
 namespace Cosmos {
@@ -20,6 +21,19 @@ namespace Cosmos {
         void add_output (const digest256 &, const Bitcoin::outpoint &) final override;
         void set_redeem (const Bitcoin::outpoint &, const inpoint &) final override;
 
+        void set_broadcast_status (const Bitcoin::TxID &, const JSON &) final override;
+        maybe<JSON> get_broadcast_status (const Bitcoin::TxID &) final override;
+
+        void set_watermark (const std::string &, const watermark &) final override;
+        maybe<watermark> get_watermark (const std::string &) final override;
+
+        bool validated (const Bitcoin::TxID &) final override;
+        void set_validated (const Bitcoin::TxID &) final override;
+
+        uint64 queue_outgoing (const outgoing &) final override;
+        list<entry<uint64, outgoing>> get_outgoing () final override;
+        void remove_outgoing (uint64) final override;
+
         // NOTE: if a tx is ever dropped from the mempool (which shouldn't really happen)
         // Some information about it will not be dropped from these indices. Too bad but
         // it's not worth fixing. The in-memory database is just scaffolding.
@@ -27,6 +41,10 @@ namespace Cosmos {
         std::map<digest256, list<Bitcoin::outpoint>> ScriptIndex {};
         std::map<Bitcoin::outpoint, inpoint> RedeemIndex {};
         std::map<Bitcoin::timestamp, double> Price;
+        std::map<Bitcoin::TxID, JSON> BroadcastStatus;
+        std::map<std::string, watermark> Watermarks;
+        std::map<uint64, outgoing> Outbox;
+        std::set<Bitcoin::TxID> Validated;
 
         virtual ~memory_local_TXDB () {}
     };
@@ -37,6 +55,50 @@ namespace Cosmos {
     void inline memory_local_TXDB::set_redeem (const Bitcoin::outpoint &op, const inpoint &ip) {
         RedeemIndex[op] = ip;
     }
+
+    void inline memory_local_TXDB::set_broadcast_status (const Bitcoin::TxID &txid, const JSON &status) {
+        BroadcastStatus[txid] = status;
+    }
+
+    maybe<JSON> inline memory_local_TXDB::get_broadcast_status (const Bitcoin::TxID &txid) {
+        auto x = BroadcastStatus.find (txid);
+        if (x == BroadcastStatus.end ()) return {};
+        return x->second;
+    }
+
+    void inline memory_local_TXDB::set_watermark (const std::string &key, const watermark &w) {
+        Watermarks[key] = w;
+    }
+
+    maybe<watermark> inline memory_local_TXDB::get_watermark (const std::string &key) {
+        auto x = Watermarks.find (key);
+        if (x == Watermarks.end ()) return {};
+        return x->second;
+    }
+
+    bool inline memory_local_TXDB::validated (const Bitcoin::TxID &txid) {
+        return Validated.contains (txid);
+    }
+
+    void inline memory_local_TXDB::set_validated (const Bitcoin::TxID &txid) {
+        Validated.insert (txid);
+    }
+
+    uint64 inline memory_local_TXDB::queue_outgoing (const outgoing &o) {
+        uint64 id = Outbox.empty () ? 1 : Outbox.rbegin ()->first + 1;
+        Outbox[id] = o;
+        return id;
+    }
+
+    list<entry<uint64, outgoing>> inline memory_local_TXDB::get_outgoing () {
+        list<entry<uint64, outgoing>> x;
+        for (const auto &[id, o] : Outbox) x <<= entry<uint64, outgoing> {id, o};
+        return x;
+    }
+
+    void inline memory_local_TXDB::remove_outgoing (uint64 id) {
+        Outbox.erase (id);
+    }
 }
 
 #endif
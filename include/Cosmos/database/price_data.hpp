@@ -14,6 +14,13 @@ namespace Cosmos {
 
     struct local_price_data : price_data {
         virtual void set_price (monetary_unit, const Bitcoin::timestamp &t, double) = 0;
+
+        // record many prices at once. Databases can override
+        // this to write everything in a single transaction.
+        virtual void set_prices (monetary_unit u, map<Bitcoin::timestamp, double> prices) {
+            for (const auto &[t, p] : prices) set_price (u, t, p);
+        }
+
         virtual ~local_price_data () {}
     };
 
@@ -30,6 +37,23 @@ namespace Cosmos {
         cached_remote_price_data (ptr<price_data> n, local_price_data &l) : Remote {n}, Local {l} {}
     };
 
+    // fetch prices from the network without blocking the thread and
+    // save them locally. Use this inside coroutines instead of
+    // cached_remote_price_data.
+    struct price_service {
+        network &Net;
+        local_price_data &Local;
+
+        price_service (network &n, local_price_data &l) : Net {n}, Local {l} {}
+
+        awaitable<maybe<double>> get_price (monetary_unit, const Bitcoin::timestamp &t);
+
+        // fetch all days in the range that we do not already know
+        // in one request and save them all at once. Return the
+        // number of days that were added.
+        awaitable<uint32> prefetch (monetary_unit, const Bitcoin::timestamp &from, const Bitcoin::timestamp &to);
+    };
+
     // we ask the user for price data.
     struct ask_for_price_data final : price_data {
         ask_for_price_data () {}
@@ -0,0 +1,44 @@
+#ifndef COSMOS_DATABASE_PROOF
+#define COSMOS_DATABASE_PROOF
+
+#include <map>
+#include <set>
+#include <Cosmos/database/txdb.hpp>
+
+namespace Cosmos {
+
+    // build SPV proofs and BEEFs for txs that we send. The proof tree under
+    // each tx is kept, so a chain of payments only looks up each ancestor
+    // once, and the raw bytes of each tx are kept so that they don't need
+    // to be encoded again.
+    struct proof_builder {
+        TXDB &DB;
+
+        // we start over when we have this many txs.
+        uint32 MaxCached;
+
+        proof_builder (TXDB &db, uint32 max_cached = 10000): DB {db}, MaxCached {max_cached} {}
+
+        // nothing if some ancestor is missing. Txs in the payment may spend each other.
+        maybe<SPV::proof> operator () (list<Bitcoin::transaction> payment);
+
+        // BRC-62 with one BUMP for each block. Nothing if some ancestor is missing.
+        maybe<bytes> BEEF (list<Bitcoin::transaction> payment);
+        bytes BEEF (const SPV::proof &);
+
+        // call when the proof of a tx may have changed, as when it is mined.
+        // Cached txs that spend it are forgotten as well.
+        void forget (const Bitcoin::TxID &);
+
+    private:
+        std::map<Bitcoin::TxID, ptr<SPV::proof::node>> Nodes;
+        std::map<Bitcoin::TxID, bytes> Raw;
+
+        ptr<SPV::proof::node> node (const Bitcoin::TxID &);
+        maybe<SPV::proof::map> parents (const Bitcoin::transaction &, const std::set<Bitcoin::TxID> &skip);
+        const bytes &raw (const Bitcoin::TxID &, const Bitcoin::transaction &);
+    };
+
+}
+
+#endif
@@ -1,9 +1,13 @@
 #ifndef COSMOS_DATABASE_TXDB
 #define COSMOS_DATABASE_TXDB
 
+#include <span>
+#include <map>
+#include <chrono>
 #include <gigamonkey/SPV.hpp>
 #include <Cosmos/database/write.hpp>
 #include <Cosmos/network.hpp>
+#include <Cosmos/network/broadcast.hpp>
 
 namespace Bitcoin = Gigamonkey::Bitcoin;
 namespace Merkle = Gigamonkey::Merkle;
@@ -99,6 +103,8 @@ namespace Cosmos {
 
     using events = data::ordered_sequence<event>;
 
+    struct proof_builder;
+
     // a database of transactions.
     // we add to the SVP database by enabling
     // the retrievable of transactions as needed
@@ -114,6 +120,10 @@ namespace Cosmos {
         virtual events by_script_hash (const digest256 &) = 0;
         virtual event redeeming (const Bitcoin::outpoint &) = 0;
 
+        // called before we generate a proof for a payment so that
+        // implementations can load its ancestors ahead of time.
+        virtual void prefetch_ancestors (list<Bitcoin::transaction> payment) {}
+
         Bitcoin::output output (const Bitcoin::outpoint &p) {
             auto tx = this->transaction (p.Digest);
             if (!tx.valid ()) return {};
@@ -124,16 +134,90 @@ namespace Cosmos {
             return output (p).Value;
         }
 
+        // the tx as it is stored. Databases that keep the
+        // raw bytes can return them without decoding.
+        virtual maybe<bytes> raw_transaction (const Bitcoin::TxID &id) {
+            auto tx = this->transaction (id);
+            if (!tx.valid ()) return {};
+            return bytes (*tx.Transaction);
+        }
+
+        // proofs that we generate are kept here so that they can be reused.
+        proof_builder &proofs ();
+
         virtual ~TXDB () {}
 
+    private:
+        ptr<proof_builder> Proofs;
+    };
+
+    // how far we have synced the history of an address or script hash.
+    struct watermark {
+        // every tx in the history that was confirmed below this height is in the database.
+        uint64 Height;
+        // the last time we looked at the mempool.
+        Bitcoin::timestamp MempoolChecked;
+    };
+
+    std::string inline watermark_key (const Bitcoin::address &a) {
+        return "address:" + std::string (a);
+    }
+
+    std::string inline watermark_key (const digest256 &script_hash) {
+        return "script:" + write (script_hash);
+    }
+
+    // txs that could not be broadcast, waiting to be tried again.
+    struct outgoing {
+        // in the order in which they must be broadcast, parents first.
+        list<extended_transaction> Txs;
+
+        // whatever we need to undo the payment if it is rejected, such as
+        // account diffs that were applied when it was queued.
+        JSON Note;
     };
 
+    JSON write (const outgoing &);
+    outgoing read_outgoing (const JSON &);
+
     struct  local_TXDB : public virtual SPV::writable, public TXDB {
         // Check proof before entering it into the database.
         bool import_transaction (const Bitcoin::transaction &, const Merkle::path &, const Bitcoin::header &h);
+
+        // insert txs that have already been checked, along with their outputs.
+        // Mined txs come with a proof whose root is in a header we have.
+        // Implementations may do this all at once.
+        virtual void import_transactions (list<std::pair<Bitcoin::transaction, maybe<Merkle::proof>>>);
+
+        // insert many proofs at once. Proofs with the same root are
+        // merged together so that each block's tree is written once.
+        // Return the txids whose proofs could not be inserted.
+        virtual list<Bitcoin::TxID> insert_proofs (std::span<const Merkle::proof>);
+
         virtual void add_address (const Bitcoin::address &, const digest256 &script_hash) = 0;
 
+        // the last status that ARC returned for a tx we broadcast.
+        virtual void set_broadcast_status (const Bitcoin::TxID &, const JSON &) = 0;
+        virtual maybe<JSON> get_broadcast_status (const Bitcoin::TxID &) = 0;
+
+        // keys are given by watermark_key.
+        virtual void set_watermark (const std::string &, const watermark &) = 0;
+        virtual maybe<watermark> get_watermark (const std::string &) = 0;
+
+        // txs whose scripts, and those of all their unconfirmed
+        // ancestors, have been checked and found to be good.
+        virtual bool validated (const Bitcoin::TxID &) = 0;
+        virtual void set_validated (const Bitcoin::TxID &) = 0;
+
+        // the outbox. Entries are returned in the order in which they were queued.
+        virtual uint64 queue_outgoing (const outgoing &) = 0;
+        virtual list<entry<uint64, outgoing>> get_outgoing () = 0;
+        virtual void remove_outgoing (uint64) = 0;
+
     private:
+        // add the outputs and redemptions of a tx that we have just inserted.
+        void index (const Bitcoin::transaction &);
+
         virtual digest256 add_script (const data::bytes &) = 0;
         // associate a script with a given hash with an output.
         virtual void add_output (const digest256 &, const Bitcoin::outpoint &) = 0;
@@ -142,6 +226,12 @@ namespace Cosmos {
         virtual ~local_TXDB () {}
     };
 
+    // put a payment in the outbox without trying to broadcast it, as when we
+    // are offline. Its unconfirmed txs are saved so that they are there when
+    // we generate proofs for later payments. Return nothing if the proof is
+    // invalid or a confirmed ancestor could not be imported.
+    maybe<uint64> queue_outgoing (local_TXDB &, const SPV::proof &, const JSON &note);
+
     // Since we might end up trying to broadcast multiple txs at once
     // all coming from a single proof, we have a way of collecting all
     // results that come up for all broadcasts so that we can handle
@@ -159,7 +249,36 @@ namespace Cosmos {
         network &Net;
         local_TXDB &Local;
 
-        cached_remote_TXDB (network &n, local_TXDB &x): TXDB {}, Net {n}, Local {x} {}
+        // how many blocks back to look again when we sync
+        // history, in case there has been a reorg.
+        uint32 ReorgDepth;
+
+        // how many txs to download at once when we prefetch ancestors.
+        uint32 MaxParallelImports;
+
+        // how many seconds since the last sync before by_address and
+        // by_script_hash go to the network again. Unconfirmed txs that
+        // were prefetched are checked again after this long too.
+        uint32 MaxHistoryAge;
+
+        // the priority of our calls to the network. Each cached_remote_TXDB
+        // is its own flow, so calls from different ones take turns.
+        priority Priority;
+
+        // everything we broadcast goes through here. Views of the same
+        // database with different priorities should share one.
+        ptr<broadcast_queue> Broadcasts;
+
+        cached_remote_TXDB (network &n, local_TXDB &x, uint32 reorg_depth = 6,
+            uint32 max_parallel_imports = 16, priority p = priority::interactive, uint32 max_history_age = 600,
+            ptr<broadcast_queue> broadcasts = nullptr):
+            TXDB {}, Net {n}, Local {x}, ReorgDepth {reorg_depth},
+            MaxParallelImports {max_parallel_imports}, MaxHistoryAge {max_history_age}, Priority {p},
+            Broadcasts {broadcasts != nullptr ? broadcasts : std::make_shared<broadcast_queue> (n)} {}
+
+        uint64 flow () const {
+            return static_cast<uint64> (reinterpret_cast<std::uintptr_t> (this));
+        }
 
         ptr<const entry<N, Bitcoin::header>> header (const N &) final override;
 
@@ -177,9 +296,48 @@ namespace Cosmos {
         events by_script_hash (const digest256 &) final override;
         event redeeming (const Bitcoin::outpoint &) final override;
 
+        void prefetch_ancestors (list<Bitcoin::transaction> payment) final override;
+
+        maybe<bytes> raw_transaction (const Bitcoin::TxID &) final override;
+
         awaitable<bool> import_transaction (const Bitcoin::TxID &);
 
-        awaitable<broadcast_tree_result> broadcast (SPV::proof);
+        // a proof that has been checked against a header.
+        awaitable<maybe<merkle_proof>> get_merkle_proof (Bitcoin::TxID);
+
+        // discover the unconfirmed ancestors of a payment breadth first and
+        // import each generation concurrently. Txs in the payment itself are
+        // not looked up. Return the number of txs imported.
+        awaitable<uint32> prefetch (list<Bitcoin::transaction> payment);
+
+        // bring the history of an address or script hash up to date. Only
+        // history after the last sync is downloaded and txs that we already
+        // have are skipped. Return the number of txs imported.
+        awaitable<uint32> sync (const Bitcoin::address &);
+        awaitable<uint32> sync (const digest256 &script_hash);
+
+        // the unconfirmed txs of the proof go out through Broadcasts. If we cannot
+        // connect and a note is provided, the txs are put in the outbox with the
+        // note and the result is QUEUED.
+        awaitable<broadcast_tree_result> broadcast (SPV::proof, maybe<JSON> queue_note = {});
+
+        // import the confirmed ancestors of a proof and list the unconfirmed
+        // txs in the order in which they must be broadcast, parents first.
+        // Return nothing if a confirmed ancestor could not be imported.
+        maybe<list<extended_transaction>> broadcast_order (const SPV::proof &);
+
+        // match each ARC status to its tx by txid. Txs that were accepted, seen or
+        // mined are saved along with their statuses. The rest are given as rejected.
+        // If the call failed, txs without a status are given the call's error.
+        map<Bitcoin::TxID, broadcast_single_result> record_broadcast (list<extended_transaction>, const broadcast_multiple_result &);
+
+    private:
+        // unconfirmed txs that were checked during a prefetch and when, so
+        // that we don't look them up again while generating proofs.
+        std::map<Bitcoin::TxID, std::chrono::steady_clock::time_point> Prefetched;
+
+        // whether an unconfirmed tx was checked less than MaxHistoryAge ago.
+        bool prefetched (const Bitcoin::TxID &);
     };
 
     set<Bitcoin::TxID> inline cached_remote_TXDB::unconfirmed () {
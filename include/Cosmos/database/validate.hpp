@@ -0,0 +1,49 @@
+#ifndef COSMOS_DATABASE_VALIDATE
+#define COSMOS_DATABASE_VALIDATE
+
+#include <set>
+#include <vector>
+#include <boost/asio/thread_pool.hpp>
+#include <Cosmos/database/txdb.hpp>
+
+namespace Cosmos {
+
+    // threads shared by everything that runs scripts.
+    boost::asio::thread_pool &script_pool ();
+
+    // run the scripts of every input of every tx at once on the script pool.
+    // Return whether all the scripts of each tx are good, in order.
+    std::vector<bool> check_scripts (const std::vector<extended_transaction> &);
+
+    // check merkle proofs and scripts. Txs whose scripts have passed are
+    // remembered in the database so that we don't run them again.
+    struct validator {
+        SPV::database &DB;
+
+        // where we remember which txs have passed. May be null.
+        local_TXDB *Cache;
+
+        // the cache is found from the database if there is one.
+        validator (SPV::database &db);
+        validator (SPV::database &db, local_TXDB *cache): DB {db}, Cache {cache} {}
+
+        bool operator () (const SPV::proof &);
+        bool operator () (const Bitcoin::TxID &, const extended_transaction &, const SPV::proof::tree &);
+
+    private:
+        // txs whose scripts we have not yet checked.
+        std::vector<extended_transaction> Unchecked;
+        std::vector<Bitcoin::TxID> UncheckedIDs;
+        std::set<Bitcoin::TxID> Seen;
+
+        // check merkle proofs and collect unconfirmed txs.
+        bool collect (const SPV::proof::map &);
+        bool collect (const Bitcoin::TxID &, const extended_transaction &);
+
+        // check everything in Unchecked and remember what passes.
+        bool check ();
+    };
+
+}
+
+#endif
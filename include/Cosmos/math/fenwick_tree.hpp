@@ -0,0 +1,74 @@
+#ifndef COSMOS_MATH_FENWICK_TREE
+#define COSMOS_MATH_FENWICK_TREE
+
+#include <vector>
+#include <cstddef>
+
+namespace math {
+
+    // prefix sums over a sequence that can be updated in O(log n).
+    template <typename X> struct fenwick_tree {
+
+        fenwick_tree (): Tree (1, X {0}) {}
+
+        // build in O(n).
+        explicit fenwick_tree (const std::vector<X> &);
+
+        size_t size () const {
+            return Tree.size () - 1;
+        }
+
+        void add (size_t i, X x);
+
+        // sum of the first i elements.
+        X prefix (size_t i) const;
+
+        // sum of elements in [begin, end).
+        X sum (size_t begin, size_t end) const {
+            return end <= begin ? X {0} : prefix (end) - prefix (begin);
+        }
+
+        // the smallest i such that prefix (i + 1) > x, or size () if there is none.
+        // All elements must be non-negative.
+        size_t find (X x) const;
+
+    private:
+        // 1-indexed.
+        std::vector<X> Tree;
+    };
+
+    template <typename X> fenwick_tree<X>::fenwick_tree (const std::vector<X> &x): Tree (x.size () + 1, X {0}) {
+        for (size_t i = 1; i < Tree.size (); i++) {
+            Tree[i] += x[i - 1];
+            size_t parent = i + (i & -i);
+            if (parent < Tree.size ()) Tree[parent] += Tree[i];
+        }
+    }
+
+    template <typename X> void inline fenwick_tree<X>::add (size_t i, X x) {
+        for (i++; i < Tree.size (); i += i & -i) Tree[i] += x;
+    }
+
+    template <typename X> X inline fenwick_tree<X>::prefix (size_t i) const {
+        X x {0};
+        for (; i > 0; i -= i & -i) x += Tree[i];
+        return x;
+    }
+
+    template <typename X> size_t fenwick_tree<X>::find (X x) const {
+        size_t step = 1;
+        while (step * 2 <= size ()) step *= 2;
+
+        size_t position = 0;
+        for (; step > 0; step /= 2)
+            if (position + step <= size () && !(x < Tree[position + step])) {
+                position += step;
+                x -= Tree[position];
+            }
+
+        return position;
+    }
+
+}
+
+#endif
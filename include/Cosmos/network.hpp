@@ -2,6 +2,7 @@
 #define COSMOS_NETWORK
 
 #include <ctime>
+#include <chrono>
 
 #include <gigamonkey/pay/MAPI.hpp>
 #include <gigamonkey/pay/ARC.hpp>
@@ -11,6 +12,9 @@
 #include <io/log.hpp>
 
 #include <Cosmos/types.hpp>
+#include <Cosmos/network/pool.hpp>
+#include <Cosmos/network/scheduler.hpp>
+#include <Cosmos/network/hedge.hpp>
 
 using JSON = net::JSON;
 
@@ -28,7 +32,9 @@ namespace Cosmos {
             ERROR_NETWORK_CONNECTION_FAIL,
             ERROR_INAUTHENTICATED,
             ERROR_INSUFFICIENT_FEE,
-            ERROR_INVALID
+            ERROR_INVALID,
+            // we could not connect, so the txs were put in the outbox to be broadcast later.
+            QUEUED
         };
 
         result Error;
@@ -74,24 +80,110 @@ namespace Cosmos {
 
     std::ostream &operator << (std::ostream &, monetary_unit);
 
+    // how long to wait before trying a remote call again.
+    // The delay doubles with every attempt up to Max.
+    struct backoff {
+        std::chrono::milliseconds Initial {2000};
+        std::chrono::milliseconds Max {60000};
+        uint32 MaxAttempts {10};
+
+        std::chrono::milliseconds operator () (uint32 attempt) const;
+    };
+
+    // where to find the services that we use.
+    struct network_endpoints {
+        host WhatsOnChain {"https", "api.whatsonchain.com"};
+        host Gorilla {"https", "mapi.gorillapool.io"};
+        host CoinGecko {"https", "api.coingecko.com"};
+        host TAAL {"https", "arc.taal.com"};
+
+        // if provided, tx and proof lookups that are slow
+        // to come back from WhatsOnChain are tried here too.
+        maybe<host> WhatsOnChainMirror {};
+
+        // every service at a single plain http address, such
+        // as the stand-in service, for testing and benchmarks.
+        static network_endpoints standin (const std::string &authority);
+    };
+
+    // a tx in the history of an address or script. Height is zero if unconfirmed.
+    struct history_item {
+        Bitcoin::TxID TxID;
+        uint64 Height;
+    };
+
+    // a merkle proof of a tx and the hash of the block that it is in.
+    struct merkle_proof {
+        Merkle::proof Proof;
+        digest256 BlockHash;
+    };
+
     struct network {
         data::exec IO;
         ptr<net::HTTP::SSL> SSL;
+        network_endpoints Endpoints;
         WhatsOnChain::API WhatsOnChain;
         MAPI::client Gorilla;
-        net::HTTP::client CoinGecko;
         ARC::client TAAL;
 
-        network (data::exec io) : IO {io}, SSL {net::HTTP::get_SSL ()},
-            WhatsOnChain {SSL}, Gorilla {SSL, net::HTTP::REST {"https", "mapi.gorillapool.io"}},
-            CoinGecko {SSL, net::HTTP::REST {"https", "api.coingecko.com"}, data::rate_limiter {1, data::millisecond {10}}},
+        // null unless Endpoints.WhatsOnChainMirror is provided.
+        ptr<WhatsOnChain::API> Mirror;
+
+        // requests that we make ourselves go through here so that
+        // connections can be reused.
+        connection_pool Pool;
+
+        // every outbound call waits here for its turn so that
+        // background work does not get in the way of the user.
+        scheduler Scheduler;
+
+        // response times by provider, which we use to decide
+        // when to send a hedged request to another provider.
+        std::map<provider, latency> Latency;
+
+        // rate limits are hard to predict, so we back off when we hit
+        // them with requests that go through the pool.
+        backoff PriceBackoff;
+
+        network (data::exec io, const network_endpoints &e = {}) : IO {io}, SSL {net::HTTP::get_SSL ()}, Endpoints {e},
+            WhatsOnChain {SSL, e.WhatsOnChain.REST ()}, Gorilla {SSL, e.Gorilla.REST ()},
             // TODO I don't know what to put for TAAL's rate limiter.
-            TAAL {SSL, net::HTTP::REST {"https", "arc.taal.com"}, data::rate_limiter {1, data::millisecond {10}}} {
+            TAAL {SSL, e.TAAL.REST (), data::rate_limiter {1, data::millisecond {10}}},
+            Mirror {bool (e.WhatsOnChainMirror) ? std::make_shared<WhatsOnChain::API> (SSL, e.WhatsOnChainMirror->REST ()) : nullptr},
+            Pool {io, SSL}, Scheduler {io}, Latency {}, PriceBackoff {} {
             SSL->set_default_verify_paths ();
             SSL->set_verify_mode (net::asio::ssl::verify_peer);
         }
         
-        awaitable<maybe<bytes>> get_transaction (const Bitcoin::TxID &);
+        // calls that may take a while, such as getting a tx or a history,
+        // take a priority and a flow. Calls of the same priority from
+        // different flows take turns.
+        // if WhatsOnChain is slower than usual to respond, we ask the mirror too and take
+        // whichever answer comes first. We check that the tx has the txid that we asked for.
+        // Nothing means that the tx was not found. If every source fails, we throw, and
+        // the last source backs off when it is busy or we cannot connect to it.
+        awaitable<maybe<bytes>> get_transaction (const Bitcoin::TxID &,
+            priority = priority::interactive, uint64 flow = 0);
+
+        // like get_transaction, but ARC is asked as well. A proof is only accepted
+        // if it is valid and it passes verify, which should check it against a header.
+        awaitable<maybe<merkle_proof>> get_merkle_proof (Bitcoin::TxID,
+            std::function<bool (const merkle_proof &)> verify,
+            priority = priority::interactive, uint64 flow = 0);
+
+        // height of the latest block.
+        awaitable<uint64> height (priority = priority::interactive, uint64 flow = 0);
+
+        // the confirmed history at or above a given height, in
+        // order of height, followed by the unconfirmed history.
+        awaitable<list<history_item>> history (const Bitcoin::address &, uint64 from_height,
+            priority = priority::background, uint64 flow = 0);
+        awaitable<list<history_item>> history (const digest256 &script_hash, uint64 from_height,
+            priority = priority::background, uint64 flow = 0);
+
+        // block heights of those txs that have been mined.
+        awaitable<map<Bitcoin::TxID, uint64>> mined (list<Bitcoin::TxID>,
+            priority = priority::background, uint64 flow = 0);
         
         awaitable<satoshis_per_byte> mining_fee ();
         
@@ -99,7 +191,15 @@ namespace Cosmos {
         awaitable<broadcast_single_result> broadcast (const extended_transaction &tx);
         awaitable<broadcast_multiple_result> broadcast (list<extended_transaction> tx);
 
-        awaitable<double> price (monetary_unit, const Bitcoin::timestamp &);
+        awaitable<double> price (monetary_unit, const Bitcoin::timestamp &, priority = priority::interactive);
+
+        // daily prices over a range in a single request. Keys are
+        // the timestamps of the start of each day (UTC).
+        awaitable<map<Bitcoin::timestamp, double>> prices (monetary_unit,
+            const Bitcoin::timestamp &from, const Bitcoin::timestamp &to, priority = priority::background);
+
+        // wait on the network's executor without blocking the thread.
+        awaitable<void> sleep (std::chrono::milliseconds);
         
     };
     
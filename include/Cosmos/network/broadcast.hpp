@@ -1,77 +1,54 @@
 #ifndef COSMOS_NETWORK_BROADCAST
 #define COSMOS_NETWORK_BROADCAST
 
-#include <net/error.hpp>
-
-#include <gigamonkey/pay/MAPI.hpp>
-#include <gigamonkey/pay/ARC.hpp>
-#include <gigamonkey/SPV.hpp>
-
-#include <Cosmos/types.hpp>
+#include <Cosmos/network.hpp>
+#include <mutex>
 
 namespace Cosmos {
-    namespace MAPI = Gigamonkey::MAPI;
-    namespace ARC = Gigamonkey::ARC;
-    using extended_transaction = Gigamonkey::extended::transaction;
-    using satoshis_per_byte = Gigamonkey::satoshis_per_byte;
 
-    struct broadcast_result {
-        enum result {
-            SUCCESS,
-            ERROR_UNKNOWN,
-            ERROR_NETWORK_CONNECTION_FAIL,
-            ERROR_INAUTHENTICATED,
-            ERROR_INSUFFICIENT_FEE,
-            ERROR_INVALID
-        };
+    // collect txs to be broadcast from concurrent requests and submit
+    // them together with ARC submit_txs. There should be one of these
+    // for every network so that everything we broadcast goes through it.
+    // A tx that has already been queued by another request is not
+    // submitted again; we wait for the batch that it is in instead.
+    struct broadcast_queue {
+        network &Net;
 
-        result Error;
-        // an HTTP JSON error object if provided, as used in the ARC protocol.
-        net::error Details;
+        // the maximum number of txs in a single submission.
+        uint32 MaxBatchSize;
 
-        broadcast_result (result e, net::error deets = JSON (nullptr)): Error {e}, Details {deets} {}
-        broadcast_result (): Error {SUCCESS}, Details (JSON (nullptr)) {}
+        // how long to wait for other requests before submitting.
+        std::chrono::milliseconds Linger;
 
-        // broadcast_result is equivalent to true when the
-        // operation succeeds.
-        operator bool () const {
-            return Error == SUCCESS;
-        }
+        // how to retry when we cannot connect to ARC.
+        backoff Retry;
 
-        bool error () const {
-            return Error != SUCCESS;
-        }
+        broadcast_queue (network &net, uint32 max_batch_size = 1000,
+            std::chrono::milliseconds linger = std::chrono::milliseconds {100},
+            backoff retry = {std::chrono::milliseconds {1000}, std::chrono::milliseconds {30000}, 6}):
+            Net {net}, MaxBatchSize {max_batch_size}, Linger {linger}, Retry {retry}, Next {nullptr}, InFlight {} {}
 
-        bool success () const {
-            return Error == SUCCESS;
-        }
-    };
+        // txs must be given parents first. Wait until they have all been submitted.
+        // The result contains the statuses of every tx in the batches that ours
+        // went out in, which may include txs of other requests. If the result
+        // is an error, there may still be statuses for txs that went out before
+        // the error.
+        awaitable<broadcast_multiple_result> operator () (list<extended_transaction>);
 
-    std::ostream &operator << (std::ostream &, broadcast_result);
+    private:
+        struct batch;
 
-    struct broadcast_single_result : broadcast_result {
-        ARC::status Status {JSON (nullptr)};
-        using broadcast_result::broadcast_result;
-        broadcast_single_result (const ARC::status &stat): broadcast_result {}, Status (stat) {}
-    };
+        std::mutex Mutex;
 
-    struct broadcast_multiple_result : broadcast_result {
-        list<ARC::status> Status;
-        using broadcast_result::broadcast_result;
-        broadcast_multiple_result (list<ARC::status> stats): broadcast_result {}, Status (stats) {}
-    };
+        // the batch that is currently accepting new txs.
+        ptr<batch> Next;
 
-    // Since we might end up trying to broadcast multiple txs at once
-    // all coming from a single proof, we have a way of collecting all
-    // results that come up for all broadcasts so that we can handle
-    // the tx appropriately in the database.
-    struct broadcast_tree_result : broadcast_multiple_result {
-        using broadcast_multiple_result::broadcast_multiple_result;
-        map<Bitcoin::TxID, broadcast_single_result> Sub;
-        broadcast_tree_result (const broadcast_multiple_result &r, map<Bitcoin::TxID, broadcast_single_result> nodes = {}):
-        broadcast_multiple_result {r}, Sub {nodes} {}
-    };
+        // txs that have been queued and whose batches are not done.
+        std::map<Bitcoin::TxID, ptr<batch>> InFlight;
 
+        awaitable<void> flush (ptr<batch>);
+        awaitable<broadcast_multiple_result> submit (list<extended_transaction>);
+    };
 
 }
 
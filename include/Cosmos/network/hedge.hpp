@@ -0,0 +1,94 @@
+#ifndef COSMOS_NETWORK_HEDGE
+#define COSMOS_NETWORK_HEDGE
+
+#include <deque>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <net/asio/async.hpp>
+#include <Cosmos/types.hpp>
+
+namespace Cosmos {
+
+    // recent response times of a service so that we know
+    // when a response is taking longer than it should.
+    struct latency {
+        latency (uint32 window = 200): Window {window}, Samples {} {}
+
+        void record (std::chrono::milliseconds);
+
+        // the 95th percentile of recent response times, or
+        // the fallback if we have not seen enough responses.
+        std::chrono::milliseconds p95 (std::chrono::milliseconds fallback) const;
+
+    private:
+        uint32 Window;
+        std::deque<std::chrono::milliseconds> Samples;
+    };
+
+    // ask a source, and if we have no answer after the delay, ask the next one
+    // as well. When a source fails we go on to the next right away. The first
+    // answer wins; a source that has nothing valid to say should return nothing.
+    // Sources should not retry on their own because the hedge already tries
+    // the next source when one fails, except for the last one, which has no
+    // other source to fall back on. If every source throws, so do we, so that
+    // a failure is not mistaken for a source having nothing to say.
+    template <typename X> awaitable<maybe<X>> first_valid (std::chrono::milliseconds delay,
+        list<std::function<awaitable<maybe<X>> ()>> sources) {
+
+        struct race {
+            maybe<X> Answer;
+            uint32 Finished;
+            uint32 Failed;
+            std::exception_ptr Error;
+            net::asio::steady_timer Wake;
+            race (data::exec ex): Answer {}, Finished {0}, Failed {0}, Error {}, Wake {ex} {}
+        };
+
+        auto ex = co_await net::asio::this_coro::executor;
+        auto r = std::make_shared<race> (ex);
+
+        auto wait = [r] (net::asio::steady_timer::time_point until) -> awaitable<void> {
+            r->Wake.expires_at (until);
+            boost::system::error_code ec;
+            co_await r->Wake.async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        };
+
+        uint32 started = 0;
+        while (!data::empty (sources) && !bool (r->Answer)) {
+            auto source = data::first (sources);
+            sources = data::rest (sources);
+
+            net::asio::co_spawn (ex, [r, source] () -> awaitable<void> {
+                maybe<X> answer;
+                try {
+                    answer = co_await source ();
+                } catch (const std::exception &x) {
+                    DATA_LOG (warning) << "hedged request failed: " << x.what ();
+                    r->Failed++;
+                    r->Error = std::current_exception ();
+                }
+
+                if (bool (answer) && !bool (r->Answer)) r->Answer = answer;
+                r->Finished++;
+                r->Wake.cancel ();
+            }, net::asio::detached);
+
+            started++;
+
+            // wait for an answer, a failure, or for the delay to run out.
+            if (!data::empty (sources) && r->Finished < started && !bool (r->Answer))
+                co_await wait (net::asio::steady_timer::clock_type::now () + delay);
+        }
+
+        while (!bool (r->Answer) && r->Finished < started)
+            co_await wait (net::asio::steady_timer::time_point::max ());
+
+        if (!bool (r->Answer) && r->Failed == started && r->Error) std::rethrow_exception (r->Error);
+
+        co_return r->Answer;
+    }
+
+}
+
+#endif
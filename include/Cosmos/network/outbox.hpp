@@ -0,0 +1,87 @@
+#ifndef COSMOS_NETWORK_OUTBOX
+#define COSMOS_NETWORK_OUTBOX
+
+#include <Cosmos/database.hpp>
+#include <Cosmos/wallet/account.hpp>
+
+namespace Cosmos {
+
+    // the note that goes with a payment in the outbox, so
+    // that the payment can be undone if it is rejected.
+    struct outgoing_payment {
+        // the wallet that paid, if there is more than one.
+        maybe<std::string> Wallet;
+
+        // the changes that the payment made to the account.
+        list<account_diff> Diffs;
+
+        // changes that remove the outputs of the payment from
+        // the account and put back the outputs that it spent.
+        list<account_diff> Undo;
+
+        // the account is what the wallet had before the payment. Throw
+        // account::cannot_apply_diff if the payment spends an output
+        // that is neither in the account nor made by the payment.
+        outgoing_payment (maybe<std::string> wallet, const account &, list<account_diff> diffs);
+
+        explicit outgoing_payment (const JSON &);
+        explicit operator JSON () const;
+
+        // the undo diffs that can be applied to an account as it is now. Outputs
+        // of the payment that have been spent by a later payment stay spent.
+        list<account_diff> undo (const account &) const;
+    };
+
+    // submit the txs in the outbox through the broadcast queue once we can connect.
+    struct outbox_flusher {
+        cached_remote_TXDB &TXDB;
+
+        // if provided, payments that are rejected are undone in
+        // the accounts of the wallets that are named in their notes.
+        controller *Wallets;
+
+        // the maximum number of txs in a single submission.
+        uint32 MaxBatchSize;
+
+        // how often we look at the outbox.
+        std::chrono::milliseconds Interval;
+
+        // how long to wait after we could not connect.
+        backoff Retry;
+
+        outbox_flusher (cached_remote_TXDB &txdb, controller *wallets = nullptr, uint32 max_batch_size = 1000,
+            std::chrono::milliseconds interval = std::chrono::milliseconds {60000},
+            backoff retry = {std::chrono::milliseconds {5000}, std::chrono::milliseconds {300000}}):
+            TXDB {txdb}, Wallets {wallets}, MaxBatchSize {max_batch_size}, Interval {interval}, Retry {retry}, Stopped {false} {}
+
+        struct result {
+            // whether we were able to connect.
+            bool Connected {true};
+
+            // number of entries that were accepted.
+            uint32 Broadcast {0};
+
+            // entries that were rejected. They are no longer in the outbox.
+            // If we have Wallets, they have been undone already. Otherwise
+            // whatever is in their notes should be undone by the caller.
+            list<outgoing> Rejected {};
+        };
+
+        // try to submit everything in the outbox.
+        awaitable<result> flush ();
+
+        // flush until stop is called.
+        awaitable<void> run ();
+
+        void stop ();
+
+    private:
+        bool Stopped;
+        ptr<net::asio::steady_timer> Wake;
+
+        void undo (const outgoing &);
+    };
+
+}
+
+#endif
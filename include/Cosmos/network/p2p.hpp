@@ -0,0 +1,87 @@
+#ifndef COSMOS_NETWORK_P2P
+#define COSMOS_NETWORK_P2P
+
+#include <chrono>
+#include <set>
+#include <boost/beast/core.hpp>
+#include <Cosmos/database/txdb.hpp>
+#include <Cosmos/network/peers.hpp>
+
+namespace Cosmos {
+
+    // talk to Bitcoin nodes directly to keep our headers up to date and to
+    // hear about txs that pay to scripts we are watching, so that we don't
+    // have to ask an HTTP service. Peers are chosen by friendship score,
+    // which goes up when a peer gives us something useful.
+    struct p2p_client {
+        struct options {
+            // how many peers to connect to at once.
+            uint32 MaxPeers {4};
+
+            // ip:port of nodes to try when we don't know enough peers.
+            list<std::string> Seeds {};
+
+            // the first four bytes of every message. This is mainnet.
+            uint32 Magic {0xe8f3e1e3};
+
+            // disconnect from a peer that has said nothing for this long.
+            std::chrono::milliseconds Timeout {300000};
+
+            // how often we replace peers that have disconnected.
+            std::chrono::milliseconds Reconnect {30000};
+
+            // peers with a score below this are not tried.
+            int MinFriendshipScore {-20};
+        };
+
+        p2p_client (data::exec io, local_TXDB &local, peer_store &peers, const options &o):
+            IO {io}, Local {local}, Peers {peers}, Options {o}, Watched {}, Streams {}, Stopped {false} {}
+
+        p2p_client (data::exec io, local_TXDB &local, peer_store &peers):
+            p2p_client {io, local, peers, options {}} {}
+
+        // txs with an output whose script has this hash (SHA2_256) are
+        // saved to the database when a peer relays them to us.
+        void watch (const digest256 &script_hash);
+
+        // keep connected to peers until stop is called.
+        awaitable<void> run ();
+
+        void stop ();
+
+    private:
+        data::exec IO;
+        local_TXDB &Local;
+        peer_store &Peers;
+        options Options;
+
+        std::set<digest256> Watched;
+
+        // connections that are open by address.
+        std::map<std::string, ptr<boost::beast::tcp_stream>> Streams;
+
+        bool Stopped;
+        ptr<net::asio::steady_timer> Wake;
+
+        // peers to try, best first.
+        list<std::string> candidates ();
+
+        awaitable<void> session (std::string address);
+
+        // Return the number of new headers and whether there may be more.
+        uint32 accept_headers (data::byte_slice, bool &more);
+
+        // Return whether the tx was one we are watching for.
+        bool accept_transaction (data::byte_slice);
+
+        // getheaders starting from our latest header.
+        maybe<bytes> get_headers () const;
+    };
+
+    void inline p2p_client::watch (const digest256 &script_hash) {
+        Watched.insert (script_hash);
+    }
+
+}
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef COSMOS_NETWORK_PEERS
+#define COSMOS_NETWORK_PEERS
+
+#include <Cosmos/types.hpp>
+
+namespace Cosmos {
+
+    // what we remember about a node that we have connected to.
+    struct peer_record {
+        // ip:port
+        std::string Address;
+
+        // whether the last connection went well.
+        bool Success;
+
+        // how long the last connection lasted in milliseconds.
+        uint64 Duration;
+
+        uint64 BytesReceived;
+        uint64 BytesSent;
+
+        // goes up when a peer is useful to us and down when it is not.
+        int FriendshipScore;
+    };
+
+    struct peer_store {
+        // the best peers first, by friendship score.
+        virtual list<peer_record> peers (uint32 max) = 0;
+        virtual maybe<peer_record> peer (const std::string &address) = 0;
+        virtual void set_peer (const peer_record &) = 0;
+        virtual ~peer_store () {}
+    };
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef COSMOS_NETWORK_POOL
+#define COSMOS_NETWORK_POOL
+
+#include <chrono>
+#include <list>
+#include <deque>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <net/HTTP.hpp>
+#include <Cosmos/types.hpp>
+
+namespace Cosmos {
+
+    // a remote service that we connect to.
+    struct host {
+        std::string Protocol;
+        std::string Name;
+        uint16 Port;
+
+        host (const std::string &protocol, const std::string &name, uint16 port = 0):
+            Protocol {protocol}, Name {name}, Port {port != 0 ? port : protocol == "https" ? uint16 (443) : uint16 (80)} {}
+
+        bool secure () const {
+            return Protocol == "https";
+        }
+
+        // name and port, leaving out the port if it is the default.
+        std::string authority () const;
+
+        // read something like https://api.whatsonchain.com or localhost:4568.
+        // The protocol is https if it is left out.
+        static host read (const std::string &);
+
+        net::HTTP::REST REST () const {
+            return net::HTTP::REST {Protocol, authority ()};
+        }
+
+        auto operator <=> (const host &) const = default;
+    };
+
+    std::ostream &operator << (std::ostream &, const host &);
+
+    // keep connections open between requests so that we don't have to
+    // do a TCP and TLS handshake every time. TLS sessions are saved per
+    // host so that a new connection can skip most of the handshake.
+    struct connection_pool {
+        struct options {
+            // at most this many connections to any one host.
+            uint32 MaxConnectionsPerHost {8};
+
+            // connections that have not been used for this long are closed.
+            std::chrono::milliseconds IdleTimeout {30000};
+
+            // the biggest response body that we will read. Txs can be very big.
+            uint64 MaxBodySize {uint64 (1) << 30};
+        };
+
+        connection_pool (data::exec io, ptr<net::HTTP::SSL> ssl, const options &o);
+        connection_pool (data::exec io, ptr<net::HTTP::SSL> ssl): connection_pool {io, ssl, options {}} {}
+
+        ~connection_pool ();
+
+        // make a request over a pooled connection. A request that fails over
+        // a reused connection is tried once more over a new one, since the
+        // server may have closed it in the meantime.
+        awaitable<net::HTTP::response> operator () (const host &,
+            boost::beast::http::verb, const std::string &target,
+            const std::string &body = "", const std::string &content_type = "");
+
+        // close all connections that have been idle for too long. This
+        // happens on its own while there are idle connections.
+        void evict ();
+
+        // number of open connections to a host, both idle and in use.
+        uint32 open (const host &) const;
+
+    private:
+        data::exec IO;
+        ptr<net::HTTP::SSL> SSL;
+        options Options;
+
+        struct connection;
+        struct host_state;
+
+        std::map<host, ptr<host_state>> Hosts;
+
+        // wakes up when the next idle connection is due to be closed.
+        struct sweeper;
+        ptr<sweeper> Sweeper;
+
+        awaitable<ptr<connection>> acquire (const host &, bool &reused);
+        void release (const host &, ptr<connection>);
+        awaitable<ptr<connection>> connect (const host &, host_state &);
+
+        // when the oldest idle connection should be closed, if there is one.
+        maybe<std::chrono::steady_clock::time_point> next_eviction () const;
+        awaitable<void> sweep (ptr<sweeper>);
+    };
+
+}
+
+#endif
@@ -0,0 +1,96 @@
+#ifndef COSMOS_NETWORK_SCHEDULER
+#define COSMOS_NETWORK_SCHEDULER
+
+#include <array>
+#include <deque>
+#include <chrono>
+#include <Cosmos/types.hpp>
+
+namespace Cosmos {
+
+    // the remote services that we call.
+    enum class provider {
+        WhatsOnChain,
+        // a second WhatsOnChain-compatible service, if one is configured.
+        WhatsOnChainMirror,
+        Gorilla,
+        CoinGecko,
+        TAAL
+    };
+
+    std::ostream &operator << (std::ostream &, provider);
+
+    // requests wait until no requests of a higher priority are waiting.
+    enum class priority {
+        // the user is waiting for this, such as a spend or a broadcast.
+        interactive,
+        // restoring a wallet.
+        restore,
+        // syncing, watching for confirmations, prefetching prices.
+        background
+    };
+
+    // every request to a remote service waits here for its turn. Each provider
+    // has a token bucket and a limit on requests in flight. Within a priority,
+    // waiting requests are taken from each flow in turn so that one flow cannot
+    // crowd out the others.
+    struct scheduler {
+        struct limit {
+            // tokens per second. Zero for no limit.
+            double Rate;
+
+            // the most tokens that can build up.
+            double Burst;
+
+            // zero for no limit.
+            uint32 MaxInFlight;
+        };
+
+        static std::map<provider, limit> default_limits ();
+
+        // permission to make a request. The in-flight slot is given back
+        // when the ticket is destroyed.
+        struct ticket {
+            ticket (): Scheduler {nullptr}, Provider {} {}
+            ticket (ticket &&);
+            ticket &operator = (ticket &&);
+            ticket (const ticket &) = delete;
+            ticket &operator = (const ticket &) = delete;
+            ~ticket ();
+
+        private:
+            friend struct scheduler;
+            scheduler *Scheduler;
+            provider Provider;
+            ticket (scheduler *s, provider p): Scheduler {s}, Provider {p} {}
+        };
+
+        scheduler (data::exec io, std::map<provider, limit> limits = default_limits ());
+
+        awaitable<ticket> admit (provider, priority, uint64 flow = 0);
+
+        // for calls that cannot wait, such as those that are made synchronously
+        // on the executor. The call is counted against the provider's limits
+        // right away, so requests that are waiting will wait longer.
+        ticket take (provider);
+
+        // number of requests that are waiting for a provider.
+        uint32 waiting (provider) const;
+
+    private:
+        struct waiter;
+        struct queue;
+
+        data::exec IO;
+        std::map<provider, ptr<queue>> Queues;
+
+        queue &get (provider);
+        void release (provider);
+
+        // let as many requests go as we can and set a timer for the rest.
+        void dispatch (queue &);
+    };
+
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef COSMOS_NETWORK_WATCHER
+#define COSMOS_NETWORK_WATCHER
+
+#include <Cosmos/database/txdb.hpp>
+
+namespace Cosmos {
+
+    // check in the background whether unconfirmed txs have been mined
+    // and save their merkle proofs when they have. Txs are checked less
+    // often the longer they have been waiting.
+    struct confirmation_watcher {
+        cached_remote_TXDB &TXDB;
+
+        // how often we look for txs that are due to be checked.
+        std::chrono::milliseconds Interval;
+
+        // a tx is checked again after a delay that grows with its age,
+        // staying between these bounds.
+        std::chrono::milliseconds MinDelay;
+        std::chrono::milliseconds MaxDelay;
+
+        confirmation_watcher (cached_remote_TXDB &txdb,
+            std::chrono::milliseconds interval = std::chrono::milliseconds {30000},
+            std::chrono::milliseconds min_delay = std::chrono::milliseconds {30000},
+            std::chrono::milliseconds max_delay = std::chrono::milliseconds {3600000}):
+            TXDB {txdb}, Interval {interval}, MinDelay {min_delay}, MaxDelay {max_delay}, Pending {}, Stopped {false} {}
+
+        // check every Interval until stop is called.
+        awaitable<void> run ();
+
+        void stop ();
+
+        // check all txs that are due now. Return the number that were confirmed.
+        awaitable<uint32> check ();
+
+    private:
+        struct pending {
+            std::chrono::steady_clock::time_point FirstSeen;
+            std::chrono::steady_clock::time_point NextCheck;
+        };
+
+        std::map<Bitcoin::TxID, pending> Pending;
+
+        bool Stopped;
+        ptr<net::asio::steady_timer> Wake;
+
+        std::chrono::milliseconds delay (std::chrono::steady_clock::duration age) const;
+    };
+
+}
+
+#endif
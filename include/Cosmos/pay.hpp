@@ -71,6 +71,9 @@ namespace Cosmos {
         static new_request request_payment (type t, const payments &p, const request &x);
     };
 
+    JSON write_account_diffs (const list<account_diff> &);
+    list<account_diff> read_account_diffs (const JSON &);
+
     struct payments::new_request {
         payments::payment_request Request;
         payments Payments;      // new payments
@@ -48,6 +48,36 @@ namespace Cosmos::random {
         }
     };
 
+    // a stream of random bytes that is determined by a seed, so that
+    // work that is done concurrently can be reproduced.
+    struct stream final : data::random::source {
+        data::bytes Seed;
+        uint64_t Counter {0};
+        byte Block[32];
+        size_t Used {32};
+
+        stream (const data::bytes &seed): Seed {seed} {}
+
+        void read (byte *result, size_t remaining) final override {
+            while (remaining > 0) {
+                if (Used == 32) {
+                    data::uint64_little counter = Counter++;
+                    data::crypto::hash::SHA2_256 hash {};
+                    hash.Update (Seed.data (), Seed.size ());
+                    hash.Update (counter.data (), 8);
+                    hash.Final (Block);
+                    Used = 0;
+                }
+
+                size_t bytes_to_write = remaining > 32 - Used ? 32 - Used : remaining;
+                std::copy (Block + Used, Block + Used + bytes_to_write, result);
+                Used += bytes_to_write;
+                result += bytes_to_write;
+                remaining -= bytes_to_write;
+            }
+        }
+    };
+
 }
 
 #endif
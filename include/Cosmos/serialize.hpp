@@ -0,0 +1,75 @@
+#ifndef COSMOS_SERIALIZE
+#define COSMOS_SERIALIZE
+
+#include <Cosmos/types.hpp>
+#include <exception>
+
+// little-endian numbers and var ints, as they are written
+// in txs, BEEFs and messages of the peer to peer protocol.
+namespace Cosmos::serialize {
+
+    void inline write_uint (bytes &b, uint64 x, int size) {
+        for (int i = 0; i < size; i++) b.push_back (static_cast<byte> (x >> (8 * i)));
+    }
+
+    void inline write_var_int (bytes &b, uint64 x) {
+        if (x < 0xfd) write_uint (b, x, 1);
+        else if (x <= 0xffff) {
+            b.push_back (0xfd);
+            write_uint (b, x, 2);
+        } else if (x <= 0xffffffff) {
+            b.push_back (0xfe);
+            write_uint (b, x, 4);
+        } else {
+            b.push_back (0xff);
+            write_uint (b, x, 8);
+        }
+    }
+
+    void inline write_bytes (bytes &b, data::byte_slice x) {
+        b.insert (b.end (), x.begin (), x.end ());
+    }
+
+    // thrown when we try to read past the end.
+    struct end_of_input : std::exception {
+        const char *what () const noexcept override {
+            return "not enough bytes";
+        }
+    };
+
+    struct reader {
+        data::byte_slice Bytes;
+        size_t Position;
+
+        reader (data::byte_slice b, size_t position = 0): Bytes {b}, Position {position} {}
+
+        data::byte_slice read (uint64 size) {
+            if (size > Bytes.size () - Position) throw end_of_input {};
+            auto x = Bytes.range (Position, Position + size);
+            Position += size;
+            return x;
+        }
+
+        uint64 read_uint (int size) {
+            auto b = read (size);
+            uint64 x = 0;
+            for (int i = 0; i < size; i++) x |= uint64 (b[i]) << (8 * i);
+            return x;
+        }
+
+        uint64 read_var_int () {
+            byte x = read_uint (1);
+            if (x == 0xfd) return read_uint (2);
+            if (x == 0xfe) return read_uint (4);
+            if (x == 0xff) return read_uint (8);
+            return x;
+        }
+
+        bool done () const {
+            return Position == Bytes.size ();
+        }
+    };
+
+}
+
+#endif
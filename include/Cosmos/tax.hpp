@@ -54,8 +54,17 @@ namespace Cosmos {
         // the account at the end of the tax period.
         account Account;
 
+        // throws if a price is missing.
         static tax calculate (TXDB &, price_data *, const history::episode &);
 
+        // prefetch prices and then calculate out of the local price data,
+        // so that we never block the thread waiting for a price.
+        static awaitable<tax> calculate (TXDB &, price_service &, const history::episode &);
+
+        // fetch every price that calculate will need in one pass so
+        // that it does not have to go to the network one day at a time.
+        static awaitable<uint32> prefetch_prices (TXDB &, price_service &, const history::episode &);
+
         tax () : CapitalGain {}, Income {}, Account {} {}
 
         tax (const capital_gain &cg, list<potential_income> income, const account &a) :
@@ -1,6 +1,9 @@
 #ifndef COSMOS_WALLET_ACCOUNT
 #define COSMOS_WALLET_ACCOUNT
 
+#include <map>
+#include <set>
+#include <mutex>
 #include <Cosmos/wallet/keys.hpp>
 #include <Cosmos/database/txdb.hpp>
 
@@ -44,7 +47,10 @@ namespace Cosmos {
     };
 
     struct account : data::base_map<Bitcoin::outpoint, redeemable, account> {
-        using data::base_map<Bitcoin::outpoint, redeemable, account>::base_map;
+        using base = data::base_map<Bitcoin::outpoint, redeemable, account>;
+        using base::base_map;
+        using base::insert;
+        using base::remove;
 
         // apply a diff to an account. Throw exception if the diff contains
         // outpoints to be removed that are not in the account.
@@ -52,12 +58,52 @@ namespace Cosmos {
 
         explicit account (const JSON &);
         explicit operator JSON () const;
+
+        // totals that are kept up to date by insert and remove, so that
+        // we don't need to go through the whole account to get them.
+        struct totals {
+            Bitcoin::satoshi Value {0};
+            uint64 Count {0};
+            uint64 InputsExpectedSize {0};
+
+            // outputs by value, biggest first.
+            struct by_value {
+                Bitcoin::satoshi Value;
+                Bitcoin::outpoint Key;
+
+                bool operator < (const by_value &x) const {
+                    return Value > x.Value;
+                }
+
+                bool operator <= (const by_value &x) const {
+                    return Value >= x.Value;
+                }
+            };
+
+            // outputs that are removed stay in here until they come to the top,
+            // so that removing an output is O(log n) rather than O(n).
+            data::priority_queue<by_value> Biggest {};
+
+            // how many outputs in Biggest have been removed.
+            uint64 Stale {0};
+        };
+
         Bitcoin::satoshi value () const {
-            Bitcoin::satoshi v {0};
-            for (const auto &[_, value] : *this) v += value.Prevout.Value;
-            return v;
+            return aggregates ().Value;
+        }
+
+        uint64 count () const {
+            return aggregates ().Count;
+        }
+
+        uint64 inputs_expected_size () const {
+            return aggregates ().InputsExpectedSize;
         }
 
+        // an outpoint that is already in the account is replaced.
+        account insert (const Bitcoin::outpoint &, const redeemable &) const;
+        account remove (const Bitcoin::outpoint &) const;
+
         struct account_details {
             Bitcoin::satoshi Value {0};
             Bitcoin::prevout Max {Bitcoin::outpoint {}, Bitcoin::output {}};
@@ -90,6 +136,50 @@ namespace Cosmos {
             return *this = *this << d;
         }
 
+        // apply many diffs without making a new account for each change.
+        // Outputs that are created and then spent within the batch never
+        // go into the account at all. Call freeze to get the result.
+        struct builder {
+            // if the base has more outputs than this for each change, freeze makes
+            // the changes one at a time rather than making a whole new account.
+            constexpr static size_t OutputsPerChange {8};
+
+            builder (const account &a): Base {a}, Inserted {}, Removed {} {}
+
+            // like account::operator <<, throw cannot_apply_diff and leave
+            // the builder unchanged if the diff removes an output we don't have.
+            builder &operator <<= (const account_diff &);
+
+            builder &insert (const Bitcoin::outpoint &, const redeemable &);
+
+            account freeze () const;
+
+        private:
+            account Base;
+            std::map<Bitcoin::outpoint, redeemable> Inserted;
+            std::set<Bitcoin::outpoint> Removed;
+
+            bool contains (const Bitcoin::outpoint &) const;
+        };
+
+    private:
+        // An account that was made some other way than by insert or remove
+        // works out its totals when they are first needed. Copies of an
+        // account share its totals, so they are worked out under a once_flag.
+        struct known_totals {
+            // true if the totals were given when the account was made.
+            bool Known;
+            std::once_flag Once;
+            totals Totals;
+
+            known_totals (): Known {false}, Once {}, Totals {} {}
+            known_totals (totals &&t): Known {true}, Once {}, Totals {std::move (t)} {}
+        };
+
+        ptr<known_totals> Totals {std::make_shared<known_totals> ()};
+
+        const totals &aggregates () const;
+
     };
 
     std::ostream inline &operator << (std::ostream &o, const redeemable &r) {
@@ -0,0 +1,55 @@
+#ifndef COSMOS_WALLET_BATCH
+#define COSMOS_WALLET_BATCH
+
+#include <Cosmos/wallet/spend.hpp>
+
+namespace Cosmos {
+
+    // pay many payees at once. Inputs for the whole batch are selected in
+    // one pass and then the payees are split up into txs that are no bigger
+    // than MaxTxSize. Each tx but the last has one extra output that carries
+    // whatever it doesn't need to the next tx, which spends it first. The
+    // last tx makes change.
+    struct spend_batch {
+        spend Spend;
+
+        // the biggest tx that we will make.
+        uint64 MaxTxSize {100000};
+
+        // the most that we will pay in fees for all txs together.
+        maybe<Bitcoin::satoshi> MaxFee {};
+
+        // room that we leave in each tx for change outputs, by default 20 of them.
+        uint64 ChangeReserveSize {20 * tx_size::PayToAddressOutputSize};
+
+        struct planned {
+            // every tx but the first spends an output of the tx before it
+            // as its first input, which is not known until that tx is signed.
+            list<spend::tx> Transactions;
+
+            // for each tx but the last, the index of the output that the next tx spends.
+            list<Bitcoin::index> Carried;
+
+            key_source Addresses;
+
+            // call after each tx is signed, in order. The next tx is made to
+            // spend the output carried over from this one and the diff for
+            // this tx is returned.
+            account_diff complete (uint32 index, const Bitcoin::TxID &);
+
+            bool valid () const {
+                return data::size (Transactions) != 0;
+            }
+        };
+
+        planned operator () (
+            redeem, account,
+            key_source addresses,
+            // payees' outputs
+            list<Bitcoin::output> to,
+            satoshis_per_byte fees = {1, 100}) const;
+    };
+
+}
+
+#endif
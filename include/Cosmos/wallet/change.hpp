@@ -4,6 +4,7 @@
 #include <gigamonkey/timechain.hpp>
 #include <data/random.hpp>
 #include <Cosmos/wallet/account.hpp>
+#include <Cosmos/wallet/size.hpp>
 #include <Cosmos/options.hpp>
 
 namespace Cosmos {
@@ -14,6 +15,9 @@ namespace Cosmos {
         // last key used +1
         uint32 Last;
 
+        // the design that we were given with the change outputs added.
+        tx_size Size;
+
         list<Bitcoin::output> outputs () const {
             list<Bitcoin::output> o;
             for (auto &p : Change) o <<= p.Prevout;
@@ -21,8 +25,11 @@ namespace Cosmos {
         }
     };
 
-    // construct a set of change outputs.
-    using make_change = data::function<change (Bitcoin::satoshi, satoshis_per_byte fees, key_source, data::random::source &)>;
+    // construct a set of change outputs for a tx that has everything else already.
+    // Whatever the tx spends beyond what it sends and the fee that it must pay,
+    // including for the change outputs, is change, except for anything too small
+    // to make an output, which goes to the miner.
+    using make_change = data::function<change (const tx_size &design, satoshis_per_byte fees, key_source, data::random::source &)>;
 
     // default make_change function
     struct make_change_parameters {
@@ -41,7 +48,7 @@ namespace Cosmos {
         double ExpectedSplitFraction;
 
         // construct a set of change outputs.
-        change operator () (Bitcoin::satoshi, satoshis_per_byte fees, key_source, data::random::source &) const;
+        change operator () (const tx_size &, satoshis_per_byte fees, key_source, data::random::source &) const;
     };
 }
 
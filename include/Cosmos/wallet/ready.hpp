@@ -0,0 +1,70 @@
+#ifndef COSMOS_WALLET_READY
+#define COSMOS_WALLET_READY
+
+#include <Cosmos/wallet/split.hpp>
+
+namespace Cosmos {
+
+    // a stock of confirmed outputs in log-distributed denominations that are
+    // made ahead of time, when nothing else is going on, so that most payments
+    // can be made out of them without change. Such a payment needs no new keys
+    // and no change outputs, so it is ready as soon as it is signed.
+    struct ready_pool {
+        constexpr static uint32 DefaultStock {100};
+        constexpr static uint32 DefaultMinStock {50};
+
+        // a refill leaves room in its size for the numbers of
+        // its inputs and outputs to go up to this.
+        constexpr static uint64 MaxSplitOutputs {0xffff};
+
+        // whether the tx that made an output has been mined.
+        using confirmed = data::function<bool (const Bitcoin::outpoint &)>;
+
+        // how many outputs we try to keep in the pool.
+        uint32 Stock;
+
+        // we refill the pool when it has fewer outputs than this.
+        uint32 MinStock;
+
+        // denominations are drawn from the log triangular distribution of the split.
+        split Denominations;
+
+        // how much more than the value and fees we will give up in order to avoid
+        // change. Should be less than the minimum value of a change output.
+        Bitcoin::satoshi MaxWaste;
+
+        // the most steps that the search for outputs to pay with will take.
+        uint32 MaxTries {100000};
+
+        ready_pool (
+            uint32 stock = DefaultStock,
+            uint32 min_stock = DefaultMinStock,
+            split denominations = split {},
+            Bitcoin::satoshi max_waste = spend_options::DefaultMinChangeSats):
+            Stock {stock}, MinStock {min_stock}, Denominations {denominations}, MaxWaste {max_waste} {}
+
+        // denominations and waste from the spend options.
+        explicit ready_pool (const spend_options &o, uint32 stock = DefaultStock, uint32 min_stock = DefaultMinStock):
+            ready_pool {stock, min_stock, split {o.MinSatsPerOutput, o.MaxSatsPerOutput, o.MeanSatsPerOutput}, o.MinChangeSats} {}
+
+        // the outputs of the account that are in the pool, which are those that are
+        // confirmed and have a value in the range of the denominations.
+        account pooled (const account &, const confirmed &) const;
+
+        // how many outputs we should make to fill up the pool, or zero if we don't need to yet.
+        uint32 deficit (const account &, const confirmed &) const;
+
+        // pay out of the pool with no change if we can. Otherwise use the given spend function.
+        spend::spent pay (const spend &, redeem, account, const confirmed &,
+            key_source addresses, list<Bitcoin::output> to, satoshis_per_byte fees) const;
+
+        // a split that makes as many new outputs as the pool needs out of the biggest
+        // outputs that are not in it. The rest goes into one more output. Invalid
+        // if the pool doesn't need any more or there is nothing to split.
+        spend::spent refill (redeem, const account &, const confirmed &,
+            key_source addresses, satoshis_per_byte fees, data::random::source &) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef COSMOS_WALLET_REFILL
+#define COSMOS_WALLET_REFILL
+
+#include <Cosmos/wallet/ready.hpp>
+#include <Cosmos/wallet/send.hpp>
+
+namespace Cosmos {
+
+    // keep the ready pool of every wallet stocked in the background, so that
+    // payments don't have to wait for a split. The outputs of a refill only
+    // count once they are mined, so a wallet is not refilled again until the
+    // txs of its last refill have been. Give this a cached_remote_TXDB with
+    // background priority so that refills yield to everything else.
+    struct pool_refiller {
+        controller &DB;
+        cached_remote_TXDB &TXDB;
+
+        ready_pool Pool;
+        satoshis_per_byte Fees;
+
+        // how often we look for wallets that need to be refilled.
+        std::chrono::milliseconds Interval;
+
+        pool_refiller (controller &db, cached_remote_TXDB &txdb, const ready_pool &pool, satoshis_per_byte fees,
+            std::chrono::milliseconds interval = std::chrono::milliseconds {600000}):
+            DB {db}, TXDB {txdb}, Pool {pool}, Fees {fees}, Interval {interval}, Refilling {}, Stopped {false} {}
+
+        // refill every wallet that needs it. Return the number that were refilled.
+        awaitable<uint32> refill ();
+
+        // refill every Interval until stop is called.
+        awaitable<void> run ();
+
+        void stop ();
+
+    private:
+        // for each wallet, the txs of its last refill until they are mined.
+        std::map<std::string, list<Bitcoin::TxID>> Refilling;
+
+        bool Stopped;
+        ptr<net::asio::steady_timer> Wake;
+    };
+
+}
+
+#endif
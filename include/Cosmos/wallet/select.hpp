@@ -4,6 +4,7 @@
 #include <gigamonkey/timechain.hpp>
 #include <data/random.hpp>
 #include <Cosmos/wallet/account.hpp>
+#include <Cosmos/wallet/size.hpp>
 
 namespace crypto = data::crypto;
 
@@ -74,6 +75,32 @@ namespace Cosmos {
         selected operator () (const account &, Bitcoin::satoshi, satoshis_per_byte fees, data::random::source &) const;
     };
 
+    // look for outputs that add up to the value plus fees so closely that no
+    // change output is needed, using a branch-and-bound search with a limited
+    // number of steps. If there are none, use Fallback. The search is for
+    // value_to_spend itself, so there will only be no change if the spend
+    // function doesn't redeem extra, which is what spend::Changeless is for.
+    struct select_changeless {
+        // how much more than the value and fees we will give up in order to
+        // avoid change. Should be less than the minimum value of a change output.
+        Bitcoin::satoshi MaxWaste;
+
+        select_down Fallback;
+
+        // expected size of the tx other than the inputs. By default, one
+        // pay to address output and fewer than 253 inputs.
+        uint64 OverheadSize {tx_size::pay_to_address_size (1, 1)};
+
+        // the most steps that the search will take.
+        uint32 MaxTries {100000};
+
+        // select outputs from a wallet sufficient for the given value.
+        selected operator () (const account &, Bitcoin::satoshi, satoshis_per_byte fees, data::random::source &) const;
+
+        // nothing if there is no selection without change.
+        maybe<selected> search (const account &, Bitcoin::satoshi, satoshis_per_byte fees, data::random::source &) const;
+    };
+
 }
 
 #endif
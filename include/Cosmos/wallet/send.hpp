@@ -0,0 +1,35 @@
+#ifndef COSMOS_WALLET_SEND
+#define COSMOS_WALLET_SEND
+
+#include <Cosmos/wallet/batch.hpp>
+#include <Cosmos/wallet/split.hpp>
+
+namespace Cosmos {
+
+    // sign the txs of a spend and broadcast them. The wallet's account is
+    // updated for every tx that is accepted. If we cannot connect, or if
+    // the TXDB is null because we are offline, the txs go in the outbox
+    // and the account is updated right away so that their outputs are not
+    // spent again. The note on the outbox entry is an outgoing_payment so
+    // that a rejected payment can be undone.
+    // Throw account::cannot_apply_diff before anything is broadcast if the
+    // spend uses an output that the wallet doesn't have.
+    struct sent {
+        list<Bitcoin::TxID> TxIDs;
+        broadcast_tree_result Result;
+    };
+
+    awaitable<sent> send (controller &, cached_remote_TXDB *,
+        const std::string &wallet_name, const spend::spent &);
+
+    // the txs of a batch or split are signed in order, each
+    // one completing the txs that spend its outputs.
+    awaitable<sent> send (controller &, cached_remote_TXDB *,
+        const std::string &wallet_name, spend_batch::planned);
+
+    awaitable<sent> send (controller &, cached_remote_TXDB *,
+        const std::string &wallet_name, split::groups_result);
+
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <gigamonkey/redeem.hpp>
 
 #include <Cosmos/database.hpp>
+#include <Cosmos/wallet/size.hpp>
 
 #include <chrono>
 
@@ -73,14 +74,45 @@ namespace Cosmos {
             explicit transaction (const JSON &);
             explicit operator JSON () const;
 
-            uint64 expected_size () const;
+            // expected size and fee, to which more inputs and outputs can be added.
+            tx_size size () const;
+
+            uint64 expected_size () const {
+                return size ().size ();
+            }
+
             Bitcoin::satoshi spent () const;
             Bitcoin::satoshi sent () const;
-            Bitcoin::satoshi fee () const;
-            satoshis_per_byte fee_rate () const;
+
+            Bitcoin::satoshi fee () const {
+                return size ().fee ();
+            }
+
+            satoshis_per_byte fee_rate () const {
+                return size ().fee_rate ();
+            }
 
         };
 
+        tx_size inline transaction::size () const {
+            tx_size z {};
+            for (const input &in : Inputs) z.add_input (in.Prevout.Value, in.expected_size ());
+            for (const Bitcoin::output &o : Outputs) z.add_output (o);
+            return z;
+        }
+
+        Bitcoin::satoshi inline transaction::spent () const {
+            Bitcoin::satoshi x {0};
+            for (const input &in : Inputs) x += in.Prevout.Value;
+            return x;
+        }
+
+        Bitcoin::satoshi inline transaction::sent () const {
+            Bitcoin::satoshi x {0};
+            for (const Bitcoin::output &o : Outputs) x += o.Value;
+            return x;
+        }
+
     }
 
 }
@@ -0,0 +1,120 @@
+#ifndef COSMOS_WALLET_SIZE
+#define COSMOS_WALLET_SIZE
+
+#include <Cosmos/types.hpp>
+
+namespace Cosmos {
+
+    // the expected size and the fee of a tx as it is being designed. Inputs
+    // and outputs are added one at a time, so that we always know exactly
+    // how much the tx must pay without going over all of it again.
+    struct tx_size {
+        // value, script size and a pay to address script.
+        constexpr static uint64 PayToAddressOutputSize {34};
+
+        constexpr static uint64 VersionSize {4};
+        constexpr static uint64 LockTimeSize {4};
+
+        // size of the number of inputs or outputs.
+        constexpr static uint64 count_size (uint64 n) {
+            return n < 0xfd ? 1 : n <= 0xffff ? 3 : n <= 0xffffffff ? 5 : 9;
+        }
+
+        // size of a tx with the given number of pay to address outputs and
+        // no inputs yet, leaving room for the number of inputs to go up to max_inputs.
+        constexpr static uint64 pay_to_address_size (uint64 outputs, uint64 max_inputs) {
+            return VersionSize + LockTimeSize + count_size (max_inputs) + count_size (outputs) + outputs * PayToAddressOutputSize;
+        }
+
+        uint64 Inputs {0};
+        uint64 Outputs {0};
+
+        // not including the numbers of inputs and outputs.
+        uint64 InputsSize {0};
+        uint64 OutputsSize {0};
+
+        Bitcoin::satoshi Spent {0};
+        Bitcoin::satoshi Sent {0};
+
+        tx_size &add_input (Bitcoin::satoshi value, uint64 expected_input_size);
+        tx_size &remove_input (Bitcoin::satoshi value, uint64 expected_input_size);
+        tx_size &add_output (const Bitcoin::output &);
+
+        // an output that hasn't been made yet.
+        tx_size &add_output (Bitcoin::satoshi value, uint64 output_size);
+
+        // version, locktime, inputs and outputs.
+        uint64 size () const {
+            return VersionSize + LockTimeSize + count_size (Inputs) + InputsSize + count_size (Outputs) + OutputsSize;
+        }
+
+        Bitcoin::satoshi fee () const {
+            return Spent - Sent;
+        }
+
+        satoshis_per_byte fee_rate () const {
+            return satoshis_per_byte {fee (), size ()};
+        }
+
+        // the least fee that the tx can pay at the given rate.
+        Bitcoin::satoshi required_fee (satoshis_per_byte) const;
+
+        // how much more is spent than is sent and paid in fees at the given rate.
+        // Negative if the tx does not pay enough.
+        Bitcoin::satoshi excess (satoshis_per_byte fees) const {
+            return fee () - required_fee (fees);
+        }
+
+        // the fee to add an output or input of the given size at the given rate,
+        // including any growth in the number of outputs or inputs.
+        Bitcoin::satoshi output_fee (uint64 output_size, satoshis_per_byte) const;
+        Bitcoin::satoshi input_fee (uint64 expected_input_size, satoshis_per_byte) const;
+    };
+
+    tx_size inline &tx_size::add_input (Bitcoin::satoshi value, uint64 expected_input_size) {
+        Inputs++;
+        InputsSize += expected_input_size;
+        Spent += value;
+        return *this;
+    }
+
+    tx_size inline &tx_size::remove_input (Bitcoin::satoshi value, uint64 expected_input_size) {
+        Inputs--;
+        InputsSize -= expected_input_size;
+        Spent -= value;
+        return *this;
+    }
+
+    tx_size inline &tx_size::add_output (const Bitcoin::output &o) {
+        return add_output (o.Value, o.serialized_size ());
+    }
+
+    tx_size inline &tx_size::add_output (Bitcoin::satoshi value, uint64 output_size) {
+        Outputs++;
+        OutputsSize += output_size;
+        Sent += value;
+        return *this;
+    }
+
+    Bitcoin::satoshi inline tx_size::required_fee (satoshis_per_byte fees) const {
+        // round up.
+        return Bitcoin::satoshi {(int64 (fees.Satoshis) * int64 (size ()) + int64 (fees.Bytes) - 1) / int64 (fees.Bytes)};
+    }
+
+    Bitcoin::satoshi inline tx_size::output_fee (uint64 output_size, satoshis_per_byte fees) const {
+        tx_size next = *this;
+        next.Outputs++;
+        next.OutputsSize += output_size;
+        return next.required_fee (fees) - required_fee (fees);
+    }
+
+    Bitcoin::satoshi inline tx_size::input_fee (uint64 expected_input_size, satoshis_per_byte fees) const {
+        tx_size next = *this;
+        next.Inputs++;
+        next.InputsSize += expected_input_size;
+        return next.required_fee (fees) - required_fee (fees);
+    }
+
+}
+
+#endif
@@ -35,6 +35,10 @@ namespace Cosmos {
         double MinRedeemProportion {spend_options::DefaultMinRedeemProportion};
         double MaxRedeemProportion {spend_options::DefaultMaxRedeemProportion};
 
+        // if set, we first look for outputs that pay for the tx so closely
+        // that no change is needed. Select is used if there are none.
+        maybe<select_changeless> Changeless {};
+
         struct tx {
             nosig::transaction Transaction;
 
@@ -42,6 +46,10 @@ namespace Cosmos {
             map<Bitcoin::index, Bitcoin::outpoint> Remove;
 
             account_diff diff () const;
+
+            // the same tx with its first input spending the given outpoint. For a tx
+            // that spends an output of another tx that had not been signed when it was made.
+            tx first_spends (const Bitcoin::outpoint &) const;
         };
 
         struct spent {
@@ -1,6 +1,7 @@
 #ifndef COSMOS_WALLET_SPLIT
 #define COSMOS_WALLET_SPLIT
 
+#include <vector>
 #include <gigamonkey/timechain.hpp>
 #include <data/random.hpp>
 #include <Cosmos/wallet/spend.hpp>
@@ -8,6 +9,9 @@
 
 namespace Cosmos {
 
+    // an output of the given value to the current key of the key source.
+    redeemable pay_to_next_address (int64 value, const key_source &);
+
     // This is for splitting a wallet into tons of tiny outputs.
     struct split {
 
@@ -47,6 +51,86 @@ namespace Cosmos {
         result_outputs construct_outputs (data::random::source &r, const key_source &key,
             Bitcoin::satoshi split_value, double fee_rate) const;
 
+        // choose the values of the outputs without deriving any keys.
+        std::vector<int64> output_values (data::random::source &r, Bitcoin::satoshi split_value, double fee_rate) const;
+
+        // outputs with the same script, which are split in one tx.
+        struct group {
+            digest256 ScriptHash;
+            list<entry<Bitcoin::outpoint, redeemable>> Outputs;
+        };
+
+        // A big split does not fit in one tx, so we make a tree of txs. The
+        // root spends the outputs being split and each of its outputs is spent
+        // by another tx in the tree, down to the leaves, which make the outputs
+        // that we want. Only the outputs are constructed here.
+        struct tree_options {
+            // the biggest tx that we will make.
+            uint64 MaxTxSize {1000000};
+
+            uint32 MaxOutputsPerTx {10000};
+
+            // the most value that a leaf tx will hold, if there is a limit. This only
+            // applies to the leaves. A tx above them holds all the value of the txs
+            // below it, so at least the root will hold more than this.
+            maybe<Bitcoin::satoshi> MaxSatsPerTx {};
+
+            // the fees depend on the shape of the tree, which depends on the value of
+            // the last output, so we adjust it until the fees come out exactly. After
+            // this many tries, whatever is left over goes to the miner instead.
+            uint32 MaxFeeTries {8};
+
+            // threads to derive keys with.
+            uint32 Threads {0};
+        };
+
+        struct tree {
+            struct node {
+                // tx and output index that this tx spends. Nothing for the root.
+                maybe<std::pair<uint32, uint32>> Parent;
+
+                std::vector<redeemable> Outputs;
+
+                // for each output, the tx that spends it, if it is spent within the tree.
+                std::vector<maybe<uint32>> Children;
+            };
+
+            // parents come before their children, so the root is first.
+            std::vector<node> Transactions;
+
+            // last key used +1
+            uint32 Last;
+        };
+
+        // split_value should already have the fee for the inputs of the root taken out.
+        tree construct_tree (data::random::source &r, const key_source &key,
+            Bitcoin::satoshi split_value, double fee_rate, const tree_options &) const;
+
+        struct groups_result {
+            // parents come before their children. Most groups have one tx
+            // but one that is too big for that is split with a tree, root first.
+            list<spend::tx> Transactions;
+
+            // for each tx, the tx and output that its first input spends if that
+            // tx is here too. The outpoint isn't known until that tx is signed.
+            std::vector<maybe<std::pair<uint32, Bitcoin::index>>> Parents;
+
+            uint32 Last;
+
+            // call after each tx is signed, in order. The txs that spend its
+            // outputs are filled in and the diff for this tx is returned.
+            account_diff complete (uint32 index, const Bitcoin::TxID &);
+        };
+
+        // split every group at once on a pool of threads. Each group has its own
+        // random stream made from the seed and its script hash and keys are
+        // given out in order of the groups, so the result is the same no matter
+        // how the work is scheduled. A group that would make a tx bigger than
+        // the options allow is split with a tree. Those are made after the others,
+        // also in order, so their keys come last.
+        groups_result split_groups (redeem, const list<group> &, const key_source &,
+            const bytes &seed, satoshis_per_byte fees, const tree_options &) const;
+
         // we use this to make a
         math::log_triangular_distribution LogTriangular;
     };
@@ -57,7 +141,7 @@ namespace Cosmos {
         Bitcoin::satoshi MinimumCreateValue {spend_options::DefaultMinChangeSats};
 
         // construct a set of change outputs.
-        change operator () (const key_source &x, Bitcoin::satoshi sats, satoshis_per_byte fees, data::random::source &rand) const;
+        change operator () (const tx_size &, satoshis_per_byte fees, key_source, data::random::source &) const;
         using split::operator ();
 
         split_change_parameters (
@@ -441,7 +441,8 @@ std::ostream &help (std::ostream &o, command::method meth) {
             "\n\t(--max_look_ahead=)<integer> (= 10) ; (only used if parameter 'address' is provided as an xpub"
             "\n\t(--min_sats_per_output=<float>) (= " << Cosmos::spend_options::DefaultMinSatsPerOutput << ")"
             "\n\t(--max_sats_per_output=<float>) (= " << Cosmos::spend_options::DefaultMaxSatsPerOutput << ")"
-            "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::spend_options::DefaultMeanSatsPerOutput << ") ";
+            "\n\t(--mean_sats_per_output=<float>) (= " << Cosmos::spend_options::DefaultMeanSatsPerOutput << ") "
+            "\n\t(--concurrent) (split all scripts at once and broadcast them together)";
         case command::ENCRYPT_KEY:
             o << "Encrypt the private key file so that it can only be accessed with a password. No parameters.";
         case command::DECRYPT_KEY :
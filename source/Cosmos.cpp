@@ -13,6 +13,7 @@
 #include <Cosmos/wallet/split.hpp>
 #include <Cosmos/wallet/restore.hpp>
 #include <Cosmos/database/price_data.hpp>
+#include <Cosmos/database/proof.hpp>
 #include <Cosmos/options.hpp>
 #include <Cosmos/tax.hpp>
 #include <Cosmos/boost/miner_options.hpp>
@@ -199,7 +200,8 @@ void command_pay (const arg_parser &p) {
             throw exception {} << "pay to xpub not yet implemented";
         } else throw exception {} << "could not read payment address " << pr->Key;
         std::cout << " generating SPV proof " << std::endl;
-        maybe<SPV::proof> ppp = generate_proof (*u.local_txdb (),
+        proof_builder &proofs = u.local_txdb ()->proofs ();
+        maybe<SPV::proof> ppp = proofs (
             for_each ([] (const auto &e) -> Bitcoin::transaction {
                 return Bitcoin::transaction (e.first);
             }, spent.Transactions));
@@ -209,7 +211,7 @@ void command_pay (const arg_parser &p) {
         std::cout << "SPV proof generated containing " << ppp->Payment.size () <<
             " transactions and " << ppp->Proof.size () << " antecedents" << std::endl;
 
-        BEEF beef {*ppp};
+        BEEF beef {proofs.BEEF (*ppp)};
         std::cout << "Beef produced containing " << beef.Transactions.size () <<
             " transactions and " << beef.BUMPs.size () << " proofs" << std::endl;
 
@@ -232,6 +234,11 @@ void command_pay (const arg_parser &p) {
     } else std::cout << "please show this string to your seller and he will broadcast the payment if he accepts it:\n\t" <<
         encoding::base64::write (bytes (beef)) << std::endl;
 
+    // now that the payment is done, we make outputs for the next one.
+    e.update<void> ([opts] (Interface::writable u) {
+        refill_ready_pool (u, opts);
+    });
+
     delete pr;
 }
 
@@ -336,12 +343,22 @@ void command_taxes (const arg_parser &p) {
     read_watch_wallet_options (e, p);
 
     // then look in history for that time range.
-    e.update<void> ([&begin, &end] (Cosmos::Interface::writable u) {
+    e.update<void> ([&e, &begin, &end] (Cosmos::Interface::writable u) {
         auto *h = u.history ();
         if (h == nullptr) throw exception {} << "could not read wallet history";
 
+        auto *n = e.net ();
+        auto *local = u.local_price_data ();
+        if (n == nullptr || local == nullptr) throw exception {} << "could not read price data";
+
+        // get all the prices for the year at once rather than one day at a time.
+        price_service prices {*n, *local};
+        tax t = data::synced ([&] () -> awaitable<tax> {
+            co_return co_await tax::calculate (*u.txdb (), prices, h->get (begin, end));
+        });
+
         std::cout << "Tax implications: " << std::endl;
-        std::cout << tax::calculate (*u.txdb (), u.price_data (), h->get (begin, end)) << std::endl;
+        std::cout << t << std::endl;
     });
 }
 
@@ -1,12 +1,30 @@
 #include <Cosmos/Diophant.hpp>
+#include <atomic>
+#include <mutex>
 
 namespace Cosmos::diophant {
 
-    maybe<Diophant::machine> machine {};
+    std::atomic<bool> initialized {false};
+
+    // a machine can't be used by more than one thread at once, so each
+    // thread gets its own the first time it needs one. Keys are derived
+    // on many threads at once when we make a big split.
+    maybe<Diophant::machine> &machine () {
+        thread_local maybe<Diophant::machine> m {};
+        if (!bool (m) && initialized) {
+            static std::mutex making;
+            std::lock_guard<std::mutex> lock {making};
+            m = Diophant::initialize ();
+        }
+
+        return m;
+    }
 
     void initialize (ptr<controller>) {
-        if (bool (machine)) return;
-        machine = Diophant::initialize ();
+        if (initialized.exchange (true)) return;
+
+        // the machine for this thread.
+        machine ();
 
         // TODO set up functions
         // * key
@@ -20,23 +38,23 @@ namespace Cosmos::diophant {
 namespace Cosmos {
 
     key_expression to_private (const key_expression &) {
-        if (!bool (diophant::machine)) throw data::exception {} << "Diophant machine is not initialized";
+        if (!bool (diophant::machine ())) throw data::exception {} << "Diophant machine is not initialized";
         throw data::unimplemented {"to_private"};
     }
 
     bytes invert_hash (const bytes &digest) {
-        if (!bool (diophant::machine)) throw data::exception {} << "Diophant machine is not initialized";
+        if (!bool (diophant::machine ())) throw data::exception {} << "Diophant machine is not initialized";
         throw data::unimplemented {"invert_hash"};
     }
 
     key_expression key_derivation::operator () (const key_expression &k, int32 i) const {
-        if (!bool (diophant::machine)) throw data::exception {} << "Diophant machine is not initialized";
-        return std::string (diophant::machine->evaluate (Diophant::expression
+        if (!bool (diophant::machine ())) throw data::exception {} << "Diophant machine is not initialized";
+        return std::string (diophant::machine ()->evaluate (Diophant::expression
             {string::write (static_cast<const std::string &> (*this), " $ ", static_cast<const std::string &> (k), " $ ", i)}));
     }
 
     key_source::operator std::string () const {
-        if (!bool (diophant::machine)) throw data::exception {} << "Diophant machine is not initialized";
+        if (!bool (diophant::machine ())) throw data::exception {} << "Diophant machine is not initialized";
         throw data::unimplemented {"key_source::operator string"};
     }
 
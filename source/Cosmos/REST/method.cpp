@@ -80,7 +80,7 @@ namespace Cosmos::command {
             case method::NEXT: return o << "next";
             case method::GENERATE: return o << "generate";        // generate a wallet
             case method::RESTORE: return o << "restore";          // restore a wallet
-            case method::UPDATE: return o << "update";            // depricated: check if txs in pending have been mined.
+            case method::UPDATE: return o << "update";            // depricated: the server checks whether pending txs have been mined in the background.
             case method::SEND: return o << "send";                // (depricated)
             case method::SPEND: return o << "spend";              // check pending txs for having been mined. (depricated)
             case method::REQUEST: return o << "request";          // request a payment
@@ -1,7 +1,6 @@
 #include <Cosmos/database/SQLite/SQLite.hpp>
 #include <data/maybe.hpp>
 
-#include <gigamonkey/p2p/net_address.hpp>
 
 #include <sqlite_orm/sqlite_orm.h>
 #include <sqlite3.h>
@@ -329,6 +328,9 @@ namespace Cosmos::SQLite {
         optional<uint32_t> height;
         data::byte status;
 
+        // the last status returned by ARC when this tx was broadcast, as JSON.
+        optional<std::string> arc_status {};
+
         constexpr static const data::byte mined = data::byte (128);
         constexpr static const data::byte pending = data::byte (128 + 32 + 16 + 4 + 1);
     };
@@ -457,8 +459,27 @@ namespace Cosmos::SQLite {
         double price;
     };
 
+    struct Watermark {
+        std::string key;
+        uint64_t height;
+        int64_t mempool_checked;
+    };
+
+    // a tx whose scripts and those of its unconfirmed ancestors are good.
+    struct Validated {
+        Gigamonkey::digest256 hash;
+    };
+
+    // a tx that is waiting to be broadcast.
+    struct Outgoing {
+        int id;
+        // JSON as given by write (const outgoing &)
+        std::string entry;
+    };
+
     struct Connection {
-        Bitcoin::p2p::net_address net_address;
+        // ip:port
+        std::string net_address;
         bool success;
         uint64_t duration;
         uint64_t bytes_received;
@@ -494,7 +515,8 @@ namespace Cosmos::SQLite {
                 make_column ("hash", &Transaction::hash, primary_key ()),
                 make_column ("tx", &Transaction::tx),
                 make_column ("height", &Transaction::height),
-                make_column ("state", &Transaction::status)
+                make_column ("state", &Transaction::status),
+                make_column ("arc_status", &Transaction::arc_status)
             ),
 
             make_table ("redemptions",
@@ -547,8 +569,9 @@ namespace Cosmos::SQLite {
             ),
 
             make_table ("redeem_keys",
-                make_column ("prevout", &RedeemKey::prevout, primary_key ()),
-                make_column ("key", &RedeemKey::key)
+                make_column ("prevout", &RedeemKey::prevout),
+                make_column ("key", &RedeemKey::key),
+                primary_key (&RedeemKey::prevout, &RedeemKey::key)
             ),
 
             make_table ("wallets",
@@ -588,6 +611,30 @@ namespace Cosmos::SQLite {
                 make_column ("moved", &Event::moved)
             ),
 
+            make_table ("watermarks",
+                make_column ("key", &Watermark::key, primary_key ()),
+                make_column ("height", &Watermark::height),
+                make_column ("mempool_checked", &Watermark::mempool_checked)
+            ),
+
+            make_table ("validated",
+                make_column ("hash", &Validated::hash, primary_key ())
+            ),
+
+            make_table ("outbox",
+                make_column ("id", &Outgoing::id, primary_key ().autoincrement ()),
+                make_column ("entry", &Outgoing::entry)
+            ),
+
+            make_table ("connections",
+                make_column ("net_address", &Connection::net_address, primary_key ()),
+                make_column ("success", &Connection::success),
+                make_column ("duration", &Connection::duration),
+                make_column ("bytes_received", &Connection::bytes_received),
+                make_column ("bytes_sent", &Connection::bytes_sent),
+                make_column ("friendship_score", &Connection::friendship_score)
+            ),
+
             make_index ("idx_prices", &Price::unit, &Price::timestamp),
 
             make_table ("prices",
@@ -864,6 +911,49 @@ namespace Cosmos::SQLite {
             insert (Transaction {tx.id (), tx.write (), {}, Transaction::pending});
         }
 
+        // straight from the row without decoding the tx.
+        maybe<bytes> raw_transaction (const Bitcoin::TxID &txid) final override {
+            auto rows = storage.select (columns (&Transaction::tx), where (is_equal (&Transaction::hash, txid)), limit (1));
+            if (rows.empty ()) return {};
+            return std::get<0> (rows.front ());
+        }
+
+        list<Bitcoin::TxID> insert_proofs (std::span<const Merkle::proof> proofs) final override {
+            list<Bitcoin::TxID> rejected;
+            atomically ([&] {
+                rejected = local_TXDB::insert_proofs (proofs);
+            });
+
+            return rejected;
+        }
+
+        // one sqlite transaction for the whole batch rather than one per row.
+        void import_transactions (list<std::pair<Bitcoin::transaction, maybe<Merkle::proof>>> txs) final override {
+            atomically ([&] {
+                local_TXDB::import_transactions (txs);
+            });
+        }
+
+        // sqlite cannot nest transactions, so an inner call joins the outer one.
+        bool InTransaction {false};
+
+        template <typename fun> void atomically (fun f) {
+            if (InTransaction) return f ();
+
+            InTransaction = true;
+            try {
+                storage.transaction ([&] () -> bool {
+                    f ();
+                    return true;
+                });
+            } catch (...) {
+                InTransaction = false;
+                throw;
+            }
+
+            InTransaction = false;
+        }
+
         // get txids for transactions without Merkle proofs.
         data::set<Bitcoin::TxID> unconfirmed () final override {
             auto rows = storage.select (
@@ -886,6 +976,80 @@ namespace Cosmos::SQLite {
             }
         }
 
+        void set_broadcast_status (const Bitcoin::TxID &txid, const JSON &status) final override {
+            storage.update_all (
+                sqlite_orm::set (assign (&Transaction::arc_status, optional<std::string> {status.dump ()})),
+                where (is_equal (&Transaction::hash, txid)));
+        }
+
+        maybe<JSON> get_broadcast_status (const Bitcoin::TxID &txid) final override {
+            auto rows = storage.select (
+                columns (&Transaction::arc_status),
+                where (is_equal (&Transaction::hash, txid)), limit (1));
+
+            if (rows.empty () || !bool (std::get<0> (rows.front ()))) return {};
+
+            return JSON::parse (*std::get<0> (rows.front ()));
+        }
+
+        void set_watermark (const std::string &key, const watermark &w) final override {
+            storage.replace (Watermark {key, w.Height, int64_t (w.MempoolChecked.Value)});
+        }
+
+        maybe<watermark> get_watermark (const std::string &key) final override {
+            auto rows = storage.select (
+                columns (&Watermark::height, &Watermark::mempool_checked),
+                where (is_equal (&Watermark::key, key)), limit (1));
+
+            if (rows.empty ()) return {};
+
+            return watermark {std::get<0> (rows.front ()), Bitcoin::timestamp (uint32 (std::get<1> (rows.front ())))};
+        }
+
+        bool validated (const Bitcoin::TxID &txid) final override {
+            return storage.count<Validated> (where (is_equal (&Validated::hash, txid))) > 0;
+        }
+
+        void set_validated (const Bitcoin::TxID &txid) final override {
+            storage.replace (Validated {txid});
+        }
+
+        uint64 queue_outgoing (const outgoing &o) final override {
+            return storage.insert (Outgoing {-1, write (o).dump ()});
+        }
+
+        list<entry<uint64, outgoing>> get_outgoing () final override {
+            list<entry<uint64, outgoing>> x;
+            for (const Outgoing &o : storage.get_all<Outgoing> (order_by (&Outgoing::id)))
+                x <<= entry<uint64, outgoing> {uint64 (o.id), read_outgoing (JSON::parse (o.entry))};
+            return x;
+        }
+
+        void remove_outgoing (uint64 id) final override {
+            storage.remove_all<Outgoing> (where (is_equal (&Outgoing::id, int (id))));
+        }
+
+        list<peer_record> peers (uint32 max) final override {
+            auto rows = storage.get_all<Connection> (
+                order_by (&Connection::friendship_score).desc (), limit (int (max)));
+
+            list<peer_record> result;
+            for (const Connection &c : rows) result <<= peer_record {c.net_address,
+                c.success, c.duration, c.bytes_received, c.bytes_sent, c.friendship_score};
+            return result;
+        }
+
+        maybe<peer_record> peer (const std::string &address) final override {
+            auto rows = storage.get_all<Connection> (where (is_equal (&Connection::net_address, address)), limit (1));
+            if (rows.empty ()) return {};
+            const Connection &c = rows.front ();
+            return peer_record {c.net_address, c.success, c.duration, c.bytes_received, c.bytes_sent, c.friendship_score};
+        }
+
+        void set_peer (const peer_record &p) final override {
+            storage.replace (Connection {p.Address, p.Success, p.Duration, p.BytesReceived, p.BytesSent, p.FriendshipScore});
+        }
+
         event redeeming (const Bitcoin::outpoint &o) final override {
             auto redeem_rows = storage.select (
                 columns (&Redemption::inpoint),
@@ -995,6 +1159,20 @@ namespace Cosmos::SQLite {
             storage.insert (Price {-1, mu.str (), t.Value, price});
         }
 
+        void set_prices (monetary_unit u, data::map<Bitcoin::timestamp, double> prices) final override {
+            std::stringstream mu;
+            mu << u;
+            storage.transaction ([&] {
+                for (const auto &[t, price] : prices) try {
+                    storage.insert (Price {-1, mu.str (), t.Value, price});
+                } catch (const std::system_error &e) {
+                    // means the row already exits.
+                }
+
+                return true;
+            });
+        }
+
         /*
             keys and hashes
         */
@@ -1257,9 +1435,60 @@ namespace Cosmos::SQLite {
         };
 
         Cosmos::account get_wallet_account (const std::string &wallet_name) final override {
-            throw data::unimplemented {"SQLite::get_wallet_account"};
+            Cosmos::account::builder acc {Cosmos::account {}};
+
+            // many outputs may come from the same tx, so we only read each tx once.
+            std::map<Bitcoin::TxID, Bitcoin::transaction> txs;
+            for (const Bitcoin::outpoint &op : storage.select (&WalletOutput::outpoint,
+                where (c (&WalletOutput::wallet_name) == wallet_name))) {
+
+                auto t = txs.find (op.Digest);
+                if (t == txs.end ()) {
+                    maybe<bytes> raw = raw_transaction (op.Digest);
+                    if (!bool (raw)) throw data::exception {} << "corrupt database: no tx for wallet output " << op;
+                    t = txs.emplace (op.Digest, Bitcoin::transaction {*raw}).first;
+                }
+
+                auto re = storage.select (
+                    columns (&Redeemable::expected_input_script_size, &Redeemable::input_script_so_far),
+                    where (is_equal (&Redeemable::prevout, op)), limit (1));
+
+                if (re.empty ()) throw data::exception {} << "corrupt database: cannot redeem wallet output " << op;
+
+                data::list<key_expression> keys;
+                for (const std::string &k : storage.select (&RedeemKey::key, where (is_equal (&RedeemKey::prevout, op))))
+                    keys <<= key_expression {k};
+
+                acc.insert (op, redeemable {t->second.Outputs[op.Index], keys,
+                    std::get<0> (re.front ()), std::get<1> (re.front ())});
+            }
+
+            return acc.freeze ();
         };
 
+        void update_wallet_account (const std::string &wallet_name, data::list<Cosmos::account_diff> diffs) final override {
+            atomically ([&] {
+                for (const Cosmos::account_diff &d : diffs) {
+                    for (const auto &[_, op] : d.Remove) {
+                        if (storage.count<WalletOutput> (where (is_equal (&WalletOutput::outpoint, op) &&
+                            c (&WalletOutput::wallet_name) == wallet_name)) == 0)
+                            throw Cosmos::account::cannot_apply_diff {};
+
+                        storage.remove_all<WalletOutput> (where (is_equal (&WalletOutput::outpoint, op)));
+                        storage.remove_all<Redeemable> (where (is_equal (&Redeemable::prevout, op)));
+                        storage.remove_all<RedeemKey> (where (is_equal (&RedeemKey::prevout, op)));
+                    }
+
+                    for (const auto &[i, re] : d.Insert) {
+                        Bitcoin::outpoint op {d.TxID, i};
+                        storage.replace (WalletOutput {op, wallet_name});
+                        storage.replace (Redeemable {op, re.ExpectedScriptSize, re.UnlockScriptSoFar});
+                        for (const key_expression &k : re.Keys) storage.replace (RedeemKey {op, std::string (k)});
+                    }
+                }
+            });
+        }
+
     };
 
     ptr<controller> load (const data::maybe<filepath> &fzf) {
@@ -0,0 +1,353 @@
+#include <Cosmos/database/import.hpp>
+#include <Cosmos/database/validate.hpp>
+#include <Cosmos/serialize.hpp>
+#include <algorithm>
+
+namespace Cosmos {
+
+    namespace {
+
+        // the first four bytes of a BEEF, read as a little-endian number.
+        constexpr uint32 BEEF_V1 = 0xEFBE0001;
+        constexpr uint32 BEEF_V2 = 0xEFBE0002;
+
+        // an atomic BEEF starts with this and the txid of the payment.
+        constexpr uint32 atomic_BEEF = 0x01010101;
+
+        // end_of_input means that we need more bytes to read the next element.
+        struct reader : serialize::reader {
+            using serialize::reader::reader;
+
+            Bitcoin::TxID read_TxID () {
+                Bitcoin::TxID id;
+                auto x = read (32);
+                std::copy (x.begin (), x.end (), id.begin ());
+                return id;
+            }
+
+            // we find out how long a tx or BUMP is by reading over it.
+            Merkle::BUMP read_BUMP () {
+                size_t start = Position;
+                read_var_int ();
+                uint64 tree_height = read_uint (1);
+                if (tree_height > 64) throw data::exception {} << "invalid BUMP in BEEF";
+
+                for (uint64 level = 0; level < tree_height; level++) {
+                    uint64 leaves = read_var_int ();
+                    for (uint64 i = 0; i < leaves; i++) {
+                        read_var_int ();
+                        // flag 1 means the hash is a duplicate and is not given.
+                        if (read_uint (1) != 1) read (32);
+                    }
+                }
+
+                return Merkle::BUMP {bytes (Bytes.range (start, Position))};
+            }
+
+            Bitcoin::transaction read_transaction () {
+                size_t start = Position;
+                read (4);
+
+                uint64 inputs = read_var_int ();
+                for (uint64 i = 0; i < inputs; i++) {
+                    read (36);
+                    read (read_var_int ());
+                    read (4);
+                }
+
+                uint64 outputs = read_var_int ();
+                for (uint64 i = 0; i < outputs; i++) {
+                    read (8);
+                    read (read_var_int ());
+                }
+
+                read (4);
+
+                Bitcoin::transaction tx {bytes (Bytes.range (start, Position))};
+                if (!tx.valid ()) throw data::exception {} << "invalid tx in BEEF";
+                return tx;
+            }
+        };
+    }
+
+    list<BEEF_stream::element> BEEF_stream::feed (data::byte_slice b) {
+        Buffer.insert (Buffer.end (), b.begin (), b.end ());
+
+        list<element> elements;
+        size_t consumed = 0;
+
+        // each step reads a whole element or nothing.
+        try {
+            while (Stage != stage::done) {
+                reader r {data::byte_slice (Buffer), consumed};
+
+                if (Stage == stage::version) {
+                    uint32 version = r.read_uint (4);
+                    if (version == atomic_BEEF) {
+                        r.read (32);
+                        version = r.read_uint (4);
+                    }
+
+                    if (version != BEEF_V1 && version != BEEF_V2) throw data::exception {} << "not a BEEF";
+
+                    Version = version;
+                    Remaining = r.read_var_int ();
+                    Stage = stage::BUMPs;
+                } else if (Stage == stage::BUMPs) {
+                    if (Remaining == 0) {
+                        Remaining = r.read_var_int ();
+                        Stage = stage::txs;
+                    } else {
+                        elements <<= element {r.read_BUMP ()};
+                        Remaining--;
+                    }
+                } else if (Remaining == 0) Stage = stage::done;
+                else if (Version == BEEF_V1) {
+                    Bitcoin::transaction t = r.read_transaction ();
+                    maybe<uint64> bump_index;
+                    if (r.read_uint (1) == 1) bump_index = r.read_var_int ();
+                    elements <<= element {tx {t.id (), t, bump_index}};
+                    Remaining--;
+                } else {
+                    byte format = r.read_uint (1);
+                    if (format == 2) elements <<= element {tx {r.read_TxID (), {}, {}}};
+                    else if (format == 1) {
+                        uint64 bump_index = r.read_var_int ();
+                        Bitcoin::transaction t = r.read_transaction ();
+                        elements <<= element {tx {t.id (), t, bump_index}};
+                    } else if (format == 0) {
+                        Bitcoin::transaction t = r.read_transaction ();
+                        elements <<= element {tx {t.id (), t, {}}};
+                    } else throw data::exception {} << "invalid tx format in BEEF";
+                    Remaining--;
+                }
+
+                consumed = r.Position;
+            }
+        } catch (const serialize::end_of_input &) {}
+
+        Buffer.erase (Buffer.begin (), Buffer.begin () + consumed);
+        if (Stage == stage::done && Buffer.size () > 0) throw data::exception {} << "extra bytes after BEEF";
+
+        return elements;
+    }
+
+    BEEF_importer::result::operator JSON () const {
+        JSON::array_t accepted;
+        for (const auto &txid : Accepted) accepted.push_back (write (txid));
+
+        JSON::array_t known;
+        for (const auto &txid : Known) known.push_back (write (txid));
+
+        JSON::object_t rejected;
+        for (const auto &[txid, why] : Rejected) rejected[write (txid)] = why;
+
+        return JSON::object_t {{"accepted", accepted}, {"known", known}, {"rejected", rejected}};
+    }
+
+    BEEF_importer::BEEF_importer (local_TXDB &local, SPV::database &headers, const options &o):
+        Local {local}, Headers {headers}, Options {o}, Stream {},
+        BUMPs {}, Pending {}, Batch {}, Seen {}, Result {} {}
+
+    void BEEF_importer::feed (data::byte_slice b) {
+        for (const auto &e : Stream.feed (b)) {
+            if (e.is<Merkle::BUMP> ()) accept (e.get<Merkle::BUMP> ());
+            else accept (e.get<BEEF_stream::tx> ());
+
+            if (Pending.size () >= Options.BatchSize) flush ();
+        }
+    }
+
+    BEEF_importer::result BEEF_importer::finish () {
+        if (!Stream.complete ()) throw data::exception {} << "incomplete BEEF";
+        flush ();
+        return Result;
+    }
+
+    void BEEF_importer::accept (const Merkle::BUMP &bump) {
+        auto paths = bump.paths ();
+
+        // every path in a BUMP leads to the same root, so we only need one of them.
+        for (const auto &[txid, path] : paths) {
+            digest256 root = Merkle::branch {txid, path}.root ();
+            auto h = Headers.header (N (bump.BlockHeight));
+            if (bool (h) && h->Value.MerkleRoot == root) {
+                BUMPs.push_back (Merkle::dual {paths, root});
+                return;
+            }
+
+            break;
+        }
+
+        DATA_LOG (warning) << "BUMP at height " << bump.BlockHeight << " does not match our headers";
+        BUMPs.push_back ({});
+    }
+
+    void BEEF_importer::accept (const BEEF_stream::tx &t) {
+        if (Seen.contains (t.TxID)) return;
+        Seen.insert (t.TxID);
+
+        auto db_entry = Local.transaction (t.TxID);
+
+        // only the txid was given, so we must already have it.
+        if (!bool (t.Transaction)) {
+            if (db_entry.Transaction == nullptr) reject (t.TxID, "tx is not given and we do not have it");
+            else Result.Known <<= t.TxID;
+            return;
+        }
+
+        maybe<Merkle::proof> proof;
+        if (bool (t.BUMPIndex)) {
+            if (*t.BUMPIndex >= BUMPs.size () || !bool (BUMPs[*t.BUMPIndex]))
+                return reject (t.TxID, "BUMP does not match our headers");
+
+            const Merkle::dual &dual = *BUMPs[*t.BUMPIndex];
+            auto path = dual.Paths.contains (t.TxID);
+            if (!bool (path)) return reject (t.TxID, "tx is not in its BUMP");
+
+            // we only checked one path of the BUMP against the header, so we check this one too.
+            Merkle::branch branch {t.TxID, *path};
+            if (branch.root () != dual.Root) return reject (t.TxID, "proof does not lead to the root of its block");
+
+            proof = Merkle::proof {branch, dual.Root};
+        }
+
+        // nothing new here.
+        if (db_entry.Transaction != nullptr && (!bool (proof) || db_entry.Confirmation.valid ())) {
+            Result.Known <<= t.TxID;
+            return;
+        }
+
+        auto tx = std::make_shared<const Bitcoin::transaction> (*t.Transaction);
+        Pending.push_back (pending {t.TxID, tx, proof});
+        Batch[t.TxID] = tx;
+    }
+
+    void BEEF_importer::reject (const Bitcoin::TxID &txid, const std::string &why) {
+        DATA_LOG (debug) << "rejected tx " << txid << " from BEEF: " << why;
+        Result.Rejected = Result.Rejected.insert (txid, why);
+    }
+
+    void BEEF_importer::flush () {
+        if (Pending.empty ()) return;
+
+        // Look up the outputs that unmined txs spend and check their scripts all at once.
+        // Mined txs are checked by their proofs. Scripts don't depend on whether
+        // the parent is good, so all txs in the batch can be checked together.
+        std::vector<extended_transaction> unchecked;
+        std::vector<size_t> slot (Pending.size (), 0);
+        std::vector<maybe<std::string>> problems (Pending.size ());
+
+        for (size_t i = 0; i < Pending.size (); i++) {
+            const pending &p = Pending[i];
+            if (bool (p.Proof)) continue;
+
+            list<Gigamonkey::extended::input> inputs;
+            for (const Bitcoin::input &in : p.Transaction->Inputs) {
+                const Bitcoin::TxID &parent_id = in.Reference.Digest;
+                if (Result.Rejected.contains (parent_id)) {
+                    problems[i] = "spends a rejected tx";
+                    break;
+                }
+
+                ptr<const Bitcoin::transaction> parent;
+                if (auto x = Batch.find (parent_id); x != Batch.end ()) parent = x->second;
+                else parent = Local.transaction (parent_id).Transaction;
+
+                if (parent == nullptr || in.Reference.Index >= parent->Outputs.size ()) {
+                    problems[i] = "spends an output that is not in the BEEF or in our database";
+                    break;
+                }
+
+                inputs <<= Gigamonkey::extended::input {parent->Outputs[in.Reference.Index], in};
+            }
+
+            if (bool (problems[i])) continue;
+
+            slot[i] = unchecked.size ();
+            unchecked.push_back (extended_transaction {p.Transaction->Version, inputs, p.Transaction->Outputs, p.Transaction->LockTime});
+        }
+
+        std::vector<bool> valid = check_scripts (unchecked);
+
+        std::set<Bitcoin::TxID> proven;
+        for (const pending &p : Pending) if (bool (p.Proof)) proven.insert (p.TxID);
+
+        // unmined txs whose scripts are good, along with their parents in this batch.
+        // They are validated once we know that those parents are proven or validated.
+        list<std::pair<Bitcoin::TxID, list<Bitcoin::TxID>>> grounded_txs;
+        std::set<Bitcoin::TxID> grounded_ids;
+
+        // collect the results in order so that parents are decided before their children.
+        list<std::pair<Bitcoin::transaction, maybe<Merkle::proof>>> accepted;
+        for (size_t i = 0; i < Pending.size (); i++) {
+            const pending &p = Pending[i];
+
+            if (bool (problems[i])) {
+                reject (p.TxID, *problems[i]);
+                continue;
+            }
+
+            if (!bool (p.Proof)) {
+                if (!valid[slot[i]]) {
+                    reject (p.TxID, "invalid script");
+                    continue;
+                }
+
+                // a parent in the same batch may have just been rejected.
+                bool orphan = false;
+                // whether every parent is mined or has been validated.
+                bool grounded = true;
+                list<Bitcoin::TxID> batch_parents;
+                for (const Bitcoin::input &in : p.Transaction->Inputs) {
+                    const Bitcoin::TxID &parent_id = in.Reference.Digest;
+                    if (Result.Rejected.contains (parent_id)) {
+                        orphan = true;
+                        break;
+                    }
+
+                    if (proven.contains (parent_id) || grounded_ids.contains (parent_id)) batch_parents <<= parent_id;
+                    else if (!Local.validated (parent_id) && !Local.transaction (parent_id).confirmed ()) grounded = false;
+                }
+
+                if (orphan) {
+                    reject (p.TxID, "spends a rejected tx");
+                    continue;
+                }
+
+                if (grounded) {
+                    grounded_txs <<= std::pair<Bitcoin::TxID, list<Bitcoin::TxID>> {p.TxID, batch_parents};
+                    grounded_ids.insert (p.TxID);
+                }
+            }
+
+            accepted <<= std::pair<Bitcoin::transaction, maybe<Merkle::proof>> {*p.Transaction, p.Proof};
+            Result.Accepted <<= p.TxID;
+        }
+
+        Local.import_transactions (accepted);
+
+        // txs in this batch that are mined or validated. A proof
+        // that checked out may still fail to be stored.
+        std::set<Bitcoin::TxID> settled;
+        for (const Bitcoin::TxID &txid : proven)
+            if (Local.transaction (txid).confirmed ()) settled.insert (txid);
+            else if (!Result.Rejected.contains (txid))
+                DATA_LOG (warning) << "the proof of tx " << txid << " from BEEF could not be stored";
+
+        // remember these so that we don't run their scripts again when we broadcast or
+        // prove them. They are in order, so parents are decided before their children.
+        for (const auto &[txid, parents] : grounded_txs) {
+            bool grounded = true;
+            for (const Bitcoin::TxID &parent_id : parents) if (!settled.contains (parent_id)) grounded = false;
+            if (!grounded) continue;
+
+            Local.set_validated (txid);
+            settled.insert (txid);
+        }
+
+        Pending.clear ();
+        Batch.clear ();
+    }
+
+}
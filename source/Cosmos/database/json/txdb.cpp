@@ -65,6 +65,16 @@ namespace Cosmos {
         JSON::object_t redeems;
         for (const auto &[key, value] : this->RedeemIndex) redeems[write (key)] = write (value);
 
+        JSON::object_t watermarks;
+        for (const auto &[key, value] : this->Watermarks)
+            watermarks[key] = JSON::object_t {{"height", value.Height}, {"mempool_checked", uint32 (value.MempoolChecked)}};
+
+        JSON::object_t outbox;
+        for (const auto &[id, value] : this->Outbox) outbox[std::to_string (id)] = write (value);
+
+        JSON::array_t validated;
+        for (const auto &txid : this->Validated) validated.push_back (write (txid));
+
         JSON::object_t o;
         o["by_height"] = by_height;
         o["by_hash"] = by_hash;
@@ -74,6 +84,9 @@ namespace Cosmos {
         o["scripts"] = scripts;
         o["redeems"] = redeems;
         o["unconfirmed"] = unconfirmed;
+        o["watermarks"] = watermarks;
+        o["outbox"] = outbox;
+        o["validated"] = validated;
         return o;
     }
 
@@ -156,6 +169,16 @@ namespace Cosmos {
         for (const auto &[key, value] : redeems.items ())
             this->RedeemIndex[read_outpoint (key)] = inpoint {read_outpoint (std::string (value))};
 
+        // older files don't have watermarks.
+        if (j.contains ("watermarks")) for (const auto &[key, value] : j["watermarks"].items ())
+            this->Watermarks[key] = watermark {uint64 (value["height"]), Bitcoin::timestamp (uint32 (value["mempool_checked"]))};
+
+        if (j.contains ("outbox")) for (const auto &[key, value] : j["outbox"].items ())
+            this->Outbox[std::stoull (key)] = read_outgoing (value);
+
+        if (j.contains ("validated")) for (const auto &txid : j["validated"])
+            this->Validated.insert (read_TxID (std::string (txid)));
+
         // Here is another issue relating to changes in format.
         // We used to have a map address => outpoint
         // However, now the map is address => script hash.
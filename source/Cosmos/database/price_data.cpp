@@ -5,9 +5,11 @@ namespace Cosmos {
 
     maybe<double> remote_price_data::get_price (monetary_unit u, const Bitcoin::timestamp &t) {
         try {
-            return data::synced (&network::price, &Net, u, t);
+            return data::synced (&network::price, &Net, u, t, priority::interactive);
         } catch (const net::HTTP::exception &) {
             return {};
+        } catch (const data::exception &) {
+            return {};
         }
     }
 
@@ -20,6 +22,51 @@ namespace Cosmos {
         return p;
     }
 
+    awaitable<maybe<double>> price_service::get_price (monetary_unit u, const Bitcoin::timestamp &t) {
+        auto v = Local.get_price (u, t);
+        if (bool (v)) co_return *v;
+
+        double p;
+        try {
+            p = co_await Net.price (u, t);
+        } catch (const net::HTTP::exception &) {
+            co_return maybe<double> {};
+        } catch (const data::exception &) {
+            co_return maybe<double> {};
+        }
+
+        Local.set_price (u, t, p);
+        co_return p;
+    }
+
+    awaitable<uint32> price_service::prefetch (monetary_unit u, const Bitcoin::timestamp &from, const Bitcoin::timestamp &to) {
+        uint32 first_day = uint32 (from) - uint32 (from) % price_data::OneDay;
+        uint32 last_day = uint32 (to) - uint32 (to) % price_data::OneDay;
+
+        // find the days we don't know yet.
+        set<Bitcoin::timestamp> missing;
+        uint32 first_missing = last_day;
+        uint32 last_missing = first_day;
+        for (uint32 day = first_day; day <= last_day; day += price_data::OneDay)
+            if (!bool (Local.get_price (u, Bitcoin::timestamp {day}))) {
+                missing = missing.insert (Bitcoin::timestamp {day});
+                if (day < first_missing) first_missing = day;
+                last_missing = day;
+            }
+
+        if (data::empty (missing)) co_return 0;
+
+        map<Bitcoin::timestamp, double> fetched = co_await Net.prices (u,
+            Bitcoin::timestamp {first_missing}, Bitcoin::timestamp {last_missing + price_data::OneDay});
+
+        map<Bitcoin::timestamp, double> new_prices;
+        for (const auto &[day, price] : fetched)
+            if (missing.contains (day)) new_prices = new_prices.insert (day, price);
+
+        Local.set_prices (u, new_prices);
+        co_return new_prices.size ();
+    }
+
     maybe<double> ask_for_price_data::get_price (monetary_unit u, const Bitcoin::timestamp &t) {
         std::stringstream ss;
         ss << "What was BSV/USD on " << t << std::endl;
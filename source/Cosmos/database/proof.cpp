@@ -0,0 +1,154 @@
+#include <Cosmos/database/proof.hpp>
+#include <Cosmos/serialize.hpp>
+#include <gigamonkey/merkle/BUMP.hpp>
+#include <functional>
+
+namespace Cosmos {
+
+    namespace {
+        // 0100BEEF
+        constexpr uint32 BEEF_V1 = 0xEFBE0001;
+
+        using namespace serialize;
+    }
+
+    ptr<SPV::proof::node> proof_builder::node (const Bitcoin::TxID &txid) {
+        if (auto x = Nodes.find (txid); x != Nodes.end ()) return x->second;
+
+        auto tx = DB.transaction (txid);
+        if (!tx.valid ()) return nullptr;
+
+        ptr<SPV::proof::node> n;
+        if (tx.confirmed ()) n = std::make_shared<SPV::proof::node> (*tx.Transaction, SPV::proof::tree (tx.Confirmation));
+        else {
+            auto m = parents (*tx.Transaction, {});
+            if (!bool (m)) return nullptr;
+            n = std::make_shared<SPV::proof::node> (*tx.Transaction, SPV::proof::tree (*m));
+        }
+
+        Nodes[txid] = n;
+        return n;
+    }
+
+    maybe<SPV::proof::map> proof_builder::parents (const Bitcoin::transaction &tx, const std::set<Bitcoin::TxID> &skip) {
+        SPV::proof::map m;
+        for (const Bitcoin::input &in : tx.Inputs) {
+            const Bitcoin::TxID &parent = in.Reference.Digest;
+            if (skip.contains (parent) || m.contains (parent)) continue;
+
+            auto n = node (parent);
+            if (n == nullptr) return {};
+            m = m.insert (parent, n);
+        }
+
+        return m;
+    }
+
+    maybe<SPV::proof> proof_builder::operator () (list<Bitcoin::transaction> payment) {
+        if (Nodes.size () > MaxCached) {
+            Nodes.clear ();
+            Raw.clear ();
+        }
+
+        DB.prefetch_ancestors (payment);
+
+        // payment txs that spend earlier ones in the payment don't need proofs for them.
+        std::set<Bitcoin::TxID> in_payment;
+        SPV::proof::map m;
+        for (const auto &tx : payment) {
+            auto p = parents (tx, in_payment);
+            if (!bool (p)) return {};
+            for (const auto &[txid, n] : *p) if (!m.contains (txid)) m = m.insert (txid, n);
+            in_payment.insert (tx.id ());
+        }
+
+        return SPV::proof {payment, m};
+    }
+
+    const bytes &proof_builder::raw (const Bitcoin::TxID &txid, const Bitcoin::transaction &tx) {
+        if (auto x = Raw.find (txid); x != Raw.end ()) return x->second;
+        maybe<bytes> b = DB.raw_transaction (txid);
+        return Raw[txid] = bool (b) ? *b : bytes (tx);
+    }
+
+    void proof_builder::forget (const Bitcoin::TxID &txid) {
+        if (Nodes.erase (txid) == 0) return;
+
+        // unconfirmed txs that we have cached keep the old proof of
+        // this one under them, so they must be forgotten too.
+        list<Bitcoin::TxID> children;
+        for (const auto &[id, n] : Nodes)
+            if (n->Proof.is<SPV::proof::map> () && n->Proof.get<SPV::proof::map> ().contains (txid)) children <<= id;
+
+        for (const Bitcoin::TxID &child : children) forget (child);
+    }
+
+    maybe<bytes> proof_builder::BEEF (list<Bitcoin::transaction> payment) {
+        auto p = (*this) (payment);
+        if (!bool (p)) return {};
+        return BEEF (*p);
+    }
+
+    bytes proof_builder::BEEF (const SPV::proof &p) {
+        // all txs, parents first, and the BUMP of each confirmed tx.
+        list<std::pair<Bitcoin::TxID, const Bitcoin::transaction *>> ordered;
+        std::map<Bitcoin::TxID, uint64> height_of;
+        std::set<Bitcoin::TxID> seen;
+
+        // one BUMP per block, containing the paths of all our txs in that block.
+        std::map<uint64, Merkle::dual> blocks;
+
+        std::function<void (const SPV::proof::map &)> visit = [&] (const SPV::proof::map &m) {
+            for (const auto &[txid, pn] : m) {
+                if (seen.contains (txid)) continue;
+                seen.insert (txid);
+
+                if (pn->Proof.is<SPV::confirmation> ()) {
+                    const auto &conf = pn->Proof.get<SPV::confirmation> ();
+                    auto h = DB.header (conf.Header.hash ());
+                    if (!bool (h)) throw data::exception {} << "no header for confirmed tx " << txid;
+
+                    uint64 height = uint64 (h->Key);
+                    auto b = blocks.find (height);
+                    if (b == blocks.end ()) b = blocks.emplace (height,
+                        Merkle::dual {decltype (Merkle::dual::Paths) {}, conf.Header.MerkleRoot}).first;
+
+                    b->second = b->second + Merkle::proof {Merkle::branch {txid, conf.Path}, conf.Header.MerkleRoot};
+                    height_of[txid] = height;
+                } else visit (pn->Proof.get<SPV::proof::map> ());
+
+                ordered <<= std::pair<Bitcoin::TxID, const Bitcoin::transaction *> {txid, &pn->Transaction};
+            }
+        };
+
+        visit (p.Proof);
+
+        std::map<uint64, uint64> bump_index;
+        bytes beef;
+        write_uint (beef, BEEF_V1, 4);
+        write_var_int (beef, blocks.size ());
+        uint64 next_index = 0;
+        for (const auto &[height, dual] : blocks) {
+            bump_index[height] = next_index++;
+            write_bytes (beef, bytes (Merkle::BUMP {height, dual.Paths}));
+        }
+
+        write_var_int (beef, ordered.size () + p.Payment.size ());
+        for (const auto &[txid, tx] : ordered) {
+            write_bytes (beef, raw (txid, *tx));
+            if (auto h = height_of.find (txid); h != height_of.end ()) {
+                write_uint (beef, 1, 1);
+                write_var_int (beef, bump_index[h->second]);
+            } else write_uint (beef, 0, 1);
+        }
+
+        // the payment itself is not in the database yet.
+        for (const Bitcoin::transaction &tx : p.Payment) {
+            write_bytes (beef, bytes (tx));
+            write_uint (beef, 0, 1);
+        }
+
+        return beef;
+    }
+
+}
@@ -1,6 +1,9 @@
 #include <Cosmos/database/txdb.hpp>
+#include <Cosmos/database/validate.hpp>
+#include <Cosmos/database/proof.hpp>
 #include <gigamonkey/merkle/BUMP.hpp>
 #include <filesystem>
+#include <map>
 #include <fstream>
 
 namespace Cosmos {
@@ -19,92 +22,200 @@ namespace Cosmos {
 
         if (this->transaction (txid).Transaction == nullptr) {
             this->insert (tx);
+            index (tx);
+        }
+
+        return true;
+    }
 
-            uint32 i = 0;
-            for (const Bitcoin::input in : tx.Inputs)
-                this->set_redeem (in.Reference, inpoint {txid, i++});
+    bool vertex::validate (SPV::database &db) const {
+        return validator {db} (Proof.Key, Transaction, Proof.Value);
+    }
 
-            i = 0;
-            for (const Bitcoin::output out : tx.Outputs) {
-                auto script_hash = this->add_script (out.Script);
-                auto op = Bitcoin::outpoint {txid, i};
-                this->add_output (script_hash, op);
+    void local_TXDB::import_transactions (list<std::pair<Bitcoin::transaction, maybe<Merkle::proof>>> txs) {
+        std::vector<Merkle::proof> proofs;
+        for (const auto &[tx, proof] : txs) {
+            auto txid = tx.id ();
+            auto db_entry = this->transaction (txid);
 
-                pay_to_address p2a {out.Script};
-                if (p2a.valid ())
-                    this->add_address (Bitcoin::address {Bitcoin::network::Main, p2a.Address}, script_hash);
+            if (bool (proof) && !db_entry.Confirmation.valid ()) proofs.push_back (*proof);
 
-                i++;
+            if (db_entry.Transaction == nullptr) {
+                this->insert (tx);
+                index (tx);
             }
         }
 
-        return true;
+        // txs are in first so that they are marked as mined.
+        insert_proofs (proofs);
+    }
+
+    list<Bitcoin::TxID> local_TXDB::insert_proofs (std::span<const Merkle::proof> proofs) {
+        list<Bitcoin::TxID> rejected;
+
+        // group the paths by root and make one tree for each block.
+        // A proof that doesn't lead to its root would spoil the whole tree.
+        std::map<digest256, decltype (Merkle::dual::Paths)> blocks;
+        for (const Merkle::proof &p : proofs) {
+            if (p.Branch.root () != p.Root) {
+                rejected <<= p.Branch.Leaf.Digest;
+                continue;
+            }
+
+            blocks[p.Root] = blocks[p.Root].insert (p.Branch.Leaf.Digest, Merkle::path (p.Branch));
+        }
+
+        for (const auto &[root, paths] : blocks) {
+            if (this->insert (Merkle::dual {paths, root})) continue;
+
+            // try them one at a time so that the good ones still go in.
+            for (const auto &[txid, path] : paths)
+                if (!this->insert (Merkle::dual {decltype (Merkle::dual::Paths) {}.insert (txid, path), root}))
+                    rejected <<= txid;
+        }
+
+        for (const Bitcoin::TxID &txid : rejected) DATA_LOG (warning) << "could not insert proof for " << txid;
+
+        return rejected;
+    }
+
+    void local_TXDB::index (const Bitcoin::transaction &tx) {
+        auto txid = tx.id ();
+
+        uint32 i = 0;
+        for (const Bitcoin::input in : tx.Inputs)
+            this->set_redeem (in.Reference, inpoint {txid, i++});
+
+        i = 0;
+        for (const Bitcoin::output out : tx.Outputs) {
+            auto script_hash = this->add_script (out.Script);
+            auto op = Bitcoin::outpoint {txid, i};
+            this->add_output (script_hash, op);
+
+            pay_to_address p2a {out.Script};
+            if (p2a.valid ())
+                this->add_address (Bitcoin::address {Bitcoin::network::Main, p2a.Address}, script_hash);
+
+            i++;
+        }
     }
 
     namespace {
-        const ptr<const entry<N, Bitcoin::header>> import_header (local_TXDB &local, network &net, const N &n) {
-            auto block = net.WhatsOnChain.blocks ();
+        const ptr<const entry<N, Bitcoin::header>> import_header (cached_remote_TXDB &db, const N &n) {
+            auto ticket = db.Net.Scheduler.take (provider::WhatsOnChain);
+            auto block = db.Net.WhatsOnChain.blocks ();
             auto header = data::synced (&WhatsOnChain::blocks::get_header_by_height, &block, n);
-            return local.insert (header.Height, header.Header);
+            return db.Local.insert (header.Height, header.Header);
         }
 
-        const ptr<const entry<N, Bitcoin::header>> import_header (local_TXDB &local, network &net, const digest256 &d) {
-            auto block = net.WhatsOnChain.blocks ();
+        const ptr<const entry<N, Bitcoin::header>> import_header (cached_remote_TXDB &db, const digest256 &d) {
+            auto ticket = db.Net.Scheduler.take (provider::WhatsOnChain);
+            auto block = db.Net.WhatsOnChain.blocks ();
             auto header = data::synced (&WhatsOnChain::blocks::get_header_by_hash, &block, d);
-            return local.insert (header.Height, header.Header);
+            return db.Local.insert (header.Height, header.Header);
         }
     }
 
     awaitable<bool> cached_remote_TXDB::import_transaction (const Bitcoin::TxID &txid) {
 
-        maybe<bytes> tx = co_await Net.get_transaction (txid);
+        maybe<bytes> tx = co_await Net.get_transaction (txid, Priority, flow ());
         if (!bool (tx)) co_return false;
 
-        auto proof = co_await Net.WhatsOnChain.transactions ().get_merkle_proof (txid);
+        maybe<merkle_proof> proof = co_await get_merkle_proof (txid);
 
         if (!bool (proof)) {
             Local.insert (Bitcoin::transaction {*tx});
             co_return true;
         }
 
-        if (!proof->Proof.valid ()) co_return false;
+        // we got the header when we checked the proof.
         ptr<const entry<N, Bitcoin::header>> h = Local.header (proof->BlockHash);
-        if (!bool (h)) h = import_header (Local, Net, proof->BlockHash);
         if (!bool (h)) co_return false;
         co_return Local.import_transaction (Bitcoin::transaction {*tx}, Merkle::path (proof->Proof.Branch), h->Value);
     }
 
-    events cached_remote_TXDB::by_address (const Bitcoin::address &a) {
-        auto x = Local.by_address (a);
-        if (!data::empty (x) && x.valid ()) return x;
+    awaitable<maybe<merkle_proof>> cached_remote_TXDB::get_merkle_proof (Bitcoin::TxID txid) {
+        co_return co_await Net.get_merkle_proof (txid, [this, txid] (const merkle_proof &p) -> bool {
+            auto h = header (p.BlockHash);
+            return bool (h) && h->Value.MerkleRoot == p.Proof.Root &&
+                SPV::proof::valid (txid, Merkle::path (p.Proof.Branch), h->Value.MerkleRoot);
+        }, Priority, flow ());
+    }
 
-        auto address = Net.WhatsOnChain.addresses ();
-        list<Bitcoin::TxID> ids = synced (&WhatsOnChain::addresses::get_history, &address, a);
+    namespace {
+        template <typename ID> awaitable<uint32> sync_history (cached_remote_TXDB &db, ID id) {
+            std::string key = watermark_key (id);
+            maybe<watermark> last = db.Local.get_watermark (key);
+
+            // we get the height first so that nothing can be missed if a block comes in while we sync.
+            uint64 height = co_await db.Net.height (db.Priority, db.flow ());
+            uint64 from = !bool (last) ? 0 : last->Height > db.ReorgDepth ? last->Height - db.ReorgDepth : 0;
+
+            list<history_item> items = co_await db.Net.history (id, from, db.Priority, db.flow ());
+
+            uint32 imported = 0;
+            // the lowest height of a confirmed tx that we could not import.
+            maybe<uint64> failed;
+            for (const history_item &item : items) {
+                // skip txs that we already have unless we now have a proof for one that we don't.
+                auto known = db.Local.transaction (item.TxID);
+                if (known.Transaction != nullptr && (item.Height == 0 || known.confirmed ())) continue;
+
+                bool ok = false;
+                try {
+                    ok = co_await db.import_transaction (item.TxID);
+                } catch (const std::exception &x) {
+                    DATA_LOG (warning) << "could not reach the network to import txid " << item.TxID << ": " << x.what ();
+                }
 
-        int i = 0;
-        for (const Bitcoin::TxID &txid : ids) {
-            if (!synced (&cached_remote_TXDB::import_transaction, this, txid))
-                // we just print the error because we may be in the middle of an
+                if (ok) imported++;
+                // we just log the error because we may be in the middle of an
                 // operation and then what do we do? This would require the user
                 // to fix it up.
-                std::cout << "error importing txid " << txid << std::endl;
-            i++;
-        }
+                else {
+                    DATA_LOG (warning) << "error importing txid " << item.TxID;
+                    // unconfirmed txs will be in the history next time anyway.
+                    if (item.Height > 0 && (!bool (failed) || item.Height < *failed)) failed = item.Height;
+                }
+            }
 
-        return Local.by_address (a);
+            // don't go past a tx that we could not import so that we will try it again next time.
+            uint64 next = bool (failed) ? std::min (height + 1, *failed) : height + 1;
+            db.Local.set_watermark (key, watermark {next, Bitcoin::timestamp::now ()});
+
+            DATA_LOG (debug) << "synced " << key << " from height " << from << "; " << items.size () <<
+                " txs in history, " << imported << " imported";
+
+            co_return imported;
+        }
     }
 
-    events cached_remote_TXDB::by_script_hash (const digest256 &z) {
-        auto x = Local.by_script_hash (z);
-        if (data::empty (x)) return x;
+    awaitable<uint32> cached_remote_TXDB::sync (const Bitcoin::address &a) {
+        return sync_history (*this, a);
+    }
 
-        auto scripts = Net.WhatsOnChain.scripts ();
-        auto ids = synced (&WhatsOnChain::scripts::get_history, &scripts, z);
+    awaitable<uint32> cached_remote_TXDB::sync (const digest256 &z) {
+        return sync_history (*this, z);
+    }
 
-        for (const Bitcoin::TxID &txid : ids) {
-            if (!synced (&cached_remote_TXDB::import_transaction, this, txid))
-                std::cout << "error importing txid " << txid << std::endl;
+    namespace {
+        bool history_stale (const maybe<watermark> &w, uint32 max_age) {
+            return !bool (w) || uint32 (Bitcoin::timestamp::now ()) - uint32 (w->MempoolChecked) > max_age;
         }
+    }
+
+    // we go to the network if we have never synced or if the last sync is
+    // older than MaxHistoryAge. Otherwise we use what we have.
+    events cached_remote_TXDB::by_address (const Bitcoin::address &a) {
+        if (history_stale (Local.get_watermark (watermark_key (a)), MaxHistoryAge))
+            synced (static_cast<awaitable<uint32> (cached_remote_TXDB::*) (const Bitcoin::address &)> (&cached_remote_TXDB::sync), this, a);
+
+        return Local.by_address (a);
+    }
+
+    events cached_remote_TXDB::by_script_hash (const digest256 &z) {
+        if (history_stale (Local.get_watermark (watermark_key (z)), MaxHistoryAge))
+            synced (static_cast<awaitable<uint32> (cached_remote_TXDB::*) (const digest256 &)> (&cached_remote_TXDB::sync), this, z);
 
         return Local.by_script_hash (z);
     }
@@ -118,82 +229,286 @@ namespace Cosmos {
 
     SPV::database::tx cached_remote_TXDB::transaction (const Bitcoin::TxID &xd) {
         auto p = Local.transaction (xd);
-        if (p.valid () && p.confirmed ()) return p;
-        if (!synced (&cached_remote_TXDB::import_transaction, this, xd))
-            std::cout << "error importing txid " << xd << std::endl;
+        if (p.valid () && (p.confirmed () || prefetched (xd))) return p;
+        try {
+            if (!synced (&cached_remote_TXDB::import_transaction, this, xd))
+                std::cout << "error importing txid " << xd << std::endl;
+        } catch (const std::exception &x) {
+            DATA_LOG (warning) << "could not import txid " << xd << ": " << x.what ();
+        }
+
         return Local.transaction (xd);
     }
 
+    namespace {
+        // import all txids concurrently and wait until they are done.
+        awaitable<uint32> import_all (cached_remote_TXDB &db, list<Bitcoin::TxID> txids) {
+            auto ex = co_await net::asio::this_coro::executor;
+
+            auto remaining = std::make_shared<uint32> (txids.size ());
+            auto imported = std::make_shared<uint32> (0);
+            auto done = std::make_shared<net::asio::steady_timer> (ex, net::asio::steady_timer::time_point::max ());
+
+            for (const Bitcoin::TxID &txid : txids)
+                net::asio::co_spawn (ex, [&db, txid, remaining, imported, done] () -> awaitable<void> {
+                    try {
+                        if (co_await db.import_transaction (txid)) ++*imported;
+                        else DATA_LOG (warning) << "error importing txid " << txid;
+                    } catch (const std::exception &x) {
+                        DATA_LOG (warning) << "error importing txid " << txid << ": " << x.what ();
+                    }
+
+                    if (--*remaining == 0) done->cancel ();
+                }, net::asio::detached);
+
+            if (*remaining > 0) {
+                boost::system::error_code ec;
+                co_await done->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+            }
+
+            co_return *imported;
+        }
+    }
+
+    bool cached_remote_TXDB::prefetched (const Bitcoin::TxID &txid) {
+        auto i = Prefetched.find (txid);
+        if (i == Prefetched.end ()) return false;
+        if (std::chrono::steady_clock::now () - i->second < std::chrono::seconds {MaxHistoryAge}) return true;
+        Prefetched.erase (i);
+        return false;
+    }
+
+    awaitable<uint32> cached_remote_TXDB::prefetch (list<Bitcoin::transaction> payment) {
+        // drop the unconfirmed txs that may have been mined since we checked them.
+        auto now = std::chrono::steady_clock::now ();
+        std::erase_if (Prefetched, [this, now] (const auto &entry) {
+            return now - entry.second >= std::chrono::seconds {MaxHistoryAge};
+        });
+
+        // txs in the payment are not in the database yet, so we mark them as
+        // seen in order not to go to the network for them.
+        std::set<Bitcoin::TxID> seen;
+        for (const auto &tx : payment) seen.insert (tx.id ());
+
+        list<Bitcoin::TxID> generation;
+        for (const auto &tx : payment)
+            for (const Bitcoin::input &in : tx.Inputs)
+                if (seen.insert (in.Reference.Digest).second) generation <<= in.Reference.Digest;
+
+        uint32 imported = 0;
+        uint32 unconfirmed = 0;
+        while (!data::empty (generation)) {
+            // we only need to go to the network for txs that we don't have with
+            // a proof, unless we have checked them recently.
+            list<Bitcoin::TxID> missing;
+            for (const Bitcoin::TxID &txid : generation) {
+                auto known = Local.transaction (txid);
+                if (!(known.valid () && (known.confirmed () || prefetched (txid)))) missing <<= txid;
+            }
+
+            while (!data::empty (missing)) {
+                list<Bitcoin::TxID> batch;
+                for (uint32 i = 0; i < MaxParallelImports && !data::empty (missing); i++) {
+                    batch <<= data::first (missing);
+                    missing = data::rest (missing);
+                }
+
+                imported += co_await import_all (*this, batch);
+            }
+
+            // the parents of unconfirmed txs are the next generation.
+            list<Bitcoin::TxID> next;
+            for (const Bitcoin::TxID &txid : generation) {
+                auto known = Local.transaction (txid);
+                if (known.Transaction == nullptr || known.confirmed ()) continue;
+
+                unconfirmed++;
+                // keep the time of the first check so that the entry expires.
+                Prefetched.emplace (txid, now);
+                for (const Bitcoin::input &in : known.Transaction->Inputs)
+                    if (seen.insert (in.Reference.Digest).second) next <<= in.Reference.Digest;
+            }
+
+            generation = next;
+        }
+
+        DATA_LOG (debug) << "prefetched " << imported << " ancestors of a payment of " << payment.size () <<
+            " txs; " << unconfirmed << " of them are unconfirmed";
+
+        co_return imported;
+    }
+
+    void cached_remote_TXDB::prefetch_ancestors (list<Bitcoin::transaction> payment) {
+        synced (&cached_remote_TXDB::prefetch, this, payment);
+    }
+
+    maybe<bytes> cached_remote_TXDB::raw_transaction (const Bitcoin::TxID &txid) {
+        if (auto b = Local.raw_transaction (txid); bool (b)) return b;
+        return TXDB::raw_transaction (txid);
+    }
+
     ptr<const entry<N, Bitcoin::header>> cached_remote_TXDB::header (const N &n) {
         const auto h = Local.header (n);
         if (bool (h)) return h;
-        return import_header (Local, Net, n);
+        return import_header (*this, n);
     }
 
     ptr<const entry<N, Bitcoin::header>> cached_remote_TXDB::header (const digest256 &d) {
         const auto e = Local.header (d);
         if (bool (e)) return e;
-        return import_header (Local, Net, d);
+        return import_header (*this, d);
     }
 
     namespace {
-        awaitable<broadcast_single_result> broadcast_tx (cached_remote_TXDB &txdb, const extended_transaction &tx) {
-            auto success = co_await txdb.Net.broadcast (tx);
-            if (bool (success)) txdb.Local.insert (Bitcoin::transaction (tx));
-            co_return success;
-        }
-
-        awaitable<broadcast_multiple_result> broadcast_txs (cached_remote_TXDB &txdb, const list<extended_transaction> &txs) {
-            auto success = co_await txdb.Net.broadcast (txs);
-            if (bool (success)) for (const auto &tx : txs) txdb.Local.insert (Bitcoin::transaction (tx));
-            co_return success;
-        }
-
-        awaitable<broadcast_tree_result> broadcast_map (cached_remote_TXDB &txdb, SPV::proof::map map) {
-            broadcast_tree_result so_far {};
+        bool order_map (local_TXDB &local, const SPV::proof::map &map,
+            list<extended_transaction> &ordered, set<Bitcoin::TxID> &seen) {
             // go down the tree and process leaves first.
-            for (const auto &[txid, pn] : map) if (pn->Proof.is<SPV::confirmation> ()) {
+            for (const auto &[txid, pn] : map) {
+                if (seen.contains (txid)) continue;
+                seen = seen.insert (txid);
+
+                if (pn->Proof.is<SPV::confirmation> ()) {
                     // leaves have confirmations so they don't need to be broadcast and they
                     // just go into the database.
                     const auto &conf = pn->Proof.get<SPV::confirmation> ();
-                    if (!txdb.Local.import_transaction (pn->Transaction, conf.Path, conf.Header)) {
-                        so_far.Sub = so_far.Sub.insert (txid, broadcast_result::ERROR_INVALID);
-                        co_return so_far;
-                    }
+                    if (!local.import_transaction (pn->Transaction, conf.Path, conf.Header)) return false;
                 } else {
-                    // try to broadcast all sub transactions.
-                    auto m = pn->Proof.get<SPV::proof::map> ();
-                    auto successes = co_await broadcast_map (txdb, m);
-                    so_far.Sub = so_far.Sub & successes.Sub;
-                    if (bool (successes)) {
-                        so_far.Error = successes.Error;
-                        co_return so_far;
-                    } else {
-                        auto success = co_await broadcast_tx (txdb, SPV::extended_transaction (pn->Transaction, m));
-                        so_far.Sub = so_far.Sub.insert (txid, success);
-                        if (bool (success)) txdb.Local.insert (pn->Transaction);
-                        else {
-                            so_far.Error = success.Error;
-                            co_return so_far;
-                        }
-                    }
+                    const auto &m = pn->Proof.get<SPV::proof::map> ();
+                    if (!order_map (local, m, ordered, seen)) return false;
+                    ordered <<= SPV::extended_transaction (pn->Transaction, m);
+                }
+            }
+
+            return true;
+        }
+    }
+
+    maybe<list<extended_transaction>> cached_remote_TXDB::broadcast_order (const SPV::proof &p) {
+        list<extended_transaction> ordered;
+        set<Bitcoin::TxID> seen;
+        if (!order_map (Local, p.Proof, ordered, seen)) return {};
+        return ordered + SPV::extended_transactions (p.Payment, p.Proof);
+    }
+
+    namespace {
+        uint64 queue (local_TXDB &local, list<extended_transaction> txs, const JSON &note) {
+            // save the txs so that they are there when we generate proofs for later payments.
+            for (const auto &tx : txs) local.insert (Bitcoin::transaction (tx));
+            return local.queue_outgoing (outgoing {txs, note});
+        }
+    }
+
+    maybe<uint64> queue_outgoing (local_TXDB &local, const SPV::proof &p, const JSON &note) {
+        if (!validator {local} (p)) return {};
+
+        list<extended_transaction> ordered;
+        set<Bitcoin::TxID> seen;
+        if (!order_map (local, p.Proof, ordered, seen)) return {};
+
+        uint64 id = queue (local, ordered + SPV::extended_transactions (p.Payment, p.Proof), note);
+        DATA_LOG (normal) << "payment of " << p.Payment.size () << " txs saved in the outbox as entry " << id;
+        return id;
+    }
+
+    namespace {
+        // statuses for which the network has the tx.
+        bool broadcast_accepted (const JSON &status) {
+            if (!status.is_object () || !status.contains ("txStatus") || !status["txStatus"].is_string ()) return false;
+            std::string tx_status = status["txStatus"];
+            return tx_status == "ACCEPTED_BY_NETWORK" || tx_status == "SEEN_ON_NETWORK" || tx_status == "MINED";
+        }
+    }
+
+    map<Bitcoin::TxID, broadcast_single_result> cached_remote_TXDB::record_broadcast
+        (list<extended_transaction> txs, const broadcast_multiple_result &r) {
+        map<Bitcoin::TxID, broadcast_single_result> sub;
+
+        // a successful call can still reject some of the txs, so we look at each one's status.
+        // A failed call can have statuses for txs that went out before it failed.
+        std::map<Bitcoin::TxID, ARC::status> by_txid;
+        for (const ARC::status &s : r.Status) {
+            JSON j = JSON (s);
+            if (j.is_object () && j.contains ("txid") && j["txid"].is_string ())
+                by_txid.emplace (read_TxID (std::string (j["txid"])), s);
+        }
+
+        for (const auto &tx : txs) {
+            auto txid = tx.id ();
+            auto s = by_txid.find (txid);
+            if (s == by_txid.end ()) {
+                if (!bool (r)) {
+                    sub = sub.insert (txid, broadcast_single_result {r.Error, r.Details});
+                    continue;
                 }
 
-            //
-            co_return so_far;
+                DATA_LOG (warning) << "no status was returned for broadcast tx " << txid;
+                sub = sub.insert (txid, broadcast_single_result {broadcast_result::ERROR_UNKNOWN});
+                continue;
+            }
+
+            JSON status = JSON (s->second);
+            if (!broadcast_accepted (status)) {
+                DATA_LOG (warning) << "broadcast tx " << txid << " was rejected: " << status;
+                sub = sub.insert (txid, broadcast_single_result {broadcast_result::ERROR_INVALID, status});
+                continue;
+            }
+
+            Local.insert (Bitcoin::transaction (tx));
+            Local.set_broadcast_status (txid, status);
+            sub = sub.insert (txid, broadcast_single_result {s->second});
+        }
+
+        return sub;
+    }
+
+    awaitable<broadcast_tree_result> cached_remote_TXDB::broadcast (SPV::proof p, maybe<JSON> queue_note) {
+        if (!validator {*this} (p)) co_return broadcast_result::ERROR_INVALID;
+
+        maybe<list<extended_transaction>> txs = broadcast_order (p);
+        if (!bool (txs)) co_return broadcast_result::ERROR_INVALID;
+
+        // all unconfirmed txs go out together, along with those of any other requests.
+        broadcast_multiple_result result = co_await (*Broadcasts) (*txs);
+
+        if (result.Error == broadcast_result::ERROR_NETWORK_CONNECTION_FAIL && bool (queue_note)) {
+            uint64 id = queue (Local, *txs, *queue_note);
+            DATA_LOG (normal) << "could not connect; " << txs->size () << " txs saved in the outbox as entry " << id;
+            co_return broadcast_result::QUEUED;
         }
+
+        auto sub = record_broadcast (*txs, result);
+
+        // the result is for whole batches, which may include the txs of
+        // other requests, so we only look at the results for our own.
+        broadcast_multiple_result ours {list<ARC::status> {}};
+        for (const auto &[_, single] : sub)
+            if (bool (single)) ours.Status <<= single.Status;
+            else if (bool (ours)) {
+                ours.Error = single.Error;
+                ours.Details = single.Details;
+            }
+
+        co_return broadcast_tree_result {ours, sub};
     }
 
-    awaitable<broadcast_tree_result> cached_remote_TXDB::broadcast (SPV::proof p) {
-        if (!p.validate (*this)) co_return broadcast_result::ERROR_INVALID;
+    JSON write (const outgoing &o) {
+        JSON::array_t txs;
+        for (const auto &tx : o.Txs) txs.push_back (encoding::base64::write (bytes (tx)));
+        return JSON::object_t {{"txs", txs}, {"note", o.Note}};
+    }
 
-        broadcast_tree_result success_map = co_await broadcast_map (*this, p.Proof);
+    outgoing read_outgoing (const JSON &j) {
+        if (!j.is_object () || !j.contains ("txs") || !j["txs"].is_array ())
+            throw data::exception {} << "invalid outbox entry " << j;
 
-        // if there are any errors, return those.
-        for (const auto &[_, x] : success_map.Sub) if (!bool (x))
-            co_return broadcast_tree_result {{x.Error, x.Details}, success_map.Sub};
+        list<extended_transaction> txs;
+        for (const JSON &tx : j["txs"]) {
+            maybe<bytes> b = encoding::base64::read (std::string (tx));
+            if (!bool (b)) throw data::exception {} << "invalid tx in outbox entry " << j;
+            txs <<= extended_transaction {*b};
+        }
 
-        co_return broadcast_tree_result {co_await broadcast_txs (*this, SPV::extended_transactions (p.Payment, p.Proof)), success_map.Sub};
+        return outgoing {txs, j.contains ("note") ? j["note"] : JSON (nullptr)};
     }
 
     std::ostream &operator << (std::ostream &o, const event &r) {
@@ -243,6 +558,11 @@ namespace Cosmos {
         return Index <=> Index;
     }
 
+    proof_builder &TXDB::proofs () {
+        if (Proofs == nullptr) Proofs = std::make_shared<proof_builder> (*this);
+        return *Proofs;
+    }
+
     ptr<vertex> TXDB::operator [] (const Bitcoin::TxID &id) {
         SPV::database::tx tx = this->transaction (id);
         if (!tx.valid ()) return {};
@@ -253,7 +573,7 @@ namespace Cosmos {
                 entry<Bitcoin::TxID, SPV::proof::tree> {id, SPV::proof::tree (tx.Confirmation)});
         }
 
-        maybe<SPV::proof> p = SPV::generate_proof (*this, {*tx.Transaction});
+        maybe<SPV::proof> p = proofs () ({*tx.Transaction});
         if (!bool (p)) return {};
 
         return std::make_shared<vertex> (
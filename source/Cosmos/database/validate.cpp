@@ -0,0 +1,125 @@
+#include <Cosmos/database/validate.hpp>
+#include <gigamonkey/script/interpreter.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/use_future.hpp>
+#include <algorithm>
+#include <future>
+#include <thread>
+
+namespace Cosmos {
+
+    boost::asio::thread_pool &script_pool () {
+        static boost::asio::thread_pool pool {std::max (1u, std::thread::hardware_concurrency ())};
+        return pool;
+    }
+
+    namespace {
+        bool valid_input (const extended_transaction &tx, uint32 index) {
+            const auto &in = tx.Inputs[index];
+            return bool (Bitcoin::evaluate (in.Script, in.Prevout.Script,
+                Bitcoin::redemption_document {Bitcoin::incomplete::transaction (tx), index, in.Prevout.Value}));
+        }
+
+        bool confirmed (SPV::database &db, const Bitcoin::TxID &txid, const SPV::confirmation &conf) {
+            auto h = db.header (conf.Header.hash ());
+            return bool (h) && SPV::proof::valid (txid, conf.Path, h->Value.MerkleRoot);
+        }
+    }
+
+    std::vector<bool> check_scripts (const std::vector<extended_transaction> &txs) {
+        // one task per input so that a tx with many inputs doesn't hold up the rest.
+        std::vector<std::vector<std::future<bool>>> checks (txs.size ());
+        for (size_t i = 0; i < txs.size (); i++) {
+            if (!txs[i].valid ()) continue;
+            for (uint32 j = 0; j < txs[i].Inputs.size (); j++)
+                checks[i].push_back (boost::asio::post (script_pool (), boost::asio::use_future ([&tx = txs[i], j] () -> bool {
+                    return valid_input (tx, j);
+                })));
+        }
+
+        // we wait for every task, even after a failure, since they refer to txs.
+        std::vector<bool> valid (txs.size (), false);
+        for (size_t i = 0; i < txs.size (); i++) {
+            bool good = txs[i].valid ();
+            for (auto &check : checks[i]) try {
+                if (!check.get ()) good = false;
+            } catch (const std::exception &) {
+                good = false;
+            }
+
+            valid[i] = good;
+        }
+
+        return valid;
+    }
+
+    validator::validator (SPV::database &db): DB {db}, Cache {nullptr} {
+        if (auto *local = dynamic_cast<local_TXDB *> (&db); local != nullptr) Cache = local;
+        else if (auto *remote = dynamic_cast<cached_remote_TXDB *> (&db); remote != nullptr) Cache = &remote->Local;
+    }
+
+    bool validator::operator () (const SPV::proof &p) {
+        Unchecked.clear ();
+        UncheckedIDs.clear ();
+        Seen.clear ();
+
+        if (!collect (p.Proof)) return false;
+        for (const extended_transaction &tx : SPV::extended_transactions (p.Payment, p.Proof))
+            if (!collect (tx.id (), tx)) return false;
+
+        return check ();
+    }
+
+    bool validator::operator () (const Bitcoin::TxID &txid, const extended_transaction &tx, const SPV::proof::tree &t) {
+        Unchecked.clear ();
+        UncheckedIDs.clear ();
+        Seen.clear ();
+
+        if (t.is<SPV::confirmation> ()) return confirmed (DB, txid, t.get<SPV::confirmation> ());
+
+        if (!collect (t.get<SPV::proof::map> ())) return false;
+        if (!collect (txid, tx)) return false;
+
+        return check ();
+    }
+
+    bool validator::collect (const SPV::proof::map &m) {
+        for (const auto &[txid, pn] : m) {
+            if (Seen.contains (txid)) continue;
+            Seen.insert (txid);
+
+            if (pn->Proof.is<SPV::confirmation> ()) {
+                if (!confirmed (DB, txid, pn->Proof.get<SPV::confirmation> ())) return false;
+                continue;
+            }
+
+            // everything below a tx that we have validated before is good too.
+            if (Cache != nullptr && Cache->validated (txid)) continue;
+
+            const auto &parents = pn->Proof.get<SPV::proof::map> ();
+            if (!collect (parents)) return false;
+            if (!collect (txid, SPV::extended_transaction (pn->Transaction, parents))) return false;
+        }
+
+        return true;
+    }
+
+    bool validator::collect (const Bitcoin::TxID &txid, const extended_transaction &tx) {
+        if (Cache != nullptr && Cache->validated (txid)) return true;
+        if (tx.id () != txid) return false;
+
+        Unchecked.push_back (tx);
+        UncheckedIDs.push_back (txid);
+        return true;
+    }
+
+    bool validator::check () {
+        std::vector<bool> valid = check_scripts (Unchecked);
+        if (std::find (valid.begin (), valid.end (), false) != valid.end ()) return false;
+
+        // we only remember txs once we know that all their ancestors are good too.
+        if (Cache != nullptr) for (const auto &txid : UncheckedIDs) Cache->set_validated (txid);
+        return true;
+    }
+
+}
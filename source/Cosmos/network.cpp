@@ -1,6 +1,7 @@
 
 #include <Cosmos/network.hpp>
-#include <io/wait_for_enter.hpp>
+#include <Cosmos/database/write.hpp>
+#include <gigamonkey/merkle/BUMP.hpp>
 #include <mutex>
 #include <iomanip>
 
@@ -50,23 +51,21 @@ namespace Cosmos {
 
     awaitable<broadcast_single_result> network::broadcast (const extended_transaction &tx) {
 
-        std::cout << "attempting to broadcast tx " << tx.id () << std::endl;
-        io::wait_for_enter ();
+        DATA_LOG (normal) << "broadcasting tx " << tx.id ();
 
         ARC::submit_response response;
         try {
+            auto ticket = co_await Scheduler.admit (provider::TAAL, priority::interactive);
             response = co_await TAAL.submit (tx);
         } catch (net::HTTP::exception ex) {
-            std::cout << "Could not connect: " << ex.what () << std::endl;
+            DATA_LOG (warning) << "Could not connect: " << ex.what ();
             co_return broadcast_result::ERROR_NETWORK_CONNECTION_FAIL;
         }
 
-        std::cout << "response status: " << response.Status << std::endl;
+        DATA_LOG (debug) << "broadcast response status: " << response.Status << "; body: " << response.Body;
 
         if (response.Status == 401) co_return broadcast_result::ERROR_INAUTHENTICATED;
 
-        std::cout << "response body: " << response.Body << std::endl;
-
         if (response.Status == 200) co_return response.status ();
 
         if (response.Status == 465 || response.Status == 473)
@@ -80,24 +79,21 @@ namespace Cosmos {
 
     awaitable<broadcast_multiple_result> network::broadcast (list<extended_transaction> txs) {
 
-        std::cout << "attempting to broadcast " << std::endl;
-        for (const auto &tx: txs) std::cout << "\t" << tx.id () << std::endl;
-        io::wait_for_enter ();
+        DATA_LOG (normal) << "broadcasting " << txs.size () << " txs";
 
         ARC::submit_txs_response response;
         try {
+            auto ticket = co_await Scheduler.admit (provider::TAAL, priority::interactive);
             response = co_await TAAL.submit_txs (txs);
         } catch (net::HTTP::exception ex) {
-            std::cout << "Could not connect: " << ex.what () << std::endl;
+            DATA_LOG (warning) << "Could not connect: " << ex.what ();
             co_return broadcast_result::ERROR_NETWORK_CONNECTION_FAIL;
         }
 
-        std::cout << "response status: " << response.Status << std::endl;
+        DATA_LOG (debug) << "broadcast response status: " << response.Status << "; body: " << response.Body;
 
         if (response.Status == 401) co_return broadcast_result::ERROR_INAUTHENTICATED;
 
-        std::cout << "response body: " << response.Body << std::endl;
-
         if (response.Status == 200) co_return response.status ();
 
         if (response.Status == 465 || response.Status == 473)
@@ -110,20 +106,279 @@ namespace Cosmos {
 
     }
 
-    awaitable<maybe<bytes>> network::get_transaction (const Bitcoin::TxID &txid) {
+    network_endpoints network_endpoints::standin (const std::string &authority) {
+        auto colon = authority.rfind (':');
+        host h = colon == std::string::npos ? host {"http", authority} :
+            host {"http", authority.substr (0, colon), static_cast<uint16> (std::stoul (authority.substr (colon + 1)))};
+        return network_endpoints {h, h, h, h};
+    }
+
+    namespace {
+        // one request with no retries. Throws if we cannot connect.
+        awaitable<net::HTTP::response> call_once (network &net, provider p, priority pr, uint64 flow,
+            const host &h, const std::string &target,
+            boost::beast::http::verb verb = boost::beast::http::verb::get, const std::string &body = "") {
+            auto ticket = co_await net.Scheduler.admit (p, pr, flow);
+            auto start = std::chrono::steady_clock::now ();
+            auto response = co_await net.Pool (h, verb, target, body, body == "" ? "" : "application/json");
+            net.Latency[p].record (std::chrono::duration_cast<std::chrono::milliseconds>
+                (std::chrono::steady_clock::now () - start));
+            co_return response;
+        }
+
+        // retry with backoff when a service tells us that we are making
+        // too many requests or when we cannot connect.
+        // We wait for the scheduler on every attempt but not while we back off.
+        awaitable<net::HTTP::response> call_with_backoff (network &net, provider p, priority pr, uint64 flow,
+            const host &h, const std::string &target,
+            boost::beast::http::verb verb = boost::beast::http::verb::get, const std::string &body = "") {
+            for (uint32 attempt = 0; attempt < net.PriceBackoff.MaxAttempts; attempt++) {
+                maybe<net::HTTP::response> response;
+                try {
+                    response = co_await call_once (net, p, pr, flow, h, target, verb, body);
+                } catch (const boost::system::system_error &x) {
+                    DATA_LOG (warning) << "could not connect to " << h << ": " << x.what ();
+                }
+
+                if (bool (response) && response->Status != net::HTTP::status::too_many_requests &&
+                    response->Status != net::HTTP::status::service_unavailable) co_return *response;
+
+                auto delay = net.PriceBackoff (attempt);
+                DATA_LOG (warning) << "call to " << h << target << " failed; trying again in " << delay.count () << " milliseconds";
+
+                co_await net.sleep (delay);
+            }
+
+            throw data::exception {} << "could not get a response from " << h << " after " <<
+                net.PriceBackoff.MaxAttempts << " attempts";
+        }
+    }
+
+    namespace {
+        // how long to wait for a provider before we ask another one as well.
+        std::chrono::milliseconds hedge_delay (network &net, provider p) {
+            // any sooner and we would just be doubling our requests.
+            constexpr std::chrono::milliseconds min_delay {50};
+            auto d = net.Latency[p].p95 (std::chrono::milliseconds {1000});
+            return d < min_delay ? min_delay : d;
+        }
+
+        // hedged sources fail fast so that the hedge can go on to the next
+        // source rather than wait for one to back off.
+        awaitable<net::HTTP::response> call_hedged (network &net, provider p, priority pr, uint64 flow,
+            const host &h, const std::string &target) {
+            auto response = co_await call_once (net, p, pr, flow, h, target);
+            if (response.Status == net::HTTP::status::too_many_requests ||
+                response.Status == net::HTTP::status::service_unavailable)
+                throw data::exception {} << h << " is not available; status " << response.Status;
+            co_return response;
+        }
+
+        // the last source in a hedge backs off because there is nothing else to try.
+        awaitable<net::HTTP::response> call_source (network &net, provider p, priority pr, uint64 flow,
+            const host &h, const std::string &target, bool last) {
+            if (last) co_return co_await call_with_backoff (net, p, pr, flow, h, target);
+            co_return co_await call_hedged (net, p, pr, flow, h, target);
+        }
+
+        awaitable<maybe<bytes>> get_raw_tx (network &net, provider p, host h,
+            Bitcoin::TxID txid, priority pr, uint64 flow, bool last) {
+            auto response = co_await call_source (net, p, pr, flow, h,
+                string::write ("/v1/bsv/main/tx/", write (txid), "/hex"), last);
+
+            if (response.Status == net::HTTP::status::not_found) co_return maybe<bytes> {};
+
+            if (response.Status != net::HTTP::status::ok)
+                throw data::exception {} << "could not get tx " << txid << " from " << h << "; status " << response.Status;
+
+            // make sure that we got the tx that we asked for.
+            maybe<bytes> tx = encoding::hex::read (std::string (response.Body));
+            if (!bool (tx) || Bitcoin::TxID (data::crypto::Bitcoin_256 (*tx)) != txid) co_return maybe<bytes> {};
+
+            co_return tx;
+        }
+
+        awaitable<maybe<merkle_proof>> WhatsOnChain_proof (network &net, WhatsOnChain::API &api, provider p,
+            Bitcoin::TxID txid, priority pr, uint64 flow) {
+            auto ticket = co_await net.Scheduler.admit (p, pr, flow);
+
+            auto start = std::chrono::steady_clock::now ();
+            auto proof = co_await api.transactions ().get_merkle_proof (txid);
+            net.Latency[p].record (std::chrono::duration_cast<std::chrono::milliseconds>
+                (std::chrono::steady_clock::now () - start));
+
+            if (!bool (proof)) co_return maybe<merkle_proof> {};
+            co_return merkle_proof {proof->Proof, proof->BlockHash};
+        }
+
+        // once a tx has been mined, ARC gives us its BUMP.
+        awaitable<maybe<merkle_proof>> ARC_proof (network &net, Bitcoin::TxID txid, priority pr, uint64 flow, bool last) {
+            auto response = co_await call_source (net, provider::TAAL, pr, flow, net.Endpoints.TAAL,
+                string::write ("/v1/tx/", write (txid)), last);
+
+            // not found means that ARC has not seen the tx.
+            if (response.Status == net::HTTP::status::not_found) co_return maybe<merkle_proof> {};
+            if (response.Status != net::HTTP::status::ok)
+                throw data::exception {} << "could not get the status of tx " << txid << " from ARC; status " << response.Status;
+
+            JSON status = JSON::parse (response.Body);
+            if (!status.contains ("merklePath") || !status["merklePath"].is_string () ||
+                !status.contains ("blockHash") || !status["blockHash"].is_string ()) co_return maybe<merkle_proof> {};
+
+            maybe<bytes> bump_bytes = encoding::hex::read (std::string (status["merklePath"]));
+            if (!bool (bump_bytes)) co_return maybe<merkle_proof> {};
+
+            auto paths = Merkle::BUMP {*bump_bytes}.paths ();
+            auto path = paths.contains (txid);
+            if (!bool (path)) co_return maybe<merkle_proof> {};
+
+            Merkle::branch branch {txid, *path};
+            co_return merkle_proof {Merkle::proof {branch, branch.root ()},
+                digest256 (read_TxID (std::string (status["blockHash"])))};
+        }
+    }
+
+    awaitable<maybe<bytes>> network::get_transaction (const Bitcoin::TxID &txid, priority pr, uint64 flow) {
         static map<Bitcoin::TxID, bytes> cache;
 
         auto known = cache.contains (txid);
         if (known) co_return maybe<bytes> {*known};
 
-        bytes tx = co_await WhatsOnChain.transactions ().get_raw (txid);
+        Bitcoin::TxID id = txid;
+        list<std::function<awaitable<maybe<bytes>> ()>> sources;
+        bool mirror = bool (Endpoints.WhatsOnChainMirror);
+        sources <<= [this, id, pr, flow, mirror] () {
+            return get_raw_tx (*this, provider::WhatsOnChain, Endpoints.WhatsOnChain, id, pr, flow, !mirror);
+        };
+
+        if (mirror) sources <<= [this, id, pr, flow] () {
+            return get_raw_tx (*this, provider::WhatsOnChainMirror, *Endpoints.WhatsOnChainMirror, id, pr, flow, true);
+        };
 
-        if (tx == bytes {})
-            co_return maybe<bytes> {};
+        maybe<bytes> tx = co_await first_valid<bytes> (hedge_delay (*this, provider::WhatsOnChain), sources);
+        if (!bool (tx)) co_return maybe<bytes> {};
 
-        cache = cache.insert (txid, tx);
+        cache = cache.insert (txid, *tx);
 
-        co_return tx;
+        co_return *tx;
+    }
+
+    awaitable<maybe<merkle_proof>> network::get_merkle_proof (Bitcoin::TxID txid,
+        std::function<bool (const merkle_proof &)> verify, priority pr, uint64 flow) {
+
+        using source = std::function<awaitable<maybe<merkle_proof>> ()>;
+
+        // wrap a source so that it only answers with a proof that checks out.
+        auto checked = [verify] (source get) -> source {
+            return [get, verify] () -> awaitable<maybe<merkle_proof>> {
+                maybe<merkle_proof> p = co_await get ();
+                if (bool (p) && p->Proof.valid () && (!bool (verify) || verify (*p))) co_return p;
+                co_return maybe<merkle_proof> {};
+            };
+        };
+
+        list<source> sources;
+        sources <<= checked ([this, txid, pr, flow] () {
+            return WhatsOnChain_proof (*this, WhatsOnChain, provider::WhatsOnChain, txid, pr, flow);
+        });
+
+        if (Mirror != nullptr) sources <<= checked ([this, txid, pr, flow] () {
+            return WhatsOnChain_proof (*this, *Mirror, provider::WhatsOnChainMirror, txid, pr, flow);
+        });
+
+        sources <<= checked ([this, txid, pr, flow] () {
+            return ARC_proof (*this, txid, pr, flow, true);
+        });
+
+        co_return co_await first_valid<merkle_proof> (hedge_delay (*this, provider::WhatsOnChain), sources);
+    }
+
+    awaitable<uint64> network::height (priority pr, uint64 flow) {
+        auto response = co_await call_with_backoff (*this, provider::WhatsOnChain, pr, flow,
+            Endpoints.WhatsOnChain, "/v1/bsv/main/chain/info");
+        if (response.Status != net::HTTP::status::ok)
+            throw data::exception {} << "could not get chain info; status " << response.Status;
+        co_return uint64 (JSON::parse (response.Body)["blocks"]);
+    }
+
+    namespace {
+        // resource is something like address/<address> or script/<script hash>.
+        awaitable<list<history_item>> get_history (network &net, std::string resource, uint64 from_height, priority pr, uint64 flow) {
+            list<history_item> items;
+
+            auto read_page = [] (const JSON &j, list<history_item> &items) -> std::string {
+                if (!j.contains ("result") || !j["result"].is_array ())
+                    throw data::exception {} << "invalid history response " << j;
+
+                for (const JSON &r : j["result"])
+                    items <<= history_item {read_TxID (std::string (r["tx_hash"])),
+                        r.contains ("height") ? uint64 (r["height"]) : uint64 (0)};
+
+                return j.contains ("nextPageToken") && j["nextPageToken"].is_string () ?
+                    std::string (j["nextPageToken"]) : std::string {};
+            };
+
+            // the confirmed history is paged.
+            std::string token;
+            do {
+                auto response = co_await call_with_backoff (net, provider::WhatsOnChain, pr, flow, net.Endpoints.WhatsOnChain,
+                    string::write ("/v1/bsv/main/", resource, "/confirmed/history?order=asc&height=", from_height,
+                        token == "" ? std::string {} : "&token=" + token));
+
+                if (response.Status == net::HTTP::status::not_found) break;
+                if (response.Status != net::HTTP::status::ok)
+                    throw data::exception {} << "could not get history for " << resource << "; status " << response.Status;
+
+                token = read_page (JSON::parse (response.Body), items);
+            } while (token != "");
+
+            auto response = co_await call_with_backoff (net, provider::WhatsOnChain, pr, flow, net.Endpoints.WhatsOnChain,
+                string::write ("/v1/bsv/main/", resource, "/unconfirmed/history"));
+
+            if (response.Status == net::HTTP::status::ok) {
+                list<history_item> unconfirmed;
+                read_page (JSON::parse (response.Body), unconfirmed);
+                for (const history_item &item : unconfirmed) items <<= history_item {item.TxID, 0};
+            } else if (response.Status != net::HTTP::status::not_found)
+                throw data::exception {} << "could not get mempool history for " << resource << "; status " << response.Status;
+
+            co_return items;
+        }
+    }
+
+    awaitable<list<history_item>> network::history (const Bitcoin::address &a, uint64 from_height, priority pr, uint64 flow) {
+        return get_history (*this, "address/" + std::string (a), from_height, pr, flow);
+    }
+
+    awaitable<list<history_item>> network::history (const digest256 &script_hash, uint64 from_height, priority pr, uint64 flow) {
+        return get_history (*this, "script/" + write (script_hash), from_height, pr, flow);
+    }
+
+    awaitable<map<Bitcoin::TxID, uint64>> network::mined (list<Bitcoin::TxID> txids, priority pr, uint64 flow) {
+        // WhatsOnChain allows 20 txs per request.
+        constexpr uint32 max_per_request = 20;
+
+        map<Bitcoin::TxID, uint64> heights;
+        while (!data::empty (txids)) {
+            JSON::array_t batch;
+            for (uint32 i = 0; i < max_per_request && !data::empty (txids); i++) {
+                batch.push_back (write (data::first (txids)));
+                txids = data::rest (txids);
+            }
+
+            auto response = co_await call_with_backoff (*this, provider::WhatsOnChain, pr, flow,
+                Endpoints.WhatsOnChain, "/v1/bsv/main/txs/status",
+                boost::beast::http::verb::post, JSON (JSON::object_t {{"txids", batch}}).dump ());
+
+            if (response.Status != net::HTTP::status::ok)
+                throw data::exception {} << "could not get tx status; status " << response.Status;
+
+            for (const JSON &status : JSON::parse (response.Body))
+                if (status.contains ("blockheight") && status["blockheight"].is_number ())
+                    heights = heights.insert (read_TxID (std::string (status["txid"])), uint64 (status["blockheight"]));
+        }
+
+        co_return heights;
     }
 
     // transactions by txid
@@ -132,8 +387,10 @@ namespace Cosmos {
     // script histories by script hash
     map<digest256, list<Bitcoin::TxID>> History;
 
+    // no lock here because we suspend on the IO thread and the scheduler
+    // already limits how many calls go to Gorilla at once.
     awaitable<satoshis_per_byte> network::mining_fee () {
-        std::lock_guard<std::mutex> lock (Mutex);
+        auto ticket = co_await Scheduler.admit (provider::Gorilla, priority::interactive);
         auto z = co_await Gorilla.get_fee_quote ();
 
         if (!z.valid ())
@@ -144,7 +401,30 @@ namespace Cosmos {
         co_return z.Fees["standard"].MiningFee;
     }
 
-    awaitable<double> network::price (monetary_unit, const Bitcoin::timestamp &tm) {
+    std::chrono::milliseconds backoff::operator () (uint32 attempt) const {
+        std::chrono::milliseconds delay = Initial;
+        for (uint32 i = 0; i < attempt && delay < Max; i++) delay *= 2;
+        return delay < Max ? delay : Max;
+    }
+
+    awaitable<void> network::sleep (std::chrono::milliseconds d) {
+        net::asio::steady_timer timer {IO};
+        timer.expires_after (d);
+        co_await timer.async_wait (net::asio::use_awaitable);
+    }
+
+    namespace {
+        // the rate limitation for CoinGecko is hard to understand.
+        // If a call doesn't work we wait and try again.
+        awaitable<JSON> call_CoinGecko (network &net, priority pr, const std::string &target) {
+            auto response = co_await call_with_backoff (net, provider::CoinGecko, pr, 0, net.Endpoints.CoinGecko, target);
+            if (response.Status != net::HTTP::status::ok)
+                throw data::exception {} << "CoinGecko returned status " << response.Status;
+            co_return JSON::parse (response.Body);
+        }
+    }
+
+    awaitable<double> network::price (monetary_unit, const Bitcoin::timestamp &tm, priority pr) {
 
         std::tm time (tm);
 
@@ -153,26 +433,31 @@ namespace Cosmos {
 
         string date = ss.str ();
 
-        auto request = CoinGecko.REST.GET ("/api/v3/coins/bitcoin-cash-sv/history",
-            dispatch<UTF8, UTF8> {
-                entry<const data::UTF8, data::UTF8> {"date", date },
-                entry<const data::UTF8, data::UTF8> {"localization", "false" }
-            });
+        JSON info = co_await call_CoinGecko (*this, pr,
+            string::write ("/api/v3/coins/bitcoin-cash-sv/history?date=", date, "&localization=false"));
 
-        // the rate limitation for this call is hard to understand.
-        // If it doesn't work we wait 30 seconds.
-        while (true) {
+        co_return info["market_data"]["current_price"]["usd"];
+    }
 
-            auto response = co_await CoinGecko (request);
-            if (response.Status == net::HTTP::status::ok) {
-                JSON info = JSON::parse (response.Body);
-                co_return info["market_data"]["current_price"]["usd"];
-            }
+    awaitable<map<Bitcoin::timestamp, double>> network::prices (monetary_unit,
+        const Bitcoin::timestamp &from, const Bitcoin::timestamp &to, priority pr) {
 
-            net::asio::io_context io {};
-            net::asio::steady_timer {io, net::asio::chrono::seconds (30)}.wait ();
+        // for ranges longer than 90 days CoinGecko gives us one point per day.
+        // Otherwise we get hourly points, so we keep the first one of each day.
+        JSON info = co_await call_CoinGecko (*this, pr, string::write ("/api/v3/coins/bitcoin-cash-sv/market_chart/range",
+            "?vs_currency=usd&from=", uint32 (from), "&to=", uint32 (to)));
 
+        const JSON &points = info["prices"];
+        if (!points.is_array ()) throw data::exception {} << "invalid price range response received: " << info;
+
+        map<Bitcoin::timestamp, double> result;
+        for (const JSON &point : points) {
+            uint32 seconds = uint32 (uint64 (point[0]) / 1000);
+            Bitcoin::timestamp day {seconds - seconds % 86400};
+            if (!result.contains (day)) result = result.insert (day, double (point[1]));
         }
+
+        co_return result;
     }
 
     std::ostream &operator << (std::ostream &o, broadcast_result e) {
@@ -183,6 +468,7 @@ namespace Cosmos {
             case (broadcast_result::ERROR_NETWORK_CONNECTION_FAIL) : return o << "could not connect to the network";
             case (broadcast_result::ERROR_INSUFFICIENT_FEE) : return o << "insufficient fee";
             case (broadcast_result::ERROR_INVALID) : return o << "invalid transaction";
+            case (broadcast_result::QUEUED) : return o << "queued for broadcast";
             default: return o << "invalid error";
         }
 
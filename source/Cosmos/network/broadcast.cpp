@@ -0,0 +1,149 @@
+#include <Cosmos/network/broadcast.hpp>
+#include <algorithm>
+
+namespace Cosmos {
+
+    struct broadcast_queue::batch {
+        // txs in the order in which they will be submitted.
+        list<extended_transaction> Txs;
+        uint32 Size;
+
+        // batches with parents of our txs, which must be done before we go.
+        std::vector<ptr<batch>> After;
+
+        broadcast_multiple_result Result;
+
+        // cancelled when the batch has been submitted.
+        net::asio::steady_timer Done;
+        bool Complete;
+
+        batch (data::exec ex): Txs {}, Size {0}, After {}, Result {broadcast_result::ERROR_UNKNOWN},
+            Done {ex, net::asio::steady_timer::time_point::max ()}, Complete {false} {}
+
+        awaitable<void> wait () {
+            if (Complete) co_return;
+            boost::system::error_code ec;
+            co_await Done.async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    };
+
+    awaitable<broadcast_multiple_result> broadcast_queue::operator () (list<extended_transaction> txs) {
+        // the batches that our txs are in.
+        std::vector<ptr<batch>> waiting;
+
+        {
+            std::lock_guard<std::mutex> lock {Mutex};
+
+            ptr<batch> b = nullptr;
+            for (const auto &tx : txs) {
+                auto txid = tx.id ();
+
+                // another request may already have queued some of the same ancestors.
+                if (auto i = InFlight.find (txid); i != InFlight.end ()) {
+                    if (std::find (waiting.begin (), waiting.end (), i->second) == waiting.end ())
+                        waiting.push_back (i->second);
+                    continue;
+                }
+
+                // start a new batch if there is none or if the current one is full.
+                if (b == nullptr) {
+                    if (Next == nullptr || Next->Size >= MaxBatchSize) {
+                        Next = std::make_shared<batch> (Net.IO);
+                        net::asio::co_spawn (Net.IO, flush (Next), net::asio::detached);
+                    }
+
+                    b = Next;
+                    if (std::find (waiting.begin (), waiting.end (), b) == waiting.end ()) waiting.push_back (b);
+                }
+
+                // parents that went into earlier batches must be submitted first.
+                for (const ptr<batch> &w : waiting)
+                    if (w != b && std::find (b->After.begin (), b->After.end (), w) == b->After.end ())
+                        b->After.push_back (w);
+
+                b->Txs <<= tx;
+                b->Size++;
+                InFlight[txid] = b;
+            }
+        }
+
+        for (const ptr<batch> &w : waiting) co_await w->wait ();
+
+        broadcast_multiple_result result {list<ARC::status> {}};
+        for (const ptr<batch> &w : waiting) {
+            result.Status = result.Status + w->Result.Status;
+            if (bool (result) && !bool (w->Result)) {
+                result.Error = w->Result.Error;
+                result.Details = w->Result.Details;
+            }
+        }
+
+        co_return result;
+    }
+
+    awaitable<broadcast_multiple_result> broadcast_queue::submit (list<extended_transaction> txs) {
+        for (uint32 attempt = 0; true; attempt++) {
+            broadcast_multiple_result result = co_await Net.broadcast (txs);
+
+            if (result.Error != broadcast_result::ERROR_NETWORK_CONNECTION_FAIL ||
+                attempt + 1 >= Retry.MaxAttempts) co_return result;
+
+            auto delay = Retry (attempt);
+            DATA_LOG (warning) << "could not connect to broadcast " << txs.size () <<
+                " txs; trying again in " << delay.count () << " milliseconds";
+
+            co_await Net.sleep (delay);
+        }
+    }
+
+    awaitable<void> broadcast_queue::flush (ptr<batch> b) {
+        // give other requests a chance to add their txs.
+        co_await Net.sleep (Linger);
+
+        list<extended_transaction> remaining;
+        std::vector<ptr<batch>> after;
+        {
+            std::lock_guard<std::mutex> lock {Mutex};
+            if (Next == b) Next = nullptr;
+            remaining = b->Txs;
+            after = b->After;
+        }
+
+        for (const ptr<batch> &a : after) co_await a->wait ();
+
+        broadcast_multiple_result result {list<ARC::status> {}};
+
+        // submit in chunks of at most MaxBatchSize, keeping the order.
+        while (!data::empty (remaining)) {
+            list<extended_transaction> chunk;
+            for (uint32 i = 0; i < MaxBatchSize && !data::empty (remaining); i++) {
+                chunk <<= data::first (remaining);
+                remaining = data::rest (remaining);
+            }
+
+            broadcast_multiple_result submitted = co_await submit (chunk);
+            result.Status = result.Status + submitted.Status;
+
+            // children of txs in a failed chunk cannot be accepted, so we stop here.
+            if (!bool (submitted)) {
+                result.Error = submitted.Error;
+                result.Details = submitted.Details;
+                break;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {Mutex};
+            for (const auto &tx : b->Txs)
+                if (auto i = InFlight.find (tx.id ()); i != InFlight.end () && i->second == b) InFlight.erase (i);
+
+            b->Result = result;
+            b->Complete = true;
+            // we don't need these anymore.
+            b->After.clear ();
+        }
+
+        b->Done.cancel ();
+    }
+
+}
@@ -0,0 +1,23 @@
+#include <Cosmos/network/hedge.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace Cosmos {
+
+    void latency::record (std::chrono::milliseconds d) {
+        Samples.push_back (d);
+        while (Samples.size () > Window) Samples.pop_front ();
+    }
+
+    std::chrono::milliseconds latency::p95 (std::chrono::milliseconds fallback) const {
+        // with fewer than this we don't really know what the tail looks like.
+        constexpr uint32 min_samples = 20;
+        if (Samples.size () < min_samples) return fallback;
+
+        std::vector<std::chrono::milliseconds> sorted (Samples.begin (), Samples.end ());
+        auto p = sorted.begin () + (sorted.size () * 95) / 100;
+        std::nth_element (sorted.begin (), p, sorted.end ());
+        return *p;
+    }
+
+}
@@ -0,0 +1,205 @@
+#include <Cosmos/network/outbox.hpp>
+#include <Cosmos/pay.hpp>
+
+namespace Cosmos {
+
+    outgoing_payment::outgoing_payment (maybe<std::string> wallet, const account &before, list<account_diff> diffs):
+        Wallet {wallet}, Diffs {diffs}, Undo {} {
+
+        std::set<Bitcoin::TxID> txids;
+        for (const account_diff &d : diffs) txids.insert (d.TxID);
+
+        // outputs that were spent by the payment, by the tx that made them.
+        std::map<Bitcoin::TxID, map<Bitcoin::index, redeemable>> spent;
+        // outputs of the payment that were spent by a later tx in the payment.
+        std::set<Bitcoin::outpoint> spent_within;
+        for (const account_diff &d : diffs)
+            for (const auto &[_, op] : d.Remove)
+                if (txids.contains (op.Digest)) spent_within.insert (op);
+                else {
+                    const auto *r = before.contains (op);
+                    if (!bool (r)) throw account::cannot_apply_diff {};
+                    spent[op.Digest] = spent[op.Digest].insert (op.Index, *r);
+                }
+
+        for (const account_diff &d : diffs) {
+            map<Bitcoin::index, Bitcoin::outpoint> remove;
+            for (const auto &[i, _] : d.Insert)
+                if (Bitcoin::outpoint op {d.TxID, i}; !spent_within.contains (op)) remove = remove.insert (i, op);
+            if (remove.size () > 0) Undo <<= account_diff {d.TxID, {}, remove};
+        }
+
+        for (const auto &[txid, insert] : spent) Undo <<= account_diff {txid, insert, {}};
+    }
+
+    outgoing_payment::outgoing_payment (const JSON &j): Wallet {}, Diffs {}, Undo {} {
+        // older notes are just the diffs.
+        if (j.is_array ()) {
+            Diffs = read_account_diffs (j);
+            return;
+        }
+
+        if (!j.is_object () || !j.contains ("diffs") || !j.contains ("undo"))
+            throw data::exception {} << "invalid outbox note " << j;
+
+        if (j.contains ("wallet") && j["wallet"].is_string ()) Wallet = std::string (j["wallet"]);
+        Diffs = read_account_diffs (j["diffs"]);
+        Undo = read_account_diffs (j["undo"]);
+    }
+
+    outgoing_payment::operator JSON () const {
+        return JSON::object_t {
+            {"wallet", bool (Wallet) ? JSON (*Wallet) : JSON (nullptr)},
+            {"diffs", write_account_diffs (Diffs)},
+            {"undo", write_account_diffs (Undo)}};
+    }
+
+    list<account_diff> outgoing_payment::undo (const account &current) const {
+        list<account_diff> diffs;
+        for (const account_diff &d : Undo) {
+            map<Bitcoin::index, Bitcoin::outpoint> remove;
+            for (const auto &[i, op] : d.Remove) if (bool (current.contains (op))) remove = remove.insert (i, op);
+            if (d.Insert.size () > 0 || remove.size () > 0) diffs <<= account_diff {d.TxID, d.Insert, remove};
+        }
+
+        return diffs;
+    }
+
+    void outbox_flusher::undo (const outgoing &o) {
+        if (Wallets == nullptr) return;
+
+        try {
+            outgoing_payment p {o.Note};
+            if (!bool (p.Wallet)) {
+                DATA_LOG (warning) << "a rejected payment in the outbox names no wallet and must be undone by hand: " << o.Note;
+                return;
+            }
+
+            Wallets->update_wallet_account (*p.Wallet, p.undo (Wallets->get_wallet_account (*p.Wallet)));
+            DATA_LOG (normal) << "a rejected payment from wallet " << *p.Wallet << " has been undone";
+        } catch (const std::exception &x) {
+            DATA_LOG (warning) << "could not undo a rejected payment in the outbox: " << x.what () << "; " << o.Note;
+        }
+    }
+
+    awaitable<outbox_flusher::result> outbox_flusher::flush () {
+        result r {};
+
+        // entries come out in the order they were queued, so parents go before children.
+        list<entry<uint64, outgoing>> queued = TXDB.Local.get_outgoing ();
+
+        while (!data::empty (queued)) {
+            // take whole entries until the batch is full.
+            list<entry<uint64, outgoing>> batch;
+            list<extended_transaction> txs;
+            set<Bitcoin::TxID> included;
+            while (!data::empty (queued)) {
+                entry<uint64, outgoing> e = data::first (queued);
+                if (!data::empty (batch) && txs.size () + e.Value.Txs.size () > MaxBatchSize) break;
+
+                // a later payment may include unconfirmed ancestors that are also in an earlier entry.
+                for (const auto &tx : e.Value.Txs) {
+                    auto txid = tx.id ();
+                    if (included.contains (txid)) continue;
+                    included = included.insert (txid);
+                    txs <<= tx;
+                }
+
+                batch <<= e;
+                queued = data::rest (queued);
+            }
+
+            broadcast_multiple_result submitted = co_await (*TXDB.Broadcasts) (txs);
+
+            if (submitted.Error == broadcast_result::ERROR_NETWORK_CONNECTION_FAIL) {
+                r.Connected = false;
+                co_return r;
+            }
+
+            if (bool (submitted)) {
+                auto sub = TXDB.record_broadcast (txs, submitted);
+                for (const auto &e : batch) {
+                    TXDB.Local.remove_outgoing (e.Key);
+
+                    // the call can succeed while some txs are rejected.
+                    bool accepted = true;
+                    for (const auto &tx : e.Value.Txs)
+                        if (auto single = sub.contains (tx.id ()); !bool (single) || !bool (*single)) accepted = false;
+
+                    if (accepted) r.Broadcast++;
+                    else {
+                        DATA_LOG (warning) << "outbox entry " << e.Key << " was rejected";
+                        undo (e.Value);
+                        r.Rejected <<= e.Value;
+                    }
+                }
+
+                continue;
+            }
+
+            // something in the batch was rejected. Try each entry
+            // on its own to find out which ones.
+            for (const auto &e : batch) {
+                broadcast_multiple_result single = batch.size () == 1 ? submitted : co_await (*TXDB.Broadcasts) (e.Value.Txs);
+
+                if (single.Error == broadcast_result::ERROR_NETWORK_CONNECTION_FAIL) {
+                    r.Connected = false;
+                    co_return r;
+                }
+
+                auto sub = TXDB.record_broadcast (e.Value.Txs, single);
+                TXDB.Local.remove_outgoing (e.Key);
+
+                bool accepted = bool (single);
+                for (const auto &tx : e.Value.Txs)
+                    if (auto one = sub.contains (tx.id ()); !bool (one) || !bool (*one)) accepted = false;
+
+                if (accepted) r.Broadcast++;
+                else {
+                    DATA_LOG (warning) << "outbox entry " << e.Key << " was rejected: " << broadcast_result (single);
+                    undo (e.Value);
+                    r.Rejected <<= e.Value;
+                }
+            }
+        }
+
+        co_return r;
+    }
+
+    awaitable<void> outbox_flusher::run () {
+        Wake = std::make_shared<net::asio::steady_timer> (TXDB.Net.IO);
+        uint32 failures = 0;
+
+        while (!Stopped) {
+            std::chrono::milliseconds wait = Interval;
+
+            try {
+                if (!data::empty (TXDB.Local.get_outgoing ())) {
+                    result r = co_await flush ();
+
+                    if (r.Broadcast > 0) DATA_LOG (normal) << r.Broadcast << " payments in the outbox were broadcast";
+
+                    if (Wallets == nullptr) for (const outgoing &o : r.Rejected)
+                        DATA_LOG (warning) << "payment in the outbox was rejected and must be undone: " << o.Note;
+
+                    if (!r.Connected) wait = Retry (failures++);
+                    else failures = 0;
+                }
+            } catch (const std::exception &x) {
+                DATA_LOG (warning) << "could not flush the outbox: " << x.what ();
+            }
+
+            if (Stopped) break;
+
+            boost::system::error_code ec;
+            Wake->expires_after (wait);
+            co_await Wake->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    }
+
+    void outbox_flusher::stop () {
+        Stopped = true;
+        if (Wake != nullptr) Wake->cancel ();
+    }
+
+}
@@ -0,0 +1,331 @@
+#include <Cosmos/network/p2p.hpp>
+#include <Cosmos/serialize.hpp>
+#include <random>
+#include <algorithm>
+
+namespace Cosmos {
+
+    namespace beast = boost::beast;
+    using tcp = net::asio::ip::tcp;
+
+    namespace {
+
+        // the protocol version that we speak.
+        constexpr uint32 protocol_version = 70016;
+
+        // headers messages have at most this many headers.
+        constexpr uint32 max_headers = 2000;
+
+        // we won't read messages bigger than this.
+        constexpr uint32 max_message_size = 256 * 1024 * 1024;
+
+        // inventory types.
+        constexpr uint32 inv_tx = 1;
+        constexpr uint32 inv_block = 2;
+
+        using namespace serialize;
+
+        // the first four bytes of the double SHA2_256 of the payload.
+        uint32 checksum (data::byte_slice payload) {
+            digest256 d = data::crypto::Bitcoin_256 (payload);
+            return reader {data::byte_slice (d)}.read_uint (4);
+        }
+
+        struct message {
+            std::string Command;
+            bytes Payload;
+        };
+
+        // a connection to a node along with how much we have sent and received.
+        struct wire {
+            beast::tcp_stream &Stream;
+            uint32 Magic;
+            std::chrono::milliseconds Timeout;
+            uint64 BytesSent {0};
+            uint64 BytesReceived {0};
+
+            awaitable<void> send (const std::string &command, const bytes &payload) {
+                bytes msg;
+                write_uint (msg, Magic, 4);
+                for (size_t i = 0; i < 12; i++) msg.push_back (i < command.size () ? byte (command[i]) : byte (0));
+                write_uint (msg, payload.size (), 4);
+                write_uint (msg, checksum (payload), 4);
+                write_bytes (msg, payload);
+
+                Stream.expires_after (Timeout);
+                co_await net::asio::async_write (Stream, net::asio::buffer (msg.data (), msg.size ()), net::asio::use_awaitable);
+                BytesSent += msg.size ();
+            }
+
+            awaitable<message> receive () {
+                bytes header (24);
+                Stream.expires_after (Timeout);
+                co_await net::asio::async_read (Stream, net::asio::buffer (header.data (), header.size ()), net::asio::use_awaitable);
+
+                reader r {header};
+                if (r.read_uint (4) != Magic) throw data::exception {} << "wrong network magic";
+
+                auto command_bytes = r.read (12);
+                std::string command;
+                for (byte b : command_bytes) if (b != 0) command.push_back (char (b));
+
+                uint32 size = r.read_uint (4);
+                uint32 check = r.read_uint (4);
+                if (size > max_message_size) throw data::exception {} << "message " << command << " is too big";
+
+                bytes payload (size);
+                if (size > 0) co_await net::asio::async_read (Stream,
+                    net::asio::buffer (payload.data (), payload.size ()), net::asio::use_awaitable);
+
+                BytesReceived += 24 + size;
+
+                if (checksum (payload) != check) throw data::exception {} << "bad checksum on " << command;
+
+                co_return message {command, payload};
+            }
+        };
+
+        void write_net_address (bytes &b, const tcp::endpoint &e) {
+            // services
+            write_uint (b, 0, 8);
+            auto ip = e.address ().is_v4 () ?
+                net::asio::ip::make_address_v6 (net::asio::ip::v4_mapped, e.address ().to_v4 ()) :
+                e.address ().to_v6 ();
+            auto ip_bytes = ip.to_bytes ();
+            b.insert (b.end (), ip_bytes.begin (), ip_bytes.end ());
+            // port is big endian.
+            b.push_back (byte (e.port () >> 8));
+            b.push_back (byte (e.port ()));
+        }
+
+        bytes version (const tcp::endpoint &remote, bool relay) {
+            static std::random_device random;
+
+            bytes b;
+            write_uint (b, protocol_version, 4);
+            // we don't provide any services.
+            write_uint (b, 0, 8);
+            write_uint (b, uint32 (Bitcoin::timestamp::now ()), 8);
+            write_net_address (b, remote);
+            write_net_address (b, tcp::endpoint {});
+            write_uint (b, (uint64 (random ()) << 32) | random (), 8);
+
+            std::string agent = "/Cosmos:0.1/";
+            write_var_int (b, agent.size ());
+            b.insert (b.end (), agent.begin (), agent.end ());
+
+            // start height, which nobody relies on.
+            write_uint (b, 0, 4);
+            b.push_back (relay ? 1 : 0);
+            return b;
+        }
+
+        bytes inventory (uint32 type, const list<digest256> &hashes) {
+            bytes b;
+            write_var_int (b, hashes.size ());
+            for (const digest256 &h : hashes) {
+                write_uint (b, type, 4);
+                write_bytes (b, data::byte_slice (h));
+            }
+            return b;
+        }
+
+        std::pair<std::string, std::string> split_address (const std::string &address) {
+            auto colon = address.rfind (':');
+            if (colon == std::string::npos) return {address, "8333"};
+            return {address.substr (0, colon), address.substr (colon + 1)};
+        }
+    }
+
+    list<std::string> p2p_client::candidates () {
+        list<std::string> result;
+        std::set<std::string> seen;
+        for (const peer_record &p : Peers.peers (Options.MaxPeers * 4))
+            if (p.FriendshipScore >= Options.MinFriendshipScore && seen.insert (p.Address).second) result <<= p.Address;
+
+        for (const std::string &seed : Options.Seeds)
+            if (seen.insert (seed).second) result <<= seed;
+
+        return result;
+    }
+
+    awaitable<void> p2p_client::run () {
+        Wake = std::make_shared<net::asio::steady_timer> (IO);
+
+        while (!Stopped) {
+            for (const std::string &address : candidates ()) {
+                if (Streams.size () >= Options.MaxPeers) break;
+                if (Streams.contains (address)) continue;
+
+                Streams[address] = std::make_shared<beast::tcp_stream> (IO);
+                net::asio::co_spawn (IO, [this, address] () -> awaitable<void> {
+                    co_await session (address);
+                    Streams.erase (address);
+                }, net::asio::detached);
+            }
+
+            Wake->expires_after (Options.Reconnect);
+            boost::system::error_code ec;
+            co_await Wake->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    }
+
+    void p2p_client::stop () {
+        Stopped = true;
+        if (Wake != nullptr) Wake->cancel ();
+        for (auto &[_, stream] : Streams) stream->close ();
+    }
+
+    maybe<bytes> p2p_client::get_headers () const {
+        auto latest = Local.latest ();
+        // without a header to start from we would not know the heights of new ones.
+        if (!bool (latest)) return {};
+
+        bytes b;
+        write_uint (b, protocol_version, 4);
+        write_var_int (b, 1);
+        write_bytes (b, data::byte_slice (latest->Value.hash ()));
+        // no stop hash, so we get as many as the peer will give us.
+        write_bytes (b, data::byte_slice (digest256 {}));
+        return b;
+    }
+
+    uint32 p2p_client::accept_headers (data::byte_slice payload, bool &more) {
+        reader r {payload};
+        uint64 count = r.read_var_int ();
+        more = count == max_headers;
+
+        uint32 accepted = 0;
+        for (uint64 i = 0; i < count; i++) {
+            byte_array<80> raw;
+            auto x = r.read (80);
+            std::copy (x.begin (), x.end (), raw.begin ());
+            // tx count, which is always zero.
+            r.read_var_int ();
+
+            Bitcoin::header h {raw};
+            if (!h.valid ()) throw data::exception {} << "peer sent an invalid header";
+
+            if (bool (Local.header (h.hash ()))) continue;
+
+            // we can only add headers that connect to those we have.
+            auto previous = Local.header (h.Previous);
+            if (!bool (previous)) {
+                more = false;
+                break;
+            }
+
+            if (bool (Local.insert (previous->Key + 1, h))) accepted++;
+        }
+
+        return accepted;
+    }
+
+    bool p2p_client::accept_transaction (data::byte_slice raw) {
+        Bitcoin::transaction tx {bytes (raw)};
+        if (!tx.valid ()) return false;
+
+        bool watched = false;
+        for (const Bitcoin::output &out : tx.Outputs)
+            if (Watched.contains (Gigamonkey::SHA2_256 (out.Script))) {
+                watched = true;
+                break;
+            }
+
+        if (!watched) return false;
+
+        if (Local.transaction (tx.id ()).Transaction == nullptr) {
+            DATA_LOG (normal) << "peer relayed watched tx " << tx.id ();
+            // index its outputs so that it shows up in the history of the scripts we watch.
+            Local.import_transactions (list<std::pair<Bitcoin::transaction, maybe<Merkle::proof>>> {{tx, {}}});
+        }
+
+        return true;
+    }
+
+    awaitable<void> p2p_client::session (std::string address) {
+        auto stream = Streams[address];
+        auto start = std::chrono::steady_clock::now ();
+
+        maybe<peer_record> known = Peers.peer (address);
+        peer_record record = bool (known) ? *known : peer_record {address, false, 0, 0, 0, 0};
+
+        wire w {*stream, Options.Magic, Options.Timeout};
+        bool connected = false;
+
+        // how useful this peer has been.
+        int useful = 0;
+
+        try {
+            auto [host, port] = split_address (address);
+            tcp::resolver resolver {IO};
+            auto endpoints = co_await resolver.async_resolve (host, port, net::asio::use_awaitable);
+
+            stream->expires_after (Options.Timeout);
+            tcp::endpoint remote = co_await stream->async_connect (endpoints, net::asio::use_awaitable);
+
+            co_await w.send ("version", version (remote, !Watched.empty ()));
+
+            bool got_version = false;
+            bool got_verack = false;
+            while (!Stopped) {
+                message m = co_await w.receive ();
+
+                if (m.Command == "version") {
+                    got_version = true;
+                    co_await w.send ("verack", bytes {});
+                } else if (m.Command == "verack") got_verack = true;
+                else if (m.Command == "ping") co_await w.send ("pong", m.Payload);
+                else if (m.Command == "headers") {
+                    bool more;
+                    uint32 accepted = accept_headers (m.Payload, more);
+                    if (accepted > 0) {
+                        DATA_LOG (normal) << "got " << accepted << " new headers from " << address;
+                        useful++;
+                    }
+
+                    if (more) if (auto request = get_headers (); bool (request)) co_await w.send ("getheaders", *request);
+                } else if (m.Command == "inv") {
+                    reader r {m.Payload};
+                    uint64 count = r.read_var_int ();
+                    list<digest256> txs;
+                    bool new_block = false;
+                    for (uint64 i = 0; i < count; i++) {
+                        uint32 type = r.read_uint (4);
+                        digest256 hash;
+                        auto x = r.read (32);
+                        std::copy (x.begin (), x.end (), hash.begin ());
+
+                        if (type == inv_block) new_block = true;
+                        else if (type == inv_tx && !Watched.empty () &&
+                            Local.transaction (Bitcoin::TxID {hash}).Transaction == nullptr) txs <<= hash;
+                    }
+
+                    if (!data::empty (txs)) co_await w.send ("getdata", inventory (inv_tx, txs));
+                    if (new_block) if (auto request = get_headers (); bool (request)) co_await w.send ("getheaders", *request);
+                } else if (m.Command == "tx") {
+                    if (accept_transaction (m.Payload)) useful++;
+                }
+
+                // once the handshake is done, ask for headers.
+                if (!connected && got_version && got_verack) {
+                    connected = true;
+                    DATA_LOG (normal) << "connected to peer " << address;
+                    if (auto request = get_headers (); bool (request)) co_await w.send ("getheaders", *request);
+                }
+            }
+        } catch (const std::exception &x) {
+            DATA_LOG (debug) << "disconnected from peer " << address << ": " << x.what ();
+        }
+
+        stream->close ();
+
+        record.Success = connected;
+        record.Duration = std::chrono::duration_cast<std::chrono::milliseconds> (std::chrono::steady_clock::now () - start).count ();
+        record.BytesReceived = w.BytesReceived;
+        record.BytesSent = w.BytesSent;
+        record.FriendshipScore = std::clamp (record.FriendshipScore + (connected ? 1 + useful : -2), -100, 100);
+        Peers.set_peer (record);
+    }
+
+}
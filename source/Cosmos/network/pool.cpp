@@ -0,0 +1,297 @@
+#include <Cosmos/network/pool.hpp>
+#include <io/log.hpp>
+
+namespace Cosmos {
+
+    namespace beast = boost::beast;
+    namespace http = beast::http;
+
+    std::string host::authority () const {
+        if (Port == (secure () ? 443 : 80)) return Name;
+        return Name + ":" + std::to_string (Port);
+    }
+
+    host host::read (const std::string &url) {
+        std::string protocol = "https";
+        std::string rest = url;
+
+        auto scheme = url.find ("://");
+        if (scheme != std::string::npos) {
+            protocol = url.substr (0, scheme);
+            rest = url.substr (scheme + 3);
+        }
+
+        if (protocol != "http" && protocol != "https") throw data::exception {} << "unsupported protocol in " << url;
+
+        // ignore any path.
+        rest = rest.substr (0, rest.find ('/'));
+
+        auto colon = rest.rfind (':');
+        if (colon == std::string::npos) return host {protocol, rest};
+        return host {protocol, rest.substr (0, colon), static_cast<uint16> (std::stoul (rest.substr (colon + 1)))};
+    }
+
+    std::ostream &operator << (std::ostream &o, const host &h) {
+        return o << h.Protocol << "://" << h.authority ();
+    }
+
+    struct connection_pool::connection {
+        // only one of these is used, depending on whether the host uses TLS.
+        std::unique_ptr<beast::tcp_stream> Plain;
+        std::unique_ptr<beast::ssl_stream<beast::tcp_stream>> Secure;
+
+        beast::flat_buffer Buffer;
+        std::chrono::steady_clock::time_point LastUsed;
+
+        beast::tcp_stream &tcp () {
+            return Secure != nullptr ? beast::get_lowest_layer (*Secure) : *Plain;
+        }
+
+        void close () {
+            boost::system::error_code ec;
+            tcp ().socket ().shutdown (net::asio::ip::tcp::socket::shutdown_both, ec);
+            tcp ().close ();
+        }
+    };
+
+    struct connection_pool::host_state {
+        // most recently used at the back.
+        std::list<ptr<connection>> Idle;
+
+        // both idle and in use.
+        uint32 Open;
+
+        // the last TLS session, so that new connections can resume it.
+        std::shared_ptr<SSL_SESSION> Session;
+
+        // requests waiting for a connection, oldest first. Each has its own
+        // timer, which is cancelled to wake it, so that only one wakes up
+        // each time a connection becomes available.
+        std::deque<ptr<net::asio::steady_timer>> Waiting;
+
+        host_state (): Idle {}, Open {0}, Session {nullptr}, Waiting {} {}
+
+        void notify_one () {
+            // a waiter whose coroutine was destroyed has nothing to cancel, so we skip it.
+            while (!Waiting.empty ()) {
+                ptr<net::asio::steady_timer> next = Waiting.front ();
+                Waiting.pop_front ();
+                if (next->cancel () > 0) return;
+            }
+        }
+
+        void save_session (connection &c) {
+            if (c.Secure == nullptr) return;
+            // with TLS 1.3, session tickets come after the handshake, so we
+            // check again every time we are done with a connection.
+            if (SSL_SESSION *s = SSL_get1_session (c.Secure->native_handle ()); s != nullptr)
+                Session = std::shared_ptr<SSL_SESSION> (s, SSL_SESSION_free);
+        }
+
+        void discard (ptr<connection> c) {
+            c->close ();
+            Open--;
+            notify_one ();
+        }
+    };
+
+    struct connection_pool::sweeper {
+        net::asio::steady_timer Timer;
+
+        // whether a sweep coroutine is running.
+        bool Running;
+
+        // set when the pool is destroyed.
+        bool Stopped;
+
+        sweeper (data::exec ex): Timer {ex}, Running {false}, Stopped {false} {}
+    };
+
+    connection_pool::connection_pool (data::exec io, ptr<net::HTTP::SSL> ssl, const options &o):
+        IO {io}, SSL {ssl}, Options {o}, Hosts {}, Sweeper {std::make_shared<sweeper> (io)} {}
+
+    connection_pool::~connection_pool () {
+        Sweeper->Stopped = true;
+        Sweeper->Timer.cancel ();
+    }
+
+    maybe<std::chrono::steady_clock::time_point> connection_pool::next_eviction () const {
+        maybe<std::chrono::steady_clock::time_point> next;
+        for (const auto &[h, hs] : Hosts)
+            if (!hs->Idle.empty () && (!bool (next) || hs->Idle.front ()->LastUsed + Options.IdleTimeout < *next))
+                next = hs->Idle.front ()->LastUsed + Options.IdleTimeout;
+        return next;
+    }
+
+    awaitable<void> connection_pool::sweep (ptr<sweeper> s) {
+        // s is held here so that it outlives the pool, which we must
+        // not touch once it is stopped.
+        while (true) {
+            auto next = next_eviction ();
+            if (!bool (next)) break;
+
+            s->Timer.expires_at (*next);
+            boost::system::error_code ec;
+            co_await s->Timer.async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+            if (s->Stopped) co_return;
+
+            evict ();
+        }
+
+        s->Running = false;
+    }
+
+    uint32 connection_pool::open (const host &h) const {
+        auto hs = Hosts.find (h);
+        return hs == Hosts.end () ? 0 : hs->second->Open;
+    }
+
+    void connection_pool::evict () {
+        auto now = std::chrono::steady_clock::now ();
+        for (auto &[h, hs] : Hosts)
+            while (!hs->Idle.empty () && now - hs->Idle.front ()->LastUsed > Options.IdleTimeout) {
+                DATA_LOG (debug) << "closing idle connection to " << h;
+                hs->discard (hs->Idle.front ());
+                hs->Idle.pop_front ();
+            }
+    }
+
+    awaitable<ptr<connection_pool::connection>> connection_pool::acquire (const host &h, bool &reused) {
+        evict ();
+
+        auto it = Hosts.find (h);
+        if (it == Hosts.end ()) it = Hosts.emplace (h, std::make_shared<host_state> ()).first;
+        ptr<host_state> hs = it->second;
+
+        while (true) {
+            if (!hs->Idle.empty ()) {
+                ptr<connection> c = hs->Idle.back ();
+                hs->Idle.pop_back ();
+                reused = true;
+                co_return c;
+            }
+
+            if (hs->Open < Options.MaxConnectionsPerHost) {
+                hs->Open++;
+                ptr<connection> c;
+                try {
+                    c = co_await connect (h, *hs);
+                } catch (...) {
+                    hs->Open--;
+                    hs->notify_one ();
+                    throw;
+                }
+
+                reused = false;
+                co_return c;
+            }
+
+            // wait for another request to finish with its connection.
+            auto wait = std::make_shared<net::asio::steady_timer> (IO, net::asio::steady_timer::time_point::max ());
+            hs->Waiting.push_back (wait);
+            boost::system::error_code ec;
+            co_await wait->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    }
+
+    awaitable<ptr<connection_pool::connection>> connection_pool::connect (const host &h, host_state &hs) {
+        net::asio::ip::tcp::resolver resolver {IO};
+        auto endpoints = co_await resolver.async_resolve (h.Name, std::to_string (h.Port), net::asio::use_awaitable);
+
+        auto c = std::make_shared<connection> ();
+
+        if (!h.secure ()) {
+            c->Plain = std::make_unique<beast::tcp_stream> (IO);
+            c->Plain->expires_after (std::chrono::seconds {30});
+            co_await c->Plain->async_connect (endpoints, net::asio::use_awaitable);
+            co_return c;
+        }
+
+        c->Secure = std::make_unique<beast::ssl_stream<beast::tcp_stream>> (IO, *SSL);
+        SSL *native = c->Secure->native_handle ();
+
+        // SNI, which many hosts require.
+        if (!SSL_set_tlsext_host_name (native, h.Name.c_str ()))
+            throw data::exception {} << "could not set TLS host name for " << h;
+
+        c->Secure->set_verify_callback (net::asio::ssl::host_name_verification (h.Name));
+
+        if (hs.Session != nullptr) SSL_set_session (native, hs.Session.get ());
+
+        c->tcp ().expires_after (std::chrono::seconds {30});
+        co_await c->tcp ().async_connect (endpoints, net::asio::use_awaitable);
+        co_await c->Secure->async_handshake (net::asio::ssl::stream_base::client, net::asio::use_awaitable);
+
+        DATA_LOG (debug) << "connected to " << h << (SSL_session_reused (native) ? " resuming TLS session" : "");
+
+        hs.save_session (*c);
+        co_return c;
+    }
+
+    void connection_pool::release (const host &h, ptr<connection> c) {
+        host_state &hs = *Hosts.at (h);
+        hs.save_session (*c);
+        c->LastUsed = std::chrono::steady_clock::now ();
+        hs.Idle.push_back (c);
+        hs.notify_one ();
+
+        if (!Sweeper->Running) {
+            Sweeper->Running = true;
+            net::asio::co_spawn (IO, sweep (Sweeper), net::asio::detached);
+        }
+    }
+
+    awaitable<net::HTTP::response> connection_pool::operator () (const host &h,
+        http::verb verb, const std::string &target,
+        const std::string &body, const std::string &content_type) {
+
+        http::request<http::string_body> req {verb, target, 11};
+        req.set (http::field::host, h.authority ());
+        req.set (http::field::user_agent, "Cosmos Wallet");
+        req.keep_alive (true);
+        if (body.size () > 0 || verb == http::verb::post) {
+            if (content_type.size () > 0) req.set (http::field::content_type, content_type);
+            req.body () = body;
+            req.prepare_payload ();
+        }
+
+        for (uint32 attempt = 0; true; attempt++) {
+            bool reused;
+            ptr<connection> c = co_await acquire (h, reused);
+            host_state &hs = *Hosts.at (h);
+
+            // the default limit of 8 MB is too small for big txs.
+            http::response_parser<http::string_body> parser;
+            parser.body_limit (Options.MaxBodySize);
+            boost::system::error_code ec;
+
+            c->tcp ().expires_after (std::chrono::seconds {30});
+            if (c->Secure != nullptr) {
+                co_await http::async_write (*c->Secure, req, net::asio::redirect_error (net::asio::use_awaitable, ec));
+                if (!ec) co_await http::async_read (*c->Secure, c->Buffer, parser, net::asio::redirect_error (net::asio::use_awaitable, ec));
+            } else {
+                co_await http::async_write (*c->Plain, req, net::asio::redirect_error (net::asio::use_awaitable, ec));
+                if (!ec) co_await http::async_read (*c->Plain, c->Buffer, parser, net::asio::redirect_error (net::asio::use_awaitable, ec));
+            }
+
+            if (ec) {
+                hs.discard (c);
+                if (reused && attempt == 0) {
+                    DATA_LOG (debug) << "reused connection to " << h << " failed with " << ec.message () << "; trying a new one";
+                    continue;
+                }
+
+                throw boost::system::system_error {ec};
+            }
+
+            http::response<http::string_body> res = parser.release ();
+            if (res.keep_alive ()) release (h, c);
+            else hs.discard (c);
+
+            co_return net::HTTP::response (res.result_int (),
+                {{"content-type", std::string (res[http::field::content_type])}},
+                bytes (data::string (res.body ())));
+        }
+    }
+
+}
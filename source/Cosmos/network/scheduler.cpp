@@ -0,0 +1,227 @@
+#include <Cosmos/network/scheduler.hpp>
+#include <net/asio/async.hpp>
+#include <algorithm>
+
+namespace Cosmos {
+
+    std::ostream &operator << (std::ostream &o, provider p) {
+        switch (p) {
+            case provider::WhatsOnChain: return o << "WhatsOnChain";
+            case provider::WhatsOnChainMirror: return o << "WhatsOnChain mirror";
+            case provider::Gorilla: return o << "GorillaPool";
+            case provider::CoinGecko: return o << "CoinGecko";
+            case provider::TAAL: return o << "TAAL";
+            default: return o << "(invalid provider)";
+        }
+    }
+
+    std::map<provider, scheduler::limit> scheduler::default_limits () {
+        return {
+            // WhatsOnChain allows 3 requests per second without an API key.
+            {provider::WhatsOnChain, limit {3, 3, 8}},
+            {provider::WhatsOnChainMirror, limit {3, 3, 8}},
+            {provider::Gorilla, limit {5, 5, 4}},
+            // CoinGecko allows roughly 30 requests per minute.
+            {provider::CoinGecko, limit {.5, 5, 2}},
+            {provider::TAAL, limit {10, 10, 8}}};
+    }
+
+    struct scheduler::waiter {
+        // cancelled when the request may go.
+        net::asio::steady_timer Granted;
+        bool Done;
+
+        waiter (data::exec ex): Granted {ex, net::asio::steady_timer::time_point::max ()}, Done {false} {}
+    };
+
+    struct scheduler::queue {
+        limit Limit;
+
+        double Tokens;
+        std::chrono::steady_clock::time_point LastRefill;
+
+        uint32 InFlight;
+
+        // for each priority, the waiters of each flow.
+        std::array<std::map<uint64, std::deque<ptr<waiter>>>, 3> Waiting;
+
+        // the last flow served at each priority.
+        std::array<uint64, 3> LastFlow;
+
+        net::asio::steady_timer Refill;
+        bool RefillScheduled;
+
+        queue (data::exec ex, const limit &l): Limit {l}, Tokens {l.Burst},
+            LastRefill {std::chrono::steady_clock::now ()}, InFlight {0},
+            Waiting {}, LastFlow {}, Refill {ex}, RefillScheduled {false} {}
+
+        void refill () {
+            auto now = std::chrono::steady_clock::now ();
+            if (Limit.Rate > 0) Tokens = std::min (Limit.Burst,
+                Tokens + std::chrono::duration<double> (now - LastRefill).count () * Limit.Rate);
+            LastRefill = now;
+        }
+
+        bool has_tokens () const {
+            return Limit.Rate <= 0 || Tokens >= 1;
+        }
+
+        bool can_go () const {
+            return has_tokens () && (Limit.MaxInFlight == 0 || InFlight < Limit.MaxInFlight);
+        }
+
+        void take () {
+            if (Limit.Rate > 0) Tokens -= 1;
+            InFlight++;
+        }
+
+        bool empty () const {
+            for (const auto &w : Waiting) if (!w.empty ()) return false;
+            return true;
+        }
+
+        // the next waiter of the highest priority, taking flows in turn.
+        ptr<waiter> next () {
+            for (uint32 p = 0; p < Waiting.size (); p++) {
+                auto &flows = Waiting[p];
+                if (flows.empty ()) continue;
+
+                auto f = flows.upper_bound (LastFlow[p]);
+                if (f == flows.end ()) f = flows.begin ();
+
+                ptr<waiter> w = f->second.front ();
+                f->second.pop_front ();
+                LastFlow[p] = f->first;
+                if (f->second.empty ()) flows.erase (f);
+                return w;
+            }
+
+            return nullptr;
+        }
+    };
+
+    scheduler::scheduler (data::exec io, std::map<provider, limit> limits): IO {io}, Queues {} {
+        for (const auto &[p, l] : limits) Queues[p] = std::make_shared<queue> (io, l);
+    }
+
+    scheduler::queue &scheduler::get (provider p) {
+        auto q = Queues.find (p);
+        // providers without a limit get an unlimited queue.
+        if (q == Queues.end ()) q = Queues.emplace (p, std::make_shared<queue> (IO, limit {0, 0, 0})).first;
+        return *q->second;
+    }
+
+    uint32 scheduler::waiting (provider p) const {
+        auto q = Queues.find (p);
+        if (q == Queues.end ()) return 0;
+        uint32 count = 0;
+        for (const auto &flows : q->second->Waiting)
+            for (const auto &[_, w] : flows) count += w.size ();
+        return count;
+    }
+
+    awaitable<scheduler::ticket> scheduler::admit (provider p, priority pr, uint64 flow) {
+        queue &q = get (p);
+        q.refill ();
+
+        if (q.empty () && q.can_go ()) {
+            q.take ();
+            co_return ticket {this, p};
+        }
+
+        auto w = std::make_shared<waiter> (IO);
+        auto &line = q.Waiting[static_cast<uint32> (pr)];
+        line[flow].push_back (w);
+
+        // if we are cancelled while we wait, we leave the queue, or give back
+        // our slot if we were let through just before.
+        struct leave {
+            scheduler &Scheduler;
+            provider Provider;
+            std::map<uint64, std::deque<ptr<waiter>>> &Line;
+            uint64 Flow;
+            ptr<waiter> Waiter;
+            bool Admitted {false};
+
+            ~leave () {
+                if (Admitted) return;
+                if (Waiter->Done) {
+                    Scheduler.release (Provider);
+                    return;
+                }
+
+                auto f = Line.find (Flow);
+                if (f == Line.end ()) return;
+                auto i = std::find (f->second.begin (), f->second.end (), Waiter);
+                if (i != f->second.end ()) f->second.erase (i);
+                if (f->second.empty ()) Line.erase (f);
+            }
+        } waiting {*this, p, line, flow, w};
+
+        dispatch (q);
+
+        if (!w->Done) {
+            boost::system::error_code ec;
+            co_await w->Granted.async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+
+        // the wait was cancelled by someone other than dispatch.
+        if (!w->Done) throw data::exception {} << "cancelled while waiting for " << p;
+
+        waiting.Admitted = true;
+        co_return ticket {this, p};
+    }
+
+    scheduler::ticket scheduler::take (provider p) {
+        queue &q = get (p);
+        q.refill ();
+        q.take ();
+        return ticket {this, p};
+    }
+
+    void scheduler::dispatch (queue &q) {
+        q.refill ();
+
+        while (!q.empty () && q.can_go ()) {
+            ptr<waiter> w = q.next ();
+            q.take ();
+            w->Done = true;
+            w->Granted.cancel ();
+        }
+
+        // if we are waiting for tokens, come back when there will be one.
+        // If we are waiting for requests to finish, release will call us.
+        if (q.empty () || q.has_tokens () || q.RefillScheduled) return;
+
+        q.RefillScheduled = true;
+        q.Refill.expires_after (std::chrono::duration_cast<std::chrono::steady_clock::duration>
+            (std::chrono::duration<double> ((1 - q.Tokens) / q.Limit.Rate)));
+        q.Refill.async_wait ([this, &q] (boost::system::error_code) {
+            q.RefillScheduled = false;
+            dispatch (q);
+        });
+    }
+
+    void scheduler::release (provider p) {
+        queue &q = get (p);
+        q.InFlight--;
+        dispatch (q);
+    }
+
+    scheduler::ticket::ticket (ticket &&t): Scheduler {t.Scheduler}, Provider {t.Provider} {
+        t.Scheduler = nullptr;
+    }
+
+    scheduler::ticket &scheduler::ticket::operator = (ticket &&t) {
+        if (Scheduler != nullptr) Scheduler->release (Provider);
+        Scheduler = t.Scheduler;
+        Provider = t.Provider;
+        t.Scheduler = nullptr;
+        return *this;
+    }
+
+    scheduler::ticket::~ticket () {
+        if (Scheduler != nullptr) Scheduler->release (Provider);
+    }
+
+}
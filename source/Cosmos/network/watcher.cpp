@@ -0,0 +1,117 @@
+#include <Cosmos/network/watcher.hpp>
+#include <Cosmos/database/proof.hpp>
+
+namespace Cosmos {
+
+    std::chrono::milliseconds confirmation_watcher::delay (std::chrono::steady_clock::duration age) const {
+        // a tx that has waited for an hour is checked every six minutes.
+        auto d = std::chrono::duration_cast<std::chrono::milliseconds> (age) / 10;
+        return d < MinDelay ? MinDelay : d > MaxDelay ? MaxDelay : d;
+    }
+
+    void confirmation_watcher::stop () {
+        Stopped = true;
+        if (Wake != nullptr) Wake->cancel ();
+    }
+
+    awaitable<void> confirmation_watcher::run () {
+        Wake = std::make_shared<net::asio::steady_timer> (co_await net::asio::this_coro::executor);
+
+        while (!Stopped) {
+            try {
+                uint32 confirmed = co_await check ();
+                if (confirmed > 0) DATA_LOG (normal) << confirmed << " txs have been confirmed";
+            } catch (const std::exception &x) {
+                DATA_LOG (warning) << "could not check for confirmations: " << x.what ();
+            }
+
+            Wake->expires_after (Interval);
+            boost::system::error_code ec;
+            co_await Wake->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    }
+
+    namespace {
+        // get the proofs for all txids concurrently.
+        awaitable<std::map<Bitcoin::TxID, merkle_proof>> get_proofs (cached_remote_TXDB &db, list<Bitcoin::TxID> txids) {
+            auto ex = co_await net::asio::this_coro::executor;
+
+            auto proofs = std::make_shared<std::map<Bitcoin::TxID, merkle_proof>> ();
+            auto remaining = std::make_shared<uint32> (txids.size ());
+            auto done = std::make_shared<net::asio::steady_timer> (ex, net::asio::steady_timer::time_point::max ());
+
+            for (const Bitcoin::TxID &txid : txids)
+                net::asio::co_spawn (ex, [&db, txid, proofs, remaining, done] () -> awaitable<void> {
+                    try {
+                        maybe<merkle_proof> proof = co_await db.get_merkle_proof (txid);
+                        if (bool (proof)) proofs->emplace (txid, *proof);
+                    } catch (const std::exception &x) {
+                        DATA_LOG (warning) << "could not get merkle proof for " << txid << ": " << x.what ();
+                    }
+
+                    if (--*remaining == 0) done->cancel ();
+                }, net::asio::detached);
+
+            if (*remaining > 0) {
+                boost::system::error_code ec;
+                co_await done->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+            }
+
+            co_return *proofs;
+        }
+    }
+
+    awaitable<uint32> confirmation_watcher::check () {
+        auto now = std::chrono::steady_clock::now ();
+
+        // start tracking new txs and forget those that are no longer unconfirmed.
+        set<Bitcoin::TxID> unconfirmed = TXDB.Local.unconfirmed ();
+        std::map<Bitcoin::TxID, pending> tracked;
+        for (const Bitcoin::TxID &txid : unconfirmed) {
+            auto p = Pending.find (txid);
+            tracked[txid] = p != Pending.end () ? p->second : pending {now, now};
+        }
+
+        Pending = tracked;
+
+        list<Bitcoin::TxID> due;
+        for (auto &[txid, p] : Pending) if (p.NextCheck <= now) {
+            due <<= txid;
+            p.NextCheck = now + delay (now - p.FirstSeen);
+        }
+
+        if (data::empty (due)) co_return 0;
+
+        // find out which have been mined in a few bulk requests
+        // so that we only ask for proofs that exist.
+        map<Bitcoin::TxID, uint64> mined = co_await TXDB.Net.mined (due, TXDB.Priority, TXDB.flow ());
+        if (data::empty (mined)) co_return 0;
+
+        list<Bitcoin::TxID> mined_txids;
+        for (const auto &[txid, height] : mined) mined_txids <<= txid;
+
+        auto proofs = co_await get_proofs (TXDB, mined_txids);
+
+        // the proofs have been checked against headers that we now have.
+        std::vector<Merkle::proof> checked;
+        checked.reserve (proofs.size ());
+        for (const auto &[txid, proof] : proofs) checked.push_back (proof.Proof);
+
+        // each block is updated once.
+        TXDB.Local.insert_proofs (checked);
+
+        uint32 confirmed = 0;
+        for (const auto &[txid, proof] : proofs)
+            if (TXDB.Local.transaction (txid).confirmed ()) {
+                Pending.erase (txid);
+                confirmed++;
+
+                // proofs that we have built with this tx unconfirmed can be made shorter now.
+                TXDB.proofs ().forget (txid);
+                TXDB.Local.proofs ().forget (txid);
+            }
+
+        co_return confirmed;
+    }
+
+}
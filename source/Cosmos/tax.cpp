@@ -6,6 +6,44 @@ namespace Cosmos {
     // TODO not exactly accurate.
     const double one_year = 365 * 24 * 60 * 60;
 
+    awaitable<uint32> tax::prefetch_prices (TXDB &txs, price_service &prices, const history::episode &events) {
+        if (events.History.size () == 0) co_return 0;
+
+        // we need prices for every tx in the period and for
+        // the time when every output we started with was created.
+        maybe<Bitcoin::timestamp> from;
+        maybe<Bitcoin::timestamp> to;
+
+        auto include = [&from, &to] (const when &w) {
+            if (!w.is<Bitcoin::timestamp> () || w == when::unconfirmed ()) return;
+            const auto &t = w.get<Bitcoin::timestamp> ();
+            if (!bool (from) || t < *from) from = t;
+            if (!bool (to) || t > *to) to = t;
+        };
+
+        for (const history::tx &e : events.History) include (e.When);
+
+        for (const auto &[op, _] : events.Account)
+            if (auto v = txs[op.Digest]; bool (v)) include (v->when ());
+
+        if (!bool (from)) co_return 0;
+
+        co_return co_await prices.prefetch (USD, *from, *to);
+    }
+
+    awaitable<tax> tax::calculate (TXDB &txs, price_service &prices, const history::episode &events) {
+        co_await prefetch_prices (txs, prices, events);
+        co_return calculate (txs, &prices.Local, events);
+    }
+
+    namespace {
+        double get_price (price_data *pd, const Bitcoin::timestamp &t) {
+            maybe<double> p = pd->get_price (USD, t);
+            if (!bool (p)) throw data::exception {} << "no price is available for " << t;
+            return *p;
+        }
+    }
+
     tax tax::calculate (TXDB &txs, price_data *pd, const history::episode &events) {
 
         if (events.History.size () == 0) return {{}, {}, events.Account};
@@ -25,7 +63,7 @@ namespace Cosmos {
             // we are assuming that we have a regular timestamp here
             // instead of unconfirmed or infinity. You'd think this would
             // be ok since people typically do taxes on past events.
-            potential.Price = *pd->get_price (USD, e.When.get<Bitcoin::timestamp> ());
+            potential.Price = get_price (pd, e.When.get<Bitcoin::timestamp> ());
 
             Bitcoin::satoshi current_moved {0};
             Bitcoin::satoshi current_income {0};
@@ -41,7 +79,7 @@ namespace Cosmos {
                         // when was the original output created?
                         Bitcoin::timestamp when = txs[op.Digest]->when ().get<Bitcoin::timestamp> ();
                         // At what price was it bought?
-                        double buy_price = *pd->get_price (USD, when);
+                        double buy_price = get_price (pd, when);
                         // if the buy price is greater than the sell price, it's a capital loss.
                         if (potential.Price < buy_price) {
                             cg.Loss += (buy_price - potential.Price) * double (value);
@@ -16,6 +16,123 @@ namespace Cosmos {
         return a;
     }
 
+    bool account::builder::contains (const Bitcoin::outpoint &op) const {
+        return Inserted.contains (op) || (!Removed.contains (op) && bool (Base.contains (op)));
+    }
+
+    account::builder &account::builder::insert (const Bitcoin::outpoint &op, const redeemable &r) {
+        Inserted[op] = r;
+        return *this;
+    }
+
+    account::builder &account::builder::operator <<= (const account_diff &d) {
+        for (const auto &[_, o] : d.Remove) if (!contains (o)) throw cannot_apply_diff {};
+
+        for (const auto &[_, o] : d.Remove) {
+            Inserted.erase (o);
+            // an output of the base may have been replaced by one in Inserted.
+            if (bool (Base.contains (o))) Removed.insert (o);
+        }
+
+        for (const auto &e: d.Insert) Inserted[Bitcoin::outpoint {d.TxID, e.Key}] = e.Value;
+        return *this;
+    }
+
+    account account::builder::freeze () const {
+        // a few changes to a big account are quicker to make one at a time.
+        if ((Inserted.size () + Removed.size ()) * OutputsPerChange < Base.size ()) {
+            account a = Base;
+            for (const auto &o : Removed) a = a.remove (o);
+            for (const auto &[o, r] : Inserted) a = a.insert (o, r);
+            return a;
+        }
+
+        // otherwise we go through the base and the changes together in order
+        // and make the new account and its totals all at once.
+        map<Bitcoin::outpoint, redeemable> m {};
+        totals t {};
+        auto add = [&m, &t] (const Bitcoin::outpoint &op, const redeemable &r) {
+            m = m.insert (op, r);
+            t.Value += r.Prevout.Value;
+            t.Count++;
+            t.InputsExpectedSize += r.expected_input_size ();
+            t.Biggest = t.Biggest.insert (totals::by_value {r.Prevout.Value, op});
+        };
+
+        auto i = Inserted.begin ();
+        for (const auto &[op, r] : Base) {
+            for (; i != Inserted.end () && i->first < op; i++) add (i->first, i->second);
+            if (i != Inserted.end () && i->first == op) add (i->first, (i++)->second);
+            else if (!Removed.contains (op)) add (op, r);
+        }
+
+        for (; i != Inserted.end (); i++) add (i->first, i->second);
+
+        account a {m};
+        a.Totals = std::make_shared<known_totals> (std::move (t));
+        return a;
+    }
+
+    const account::totals &account::aggregates () const {
+        if (!Totals->Known) std::call_once (Totals->Once, [this] () {
+            totals &t = Totals->Totals;
+            for (const auto &[key, value] : *this) {
+                t.Value += value.Prevout.Value;
+                t.Count++;
+                t.InputsExpectedSize += value.expected_input_size ();
+                t.Biggest = t.Biggest.insert (totals::by_value {value.Prevout.Value, key});
+            }
+        });
+
+        return Totals->Totals;
+    }
+
+    account account::insert (const Bitcoin::outpoint &op, const redeemable &r) const {
+        if (contains (op)) return remove (op).insert (op, r);
+
+        totals t = aggregates ();
+        t.Value += r.Prevout.Value;
+        t.Count++;
+        t.InputsExpectedSize += r.expected_input_size ();
+        t.Biggest = t.Biggest.insert (totals::by_value {r.Prevout.Value, op});
+
+        account a {base::insert (op, r)};
+        a.Totals = std::make_shared<known_totals> (std::move (t));
+        return a;
+    }
+
+    account account::remove (const Bitcoin::outpoint &op) const {
+        const redeemable *r = contains (op);
+        if (r == nullptr) return *this;
+
+        totals t = aggregates ();
+        t.Value -= r->Prevout.Value;
+        t.Count--;
+        t.InputsExpectedSize -= r->expected_input_size ();
+        t.Stale++;
+
+        account a {base::remove (op)};
+
+        // take removed outputs off the top so that the first is always the biggest we have.
+        while (!t.Biggest.empty ()) {
+            const totals::by_value &top = t.Biggest.first ();
+            const redeemable *x = a.contains (top.Key);
+            if (bool (x) && x->Prevout.Value == top.Value) break;
+            t.Biggest = t.Biggest.rest ();
+            if (t.Stale > 0) t.Stale--;
+        }
+
+        // if most of the queue is removed outputs, start over.
+        if (t.Stale > t.Count) {
+            t.Biggest = {};
+            t.Stale = 0;
+            for (const auto &[key, value] : a) t.Biggest = t.Biggest.insert (totals::by_value {value.Prevout.Value, key});
+        }
+
+        a.Totals = std::make_shared<known_totals> (std::move (t));
+        return a;
+    }
+
     redeemable::operator JSON () const {
         JSON::array_t deriv;
 
@@ -88,13 +205,16 @@ namespace Cosmos {
     }
 
     account::account_details account::details () const {
+        const totals &t = aggregates ();
+
         account_details d;
-        for (const auto &[key, value] : *this) {
-            d.Value += value.Prevout.Value;
-            if (value.Prevout.Value > d.Max.value ())
-                d.Max = {key, value.Prevout};
-            d.MeanValue = double (d.Value) / double (this->size ());
-        };
+        d.Value = t.Value;
+        if (!t.Biggest.empty ()) {
+            const totals::by_value &top = t.Biggest.first ();
+            d.Max = Bitcoin::prevout {top.Key, contains (top.Key)->Prevout};
+        }
+
+        if (t.Count > 0) d.MeanValue = double (t.Value) / double (t.Count);
         return d;
     }
 
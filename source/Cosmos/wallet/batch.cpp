@@ -0,0 +1,145 @@
+#include <Cosmos/wallet/batch.hpp>
+#include <Cosmos/wallet/split.hpp>
+#include <data/shuffle.hpp>
+#include <cmath>
+
+namespace Cosmos {
+
+    account_diff spend_batch::planned::complete (uint32 index, const Bitcoin::TxID &txid) {
+        if (index >= data::size (Transactions)) throw data::exception {} << "no tx " << index << " in batch";
+
+        list<spend::tx> txs;
+        account_diff diff;
+        uint32 i = 0;
+        for (const spend::tx &t : Transactions) {
+            if (i == index) diff = account_diff {txid, t.Insert, t.Remove};
+
+            // the first input of the next tx spends the output carried over from this one.
+            txs <<= i != index + 1 ? t : t.first_spends (Bitcoin::outpoint {txid, Carried[index]});
+
+            i++;
+        }
+
+        Transactions = txs;
+        return diff;
+    }
+
+    spend_batch::planned spend_batch::operator () (
+        redeem red, account acc,
+        key_source addresses,
+        list<Bitcoin::output> to,
+        satoshis_per_byte fees) const {
+
+        if (data::empty (to)) throw data::exception {} << "no payees in batch";
+
+        // we select inputs for the whole batch at once, enough for all the
+        // payees and their outputs and some extra, as spend does.
+        tx_size all {};
+        for (const Bitcoin::output &o : to) all.add_output (o);
+
+        if (acc.value () < all.Sent)
+            throw data::exception {3} << "insufficient funds: " << acc.value () << " < " << all.Sent;
+
+        Bitcoin::satoshi value_to_redeem {int64 (std::ceil (double (all.Sent + all.required_fee (fees)) *
+            std::uniform_real_distribution<double> {Spend.MinRedeemProportion, Spend.MaxRedeemProportion} (Spend.Random)))};
+
+        std::vector<entry<Bitcoin::outpoint, redeemable>> selected;
+        for (const auto &[op, re] : Spend.Select (acc, value_to_redeem, fees, Spend.Random))
+            selected.push_back (entry<Bitcoin::outpoint, redeemable> {op, re});
+
+        list<spend::tx> txs;
+        list<Bitcoin::index> carried;
+        Bitcoin::satoshi total_fee {0};
+        uint32 next_input = 0;
+
+        // the output of the last tx that the next one spends.
+        maybe<redeemable> carry {};
+
+        while (!data::empty (to)) {
+            tx_size design {};
+            list<nosig::input> inputs;
+            map<Bitcoin::index, Bitcoin::outpoint> removed;
+            Bitcoin::index input_index = 0;
+
+            // the outpoint is filled in by complete once the last tx is signed.
+            if (bool (carry)) {
+                inputs <<= nosig::input {Bitcoin::prevout {Bitcoin::outpoint {}, carry->Prevout},
+                    red (carry->Prevout, {}, carry->UnlockScriptSoFar)};
+                removed = removed.insert (input_index++, Bitcoin::outpoint {});
+                design.add_input (carry->Prevout.Value, carry->expected_input_size ());
+            }
+
+            // add payees and as many inputs as they need while the tx fits, leaving
+            // enough to make at least one more output with what is left.
+            list<Bitcoin::output> group;
+            while (!data::empty (to)) {
+                tx_size next = design;
+                next.add_output (data::first (to));
+
+                uint32 taken = next_input;
+                while (next.excess (fees) <= next.output_fee (tx_size::PayToAddressOutputSize, fees) && taken < selected.size ()) {
+                    next.add_input (selected[taken].Value.Prevout.Value, selected[taken].Value.expected_input_size ());
+                    taken++;
+                }
+
+                if (next.size () + ChangeReserveSize > MaxTxSize) {
+                    if (data::empty (group)) throw data::exception {} <<
+                        "cannot pay " << data::first (to) << " in a tx of no more than " << MaxTxSize << " bytes";
+                    break;
+                }
+
+                if (next.excess (fees) <= next.output_fee (tx_size::PayToAddressOutputSize, fees))
+                    throw data::exception {3} << "insufficient funds for batch";
+
+                for (; next_input < taken; next_input++) {
+                    const auto &[op, re] = selected[next_input];
+                    inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, red (re.Prevout, {}, re.UnlockScriptSoFar)};
+                    removed = removed.insert (input_index++, op);
+                }
+
+                design = next;
+                group <<= data::first (to);
+                to = data::rest (to);
+            }
+
+            // the last tx makes change and the others carry what is left to the next.
+            list<redeemable> made;
+            if (data::empty (to)) {
+                change ch = Spend.Change (design, fees, addresses, Spend.Random);
+                design = ch.Size;
+                for (const redeemable &r : ch.Change) made <<= r;
+                addresses = key_source {ch.Last, addresses.Sequence};
+            } else {
+                carry = pay_to_next_address (int64 (design.excess (fees) -
+                    design.output_fee (tx_size::PayToAddressOutputSize, fees)), addresses);
+                ++addresses;
+                design.add_output (carry->Prevout);
+                made <<= *carry;
+            }
+
+            if (design.excess (fees) < 0) throw data::exception {3} << "failed to generate tx with sufficient fees";
+
+            // we check the fees as we go so that we stop as soon as we are over.
+            total_fee += design.fee ();
+            if (bool (MaxFee) && total_fee > *MaxFee)
+                throw data::exception {} << "batch would cost more than " << *MaxFee << " in fees";
+
+            list<Bitcoin::output> made_outputs;
+            for (const redeemable &r : made) made_outputs <<= r.Prevout;
+
+            // randomly order the new outputs.
+            data::cross<size_t> ordering = random_ordering (made_outputs.size () + group.size (), Spend.Random);
+
+            map<Bitcoin::index, redeemable> inserted;
+            uint32 i = 0;
+            for (const redeemable &r : made) inserted = inserted.insert (ordering[i++], r);
+
+            if (!data::empty (to)) carried <<= Bitcoin::index (ordering[0]);
+
+            txs <<= spend::tx {nosig::transaction {1, inputs, shuffle (made_outputs + group, ordering), 0}, inserted, removed};
+        }
+
+        return planned {txs, carried, addresses};
+    }
+
+}
@@ -7,35 +7,35 @@ namespace Cosmos {
 
     // construct a set of change outputs.
     change make_change_parameters::operator ()
-        (Bitcoin::satoshi val, satoshis_per_byte fees, key_source x, data::random::source &r) const {
+        (const tx_size &design, satoshis_per_byte fees, key_source x, data::random::source &r) const {
 
         list<redeemable> cx {};
 
-        if (val >= MinimumCreateValue) {
+        // every output that we add pays for itself, so what is left is always exact.
+        tx_size size = design;
+        auto left = [&size, fees] () -> Bitcoin::satoshi {
+            return size.excess (fees) - size.output_fee (tx_size::PayToAddressOutputSize, fees);
+        };
 
-            double v = double (val);
+        for (Bitcoin::satoshi v = left (); v > MinimumCreateValue; v = left ()) {
+            double d = double (v);
+            Bitcoin::satoshi next_value = ExpectedSplitFraction * d * 2 > MaximumSplitValue ?
+                std::ceil (std::uniform_real_distribution<double> (MinimumCreateValue, MaximumSplitValue) (r)):
+                std::ceil (std::uniform_real_distribution<double> (MinimumCreateValue, ExpectedSplitFraction * d * 2) (r));
 
-            while (v > MinimumCreateValue) {
-                Bitcoin::satoshi next_value;
-                if (v <= MinimumSplitValue) next_value = floor (v);
-                next_value = ExpectedSplitFraction * v * 2 > MaximumSplitValue ?
-                    std::ceil (std::uniform_real_distribution<double> (MinimumCreateValue, MaximumSplitValue) (r)):
-                    std::ceil (std::uniform_real_distribution<double> (MinimumCreateValue, ExpectedSplitFraction * v * 2) (r));
+            // if what would be left is too small for another output, we put it all in this one.
+            if (v <= MinimumSplitValue || next_value > v ||
+                v - next_value - size.output_fee (tx_size::PayToAddressOutputSize, fees) <= MinimumCreateValue) next_value = v;
 
-                uint64 expected_size = pay_to_address::redeem_expected_size (true);
+            entry<Bitcoin::address, signing> derived = make_pay_to_address (*x);
+            ++x;
 
-                entry<Bitcoin::address, signing> derived = make_pay_to_address (*x);
-                ++x;
-
-                cx <<= redeemable {
-                    Bitcoin::output {next_value, pay_to_address::script (derived.Key.digest ())},
-                        derived.Value};
-
-                v -= double (expected_size) * double (fees) + double (next_value);
-            }
+            redeemable next {Bitcoin::output {next_value, pay_to_address::script (derived.Key.digest ())}, derived.Value};
+            size.add_output (next.Prevout);
+            cx <<= next;
         }
 
-        return change {data::cross<redeemable> (cx), x.Index};
+        return change {data::cross<redeemable> (cx), x.Index, size};
 
     }
 }
@@ -0,0 +1,127 @@
+#include <Cosmos/wallet/ready.hpp>
+#include <data/shuffle.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace Cosmos {
+
+    account ready_pool::pooled (const account &acc, const confirmed &is_confirmed) const {
+        account::builder pool {account {}};
+        for (const auto &[op, re] : acc)
+            if (re.Prevout.Value >= Denominations.MinSatsPerOutput &&
+                re.Prevout.Value <= Denominations.MaxSatsPerOutput && is_confirmed (op)) pool.insert (op, re);
+        return pool.freeze ();
+    }
+
+    uint32 ready_pool::deficit (const account &acc, const confirmed &is_confirmed) const {
+        uint64 stocked = pooled (acc, is_confirmed).count ();
+        if (stocked >= MinStock || stocked >= Stock) return 0;
+        return Stock - stocked;
+    }
+
+    spend::spent ready_pool::pay (const spend &fallback, redeem red, account acc, const confirmed &is_confirmed,
+        key_source addresses, list<Bitcoin::output> to, satoshis_per_byte fees) const {
+
+        tx_size design {};
+        for (const Bitcoin::output &o : to) design.add_output (o);
+
+        // leave room for the number of inputs to grow.
+        uint64 overhead_size = design.size () + 2;
+
+        maybe<selected> found = select_changeless {MaxWaste, select_down {}, overhead_size, MaxTries}.search
+            (pooled (acc, is_confirmed), design.Sent, fees, fallback.Random);
+
+        if (!bool (found)) return fallback (red, acc, addresses, to, fees);
+
+        list<nosig::input> inputs;
+        map<Bitcoin::index, Bitcoin::outpoint> removed;
+        Bitcoin::index input_index = 0;
+        for (const auto &[op, re] : *found) {
+            inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, red (re.Prevout, {}, re.UnlockScriptSoFar)};
+            removed = removed.insert (input_index++, op);
+            design.add_input (re.Prevout.Value, re.expected_input_size ());
+        }
+
+        // the search rounds the fee for each input separately, so we check the total.
+        if (design.excess (fees) < 0) return fallback (red, acc, addresses, to, fees);
+
+        // no change, so no keys are used.
+        return spend::spent {{spend::tx {nosig::transaction {1, inputs, to, 0}, {}, removed}}, addresses};
+    }
+
+    spend::spent ready_pool::refill (redeem red, const account &acc, const confirmed &is_confirmed,
+        key_source addresses, satoshis_per_byte fees, data::random::source &r) const {
+
+        uint32 needed = deficit (acc, is_confirmed);
+        if (needed == 0) return {};
+
+        double fee_rate = double (fees);
+        auto fee = [fee_rate] (uint64 size) -> int64 {
+            return int64 (std::ceil (fee_rate * size));
+        };
+
+        // we split the biggest outputs that are too big to go in the pool.
+        std::vector<entry<Bitcoin::outpoint, redeemable>> too_big;
+        for (const auto &e : acc) if (e.Value.Prevout.Value > Denominations.MaxSatsPerOutput) too_big.push_back (e);
+        std::sort (too_big.begin (), too_big.end (), [] (const auto &a, const auto &b) {
+            return a.Value.Prevout.Value > b.Value.Prevout.Value;
+        });
+
+        // version, locktime, the numbers of inputs and outputs with room for them
+        // to grow, and the output with the rest. output_values pays for the others.
+        constexpr uint64 overhead_size = tx_size::VersionSize + tx_size::LockTimeSize +
+            2 * tx_size::count_size (MaxSplitOutputs) + tx_size::PayToAddressOutputSize;
+
+        int64 split_value = int64 (std::ceil (needed * Denominations.MeanSatsPerOutput));
+
+        list<nosig::input> inputs;
+        map<Bitcoin::index, Bitcoin::outpoint> removed;
+        Bitcoin::index input_index = 0;
+        tx_size design {};
+        for (const auto &[op, re] : too_big) {
+            if (int64 (design.Spent) >= split_value + fee (overhead_size + design.InputsSize)) break;
+            inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, red (re.Prevout, {}, re.UnlockScriptSoFar)};
+            removed = removed.insert (input_index++, op);
+            design.add_input (re.Prevout.Value, re.expected_input_size ());
+        }
+
+        // if there isn't enough, we make as many as we can.
+        split_value = std::min (split_value, int64 (design.Spent) - fee (overhead_size + design.InputsSize));
+        if (split_value < int64 (Denominations.MinSatsPerOutput) + fee (overhead_size)) return {};
+
+        std::vector<int64> values = Denominations.output_values (r, Bitcoin::satoshi {split_value}, fee_rate);
+        for (int64 v : values) design.add_output (Bitcoin::satoshi {v}, tx_size::PayToAddressOutputSize);
+
+        // whatever is left after fees goes in one more output, unless it is too small to be worth it.
+        int64 rest = int64 (design.excess (fees) - design.output_fee (tx_size::PayToAddressOutputSize, fees));
+        if (rest < int64 (Denominations.MinSatsPerOutput)) {
+            rest = int64 (design.excess (fees));
+            if (values.back () + rest < int64 (Denominations.MinSatsPerOutput)) return {};
+            values.back () += rest;
+        } else values.push_back (rest);
+
+        key_source key = addresses;
+        std::vector<redeemable> new_outputs;
+        new_outputs.reserve (values.size ());
+        for (int64 v : values) {
+            new_outputs.push_back (pay_to_next_address (v, key));
+            ++key;
+        }
+
+        // randomly order the new outputs.
+        data::cross<size_t> ordering = random_ordering (new_outputs.size (), r);
+
+        std::vector<Bitcoin::output> ordered (new_outputs.size ());
+        map<Bitcoin::index, redeemable> inserted;
+        for (uint32 i = 0; i < new_outputs.size (); i++) {
+            ordered[ordering[i]] = new_outputs[i].Prevout;
+            inserted = inserted.insert (ordering[i], new_outputs[i]);
+        }
+
+        list<Bitcoin::output> tx_outputs;
+        for (const Bitcoin::output &o : ordered) tx_outputs <<= o;
+
+        return spend::spent {{spend::tx {nosig::transaction {1, inputs, tx_outputs, 0}, inserted, removed}}, key};
+    }
+
+}
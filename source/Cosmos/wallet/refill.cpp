@@ -0,0 +1,73 @@
+#include <Cosmos/wallet/refill.hpp>
+#include <data/crypto/random.hpp>
+
+namespace Cosmos {
+
+    void pool_refiller::stop () {
+        Stopped = true;
+        if (Wake != nullptr) Wake->cancel ();
+    }
+
+    awaitable<void> pool_refiller::run () {
+        Wake = std::make_shared<net::asio::steady_timer> (co_await net::asio::this_coro::executor);
+
+        while (!Stopped) {
+            try {
+                uint32 refilled = co_await refill ();
+                if (refilled > 0) DATA_LOG (normal) << "refilled the ready pools of " << refilled << " wallets";
+            } catch (const std::exception &x) {
+                DATA_LOG (warning) << "could not refill ready pools: " << x.what ();
+            }
+
+            if (Stopped) break;
+
+            Wake->expires_after (Interval);
+            boost::system::error_code ec;
+            co_await Wake->async_wait (net::asio::redirect_error (net::asio::use_awaitable, ec));
+        }
+    }
+
+    awaitable<uint32> pool_refiller::refill () {
+        auto is_confirmed = [this] (const Bitcoin::outpoint &op) -> bool {
+            return TXDB.Local.transaction (op.Digest).confirmed ();
+        };
+
+        uint32 refilled = 0;
+        for (const std::string &name : DB.list_wallet_names ()) {
+            if (Stopped) break;
+
+            // wait for the last refill to be mined.
+            if (auto last = Refilling.find (name); last != Refilling.end ()) {
+                bool mined = true;
+                for (const Bitcoin::TxID &txid : last->second)
+                    if (!TXDB.Local.transaction (txid).confirmed ()) mined = false;
+
+                if (!mined) continue;
+                Refilling.erase (last);
+            }
+
+            maybe<key_source> change = DB.get_wallet_sequence (name, "change");
+            if (!bool (change)) continue;
+
+            spend::spent x = Pool.refill (redeem_p2pkh_and_p2pk, DB.get_wallet_account (name),
+                is_confirmed, *change, Fees, data::crypto::random::get ());
+
+            if (!x.valid ()) continue;
+
+            // the keys are used whether or not the broadcast goes through.
+            DB.set_wallet_sequence (name, Diophant::symbol {"change"}, x.Addresses.Sequence, x.Addresses.Index);
+
+            sent s = co_await send (DB, &TXDB, name, x);
+            if (!bool (s.Result) && s.Result.Error != broadcast_result::QUEUED) {
+                DATA_LOG (warning) << "could not refill the ready pool of wallet " << name << " because " << s.Result;
+                continue;
+            }
+
+            Refilling[name] = s.TxIDs;
+            refilled++;
+        }
+
+        co_return refilled;
+    }
+
+}
@@ -1,21 +1,76 @@
 #include <data/shuffle.hpp>
 #include <Cosmos/wallet/select.hpp>
+#include <Cosmos/wallet/size.hpp>
+#include <Cosmos/math/fenwick_tree.hpp>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <cmath>
 
 namespace Cosmos {
 
     namespace {
 
+        // Outputs are removed at random, with a weight that depends on how far
+        // the output's value is from an optimal value. The optimal value and
+        // whether an output can be removed depend on the expected size of its
+        // input, so we put outputs with the same expected input size together
+        // and sort them by value. Then the outputs that can be removed are a
+        // prefix of each group, and the weight of an output is either v / O or
+        // O / v, so we can keep the sums of v and of 1 / v in Fenwick trees and
+        // select an output in O(log n) rather than going through all of them.
+        using entry = data::entry<const Bitcoin::outpoint, redeemable>;
+
         struct drop_down {
-            // can go faster by using std::map
-            std::map<Bitcoin::outpoint, redeemable> Result;
+            std::vector<entry> Outputs;
+            std::vector<bool> Removed;
+
+            // the outputs that have not been removed, as inputs to a tx.
+            tx_size Selected;
+
+            struct group {
+                uint64 InputSize;
 
-            Bitcoin::satoshi SpentValue;
+                // indices into Outputs, sorted by value.
+                std::vector<uint32> Index;
+                std::vector<double> Values;
+
+                // number of outputs with no value, which come first.
+                uint32 Zeros;
+
+                // over the same positions, zero for outputs that have been removed.
+                math::fenwick_tree<double> Count;
+                math::fenwick_tree<double> Value;
+                math::fenwick_tree<double> Inverse;
+            };
 
-            uint64 InputsExpectedSize;
+            std::vector<group> Groups;
+
+            // group and position of each output.
+            std::vector<std::pair<uint32, uint32>> Where;
+
+            void remove (uint32 i) {
+                const auto &[g, position] = Where[i];
+                group &gr = Groups[g];
+                double value = gr.Values[position];
+
+                gr.Count.add (position, -1);
+                gr.Value.add (position, -value);
+                if (value > 0) gr.Inverse.add (position, -1 / value);
+
+                Removed[i] = true;
+                Selected.remove_input (Outputs[i].Value.Prevout.Value, gr.InputSize);
+            }
 
-            struct removable {
+            // the part of a group that can be removed, split into outputs worth less
+            // than the optimal value and outputs worth more.
+            struct part {
+                uint32 Group;
+                uint32 Begin;
+                uint32 End;
+                bool Low;
+                double Optimal;
                 double Weight;
-                Bitcoin::outpoint Point;
             };
 
             // randomly remove outputs until we have an acceptable subset.
@@ -27,84 +82,267 @@ namespace Cosmos {
                 double min_change_fraction,
                 data::random::source &r) {
 
-                while (true) {
-
-                    // go through all prevouts and figure out which ones can be removed.
-                    list<removable> rmv {};
+                std::vector<part> parts;
+                while (remove_one (value_to_spend, fees, optimal_outputs_per_spend,
+                    min_change_value, min_change_fraction, parts, r));
+            }
 
-                    for (const auto &[key, value] : Result) {
-                        uint64 removed_inputs_expected_size = InputsExpectedSize - value.expected_input_size ();
+            // return false if no output can be removed.
+            bool remove_one (
+                Bitcoin::satoshi value_to_spend,
+                satoshis_per_byte fees,
+                double optimal_outputs_per_spend,
+                double min_change_value,
+                double min_change_fraction,
+                std::vector<part> &parts,
+                data::random::source &r) {
 
-                        double output_value = double (value.Prevout.Value);
+                parts.clear ();
+                double total_weight = 0;
 
-                        double removed_spent_value = double (SpentValue) - output_value;
-                        double removed_val_with_fee = double (value_to_spend) + double (fees) * double (removed_inputs_expected_size);
+                for (uint32 g = 0; g < Groups.size (); g++) {
+                    const group &gr = Groups[g];
 
-                        if (removed_spent_value <= removed_val_with_fee + double (min_change_value) ||
-                            removed_spent_value <= removed_val_with_fee * (min_change_fraction + 1)) continue;
+                    tx_size without = Selected;
+                    without.remove_input (Bitcoin::satoshi {0}, gr.InputSize);
+                    double removed_val_with_fee = double (value_to_spend + without.required_fee (fees));
 
-                        double optimal_value_per_output = removed_val_with_fee / optimal_outputs_per_spend;
+                    // outputs worth less than this can be removed.
+                    double max_removable = double (Selected.Spent) -
+                        std::max (removed_val_with_fee + min_change_value, removed_val_with_fee * (min_change_fraction + 1));
 
-                        double weight = output_value > optimal_value_per_output ?
-                            output_value / optimal_value_per_output :
-                            optimal_value_per_output / output_value;
+                    double optimal_value_per_output = removed_val_with_fee / optimal_outputs_per_spend;
 
-                        rmv <<= {weight, key};
+                    uint32 end = std::lower_bound (gr.Values.begin (), gr.Values.end (), max_removable) - gr.Values.begin ();
+                    uint32 middle = std::min (end, uint32 (
+                        std::upper_bound (gr.Values.begin (), gr.Values.end (), optimal_value_per_output) - gr.Values.begin ()));
 
+                    // the weight of an output with no value is infinite, so these go first.
+                    if (gr.Count.sum (0, std::min (end, gr.Zeros)) > 0) {
+                        uint32 position = 0;
+                        while (Removed[gr.Index[position]]) position++;
+                        remove (gr.Index[position]);
+                        return true;
                     }
 
-                    // if we cannot remove any then we are done.
-                    if (size (rmv) == 0) return;
+                    if (gr.Count.sum (0, middle) > 0) {
+                        double weight = optimal_value_per_output * gr.Inverse.sum (0, middle);
+                        parts.push_back (part {g, 0, middle, true, optimal_value_per_output, weight});
+                        total_weight += weight;
+                    }
 
-                    // randomly select an output to remove based on the weights.
-                    data::cross<double> weights (size (rmv));
-                    auto wi = weights.begin ();
-                    for (const auto &[weight, _] : rmv) {
-                        *wi = weight;
-                        wi++;
+                    if (gr.Count.sum (middle, end) > 0) {
+                        double weight = gr.Value.sum (middle, end) / optimal_value_per_output;
+                        parts.push_back (part {g, middle, end, false, optimal_value_per_output, weight});
+                        total_weight += weight;
                     }
+                }
 
-                    // select a prevout to be removed.
-                    uint32 selected_removable_index = data::random::select_index_by_weight (weights, r);
-                    auto remove_key = rmv[selected_removable_index].Point;
+                // if we cannot remove any then we are done.
+                if (parts.size () == 0) return false;
 
-                    auto removed = Result.find (remove_key);
+                // randomly select an output to remove based on the weights.
+                double x = std::uniform_real_distribution<double> {0, total_weight} (r);
+                auto pt = parts.begin ();
+                while (pt + 1 != parts.end () && x >= pt->Weight) {
+                    x -= pt->Weight;
+                    pt++;
+                }
 
-                    InputsExpectedSize -= removed->second.expected_input_size ();
-                    SpentValue -= removed->second.Prevout.Value;
+                const group &gr = Groups[pt->Group];
+                uint32 position = pt->Low ?
+                    gr.Inverse.find (gr.Inverse.prefix (pt->Begin) + x / pt->Optimal) :
+                    gr.Value.find (gr.Value.prefix (pt->Begin) + x * pt->Optimal);
 
-                    Result.erase (removed);
+                // rounding can leave us just outside the part or on an output that is gone.
+                if (position < pt->Begin) position = pt->Begin;
+                if (position >= pt->End) position = pt->End - 1;
+                while (Removed[gr.Index[position]])
+                    position = position + 1 < pt->End ? position + 1 : pt->Begin;
 
-                }
+                remove (gr.Index[position]);
+                return true;
             }
 
             drop_down (
-                const account &acc,
+                std::vector<entry> outputs,
                 Bitcoin::satoshi value_to_spend,
                 satoshis_per_byte fees,
                 uint32 optimal_outputs_per_spend,
                 Bitcoin::satoshi min_change_value,
                 double min_change_fraction,
-                data::random::source &r): Result {}, SpentValue {acc.value ()}, InputsExpectedSize {0} {
+                data::random::source &r): Outputs {std::move (outputs)}, Removed {}, Selected {} {
+
+                std::map<uint64, uint32> group_of_size;
+                for (uint32 i = 0; i < Outputs.size (); i++) {
+                    const redeemable &value = Outputs[i].Value;
+                    uint64 input_size = value.expected_input_size ();
+                    auto g = group_of_size.find (input_size);
+                    if (g == group_of_size.end ()) {
+                        g = group_of_size.emplace (input_size, Groups.size ()).first;
+                        Groups.push_back (group {input_size, {}, {}, 0, {}, {}, {}});
+                    }
+
+                    Groups[g->second].Index.push_back (i);
+                    Selected.add_input (value.Prevout.Value, input_size);
+                }
 
                 // are enough funds available to make the payment?
-                if (SpentValue <= value_to_spend) throw data::exception {3} << "not enough funds to make payment.";
+                if (Selected.Spent <= value_to_spend) throw data::exception {3} << "not enough funds to make payment.";
+
+                Removed.resize (Outputs.size (), false);
+                Where.resize (Outputs.size ());
+
+                for (uint32 g = 0; g < Groups.size (); g++) {
+                    group &gr = Groups[g];
+                    std::sort (gr.Index.begin (), gr.Index.end (), [this] (uint32 a, uint32 b) {
+                        return Outputs[a].Value.Prevout.Value < Outputs[b].Value.Prevout.Value;
+                    });
+
+                    std::vector<double> inverses;
+                    for (uint32 position = 0; position < gr.Index.size (); position++) {
+                        double value = double (Outputs[gr.Index[position]].Value.Prevout.Value);
+                        gr.Values.push_back (value);
+                        inverses.push_back (value > 0 ? 1 / value : 0);
+                        if (value == 0) gr.Zeros++;
+                        Where[gr.Index[position]] = {g, position};
+                    }
 
-                // generate expected size of the inputs to the tx.
-                for (const auto &[key, value] : acc) {
-                    Result[key] = value;
-                    InputsExpectedSize += value.expected_input_size ();
+                    gr.Count = math::fenwick_tree<double> {std::vector<double> (gr.Index.size (), 1)};
+                    gr.Value = math::fenwick_tree<double> {gr.Values};
+                    gr.Inverse = math::fenwick_tree<double> {inverses};
                 }
 
                 // in these cases, we cannot satisfy MinChangeFraction or MinChangeValue with the funds
                 // available in the wallet, so we continue with everything selected.
-                if (SpentValue > value_to_spend + min_change_value &&
-                    double (SpentValue) > double (value_to_spend) * (min_change_fraction + 1))
+                if (Selected.Spent > value_to_spend + min_change_value &&
+                    double (Selected.Spent) > double (value_to_spend) * (min_change_fraction + 1))
                     reduce (value_to_spend, fees, double (optimal_outputs_per_spend),
                         double (min_change_value), min_change_fraction, r);
             }
+
+            // what is left after reduce, checked against the requirements.
+            selected result (Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
+                Bitcoin::satoshi spend_val_with_fee = value_to_spend + Selected.required_fee (fees);
+                if (spend_val_with_fee > Selected.Spent) throw data::exception {3} <<
+                    "could not satisfy input selection requirements because " << spend_val_with_fee << " > " << Selected.Spent;
+
+                dispatch<Bitcoin::outpoint, redeemable> selected_outputs;
+                for (uint32 i = 0; i < Outputs.size (); i++)
+                    if (!Removed[i]) selected_outputs <<= Outputs[i];
+
+                // shuffle before returning.
+                return shuffle (selected_outputs, r);
+            }
         };
 
+        double random_change_fraction (double min_change_fraction, double max_change_fraction, data::random::source &r) {
+            return min_change_fraction == max_change_fraction ? min_change_fraction :
+                std::uniform_real_distribution<double> {min_change_fraction, max_change_fraction} (r);
+        }
+
+        // an output of the account that has not been selected yet. The account is
+        // persistent, so we can point into it rather than copy every output.
+        struct unselected {
+            const Bitcoin::outpoint *Key;
+            const redeemable *Value;
+
+            entry operator * () const {
+                return entry {*Key, *Value};
+            }
+        };
+
+        std::vector<unselected> unselected_outputs (const account &acc) {
+            std::vector<unselected> x;
+            x.reserve (acc.size ());
+            for (const auto &[op, re] : acc) x.push_back (unselected {&op, &re});
+            return x;
+        }
+
+        // the biggest output first. Outputs of the same value are taken in order of
+        // expected input size, smallest first. Rather than sort the whole account,
+        // we make a heap, which is O(n), and then each output taken is O(log n).
+        struct take_biggest {
+            std::vector<unselected> Heap;
+
+            static bool less (const unselected &a, const unselected &b) {
+                return a.Value->Prevout.Value != b.Value->Prevout.Value ? a.Value->Prevout.Value < b.Value->Prevout.Value :
+                    a.Value->expected_input_size () > b.Value->expected_input_size ();
+            }
+
+            take_biggest (const account &acc): Heap {unselected_outputs (acc)} {
+                std::make_heap (Heap.begin (), Heap.end (), &less);
+            }
+
+            bool empty () const {
+                return Heap.empty ();
+            }
+
+            entry operator () () {
+                std::pop_heap (Heap.begin (), Heap.end (), &less);
+                entry e = *Heap.back ();
+                Heap.pop_back ();
+                return e;
+            }
+        };
+
+        // uniformly from the outputs not yet taken. This is a Fisher-Yates
+        // shuffle that stops as soon as we have enough.
+        struct take_random {
+            std::vector<unselected> Remaining;
+            data::random::source &Random;
+
+            take_random (const account &acc, data::random::source &r): Remaining {unselected_outputs (acc)}, Random {r} {}
+
+            bool empty () const {
+                return Remaining.empty ();
+            }
+
+            entry operator () () {
+                std::swap (Remaining[std::uniform_int_distribution<size_t> {0, Remaining.size () - 1} (Random)], Remaining.back ());
+                entry e = *Remaining.back ();
+                Remaining.pop_back ();
+                return e;
+            }
+        };
+
+        // take outputs one at a time until we have enough to make the payment
+        // and to leave the required change. If there aren't enough for the
+        // change, we take everything as long as we can make the payment.
+        template <typename take> std::vector<entry> select_up (
+            Bitcoin::satoshi value_to_spend,
+            satoshis_per_byte fees,
+            Bitcoin::satoshi min_change_value,
+            double change_fraction,
+            take next) {
+
+            std::vector<entry> outputs;
+
+            // the inputs selected so far, with the fee required for them.
+            tx_size selected_size {};
+
+            auto spend_val_with_fee = [&] () -> double {
+                return double (value_to_spend) + double (selected_size.required_fee (fees));
+            };
+
+            while (!next.empty () && (
+                double (selected_size.Spent) <= spend_val_with_fee () + double (min_change_value) ||
+                double (selected_size.Spent) <= spend_val_with_fee () * (change_fraction + 1))) {
+                outputs.push_back (next ());
+                selected_size.add_input (outputs.back ().Value.Prevout.Value, outputs.back ().Value.expected_input_size ());
+            }
+
+            if (double (selected_size.Spent) < spend_val_with_fee ()) throw data::exception {3} << "not enough funds to make payment.";
+
+            return outputs;
+        }
+
+        selected shuffled (const std::vector<entry> &outputs, data::random::source &r) {
+            dispatch<Bitcoin::outpoint, redeemable> selected_outputs;
+            for (const entry &e : outputs) selected_outputs <<= e;
+            return shuffle (selected_outputs, r);
+        }
+
     }
 
     // select outputs from a wallet sufficient for the given value.
@@ -118,37 +356,120 @@ namespace Cosmos {
         // We do it this way because it's easier to find outputs that we don't want to spend
         // than outputs that we do want to spend.
 
-        drop_down dropped {acc, value_to_spend, fees, OptimalOutputsPerSpend, MinChangeValue,
+        std::vector<entry> outputs;
+        for (const auto &e : acc) outputs.push_back (e);
+
+        drop_down dropped {std::move (outputs), value_to_spend, fees, OptimalOutputsPerSpend, MinChangeValue,
             MinChangeFraction == MaxChangeFraction ? MinChangeFraction :
                 std::uniform_real_distribution<double> {MinChangeFraction} (r), r};
 
         // double check that the selection is good
-        double spend_val_with_fee = double (value_to_spend) + double (fees) * double (dropped.InputsExpectedSize);
-        if (spend_val_with_fee > dropped.SpentValue) throw data::exception {3} <<
-            "could not satisfy input selection requirements because " << spend_val_with_fee << " > " << dropped.SpentValue;
-
-        dispatch<Bitcoin::outpoint, redeemable> selected_outputs;
-        for (const auto &[key, value] : dropped.Result) selected_outputs <<= data::entry<const Bitcoin::outpoint, redeemable> {key, value};
-
-        // shuffle before returning.
-        return shuffle (selected_outputs, r);
+        return dropped.result (value_to_spend, fees, r);
     }
 
     selected select_up_biggest::operator ()
         (const account &acc, Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
 
-        throw data::unimplemented {"select_up_biggest::operator ()"};
+        return shuffled (select_up (value_to_spend, fees, MinChangeValue,
+            random_change_fraction (MinChangeFraction, MaxChangeFraction, r), take_biggest {acc}), r);
     }
 
     selected select_up_random::operator ()
         (const account &acc, Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
 
-        throw data::unimplemented {"select_up_random::operator ()"};
+        return shuffled (select_up (value_to_spend, fees, MinChangeValue,
+            random_change_fraction (MinChangeFraction, MaxChangeFraction, r), take_random {acc, r}), r);
     }
 
     selected select_up_and_down::operator ()
         (const account &acc, Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
 
-        throw data::unimplemented {"select_up_and_down::operator ()"};
+        // select random outputs until we have enough and then remove the ones we don't want.
+        double change_fraction = random_change_fraction (MinChangeFraction, MaxChangeFraction, r);
+        drop_down dropped {select_up (value_to_spend, fees, MinChangeValue, change_fraction,
+            take_random {acc, r}), value_to_spend, fees, OptimalOutputsPerSpend, MinChangeValue, change_fraction, r};
+
+        return dropped.result (value_to_spend, fees, r);
+    }
+
+    selected select_changeless::operator ()
+        (const account &acc, Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
+        maybe<selected> found = search (acc, value_to_spend, fees, r);
+        if (bool (found)) return *found;
+        return Fallback (acc, value_to_spend, fees, r);
+    }
+
+    maybe<selected> select_changeless::search
+        (const account &acc, Bitcoin::satoshi value_to_spend, satoshis_per_byte fees, data::random::source &r) const {
+
+        // what each output is worth after paying for its input.
+        struct candidate {
+            int64 EffectiveValue;
+            unselected Output;
+        };
+
+        std::vector<candidate> candidates;
+        int64 available = 0;
+        for (const auto &[op, re] : acc) {
+            int64 effective_value = int64 (re.Prevout.Value) -
+                int64 (std::ceil (double (fees) * double (re.expected_input_size ())));
+            if (effective_value <= 0) continue;
+            candidates.push_back (candidate {effective_value, unselected {&op, &re}});
+            available += effective_value;
+        }
+
+        // biggest first so that we reach the target quickly and can cut off branches early.
+        std::sort (candidates.begin (), candidates.end (), [] (const candidate &a, const candidate &b) {
+            return a.EffectiveValue > b.EffectiveValue;
+        });
+
+        int64 target = int64 (value_to_spend) + int64 (std::ceil (double (fees) * double (OverheadSize)));
+        int64 max_value = target + int64 (MaxWaste);
+
+        // depth-first search in which each output is included and then excluded.
+        std::vector<uint32> selection;
+        std::vector<uint32> best;
+        int64 best_waste = std::numeric_limits<int64>::max ();
+        int64 value = 0;
+
+        uint32 index = 0;
+        if (available >= target) for (uint32 tries = 0; tries < MaxTries; tries++, index++) {
+            bool backtrack = false;
+            if (value + available < target || value > max_value) backtrack = true;
+            else if (value >= target) {
+                if (value - target < best_waste) {
+                    best = selection;
+                    best_waste = value - target;
+                    if (best_waste == 0) break;
+                }
+
+                backtrack = true;
+            }
+
+            if (backtrack) {
+                if (selection.empty ()) break;
+
+                // put back the outputs after the last one included and try without it.
+                for (index--; index > selection.back (); index--) available += candidates[index].EffectiveValue;
+                value -= candidates[index].EffectiveValue;
+                selection.pop_back ();
+            } else {
+                available -= candidates[index].EffectiveValue;
+
+                // if we just left out an output of the same value, including this one
+                // would repeat a branch that we have already been down.
+                if (selection.empty () || index - 1 == selection.back () ||
+                    candidates[index].EffectiveValue != candidates[index - 1].EffectiveValue) {
+                    selection.push_back (index);
+                    value += candidates[index].EffectiveValue;
+                }
+            }
+        }
+
+        if (best.empty ()) return {};
+
+        std::vector<entry> selected_outputs;
+        for (uint32 i : best) selected_outputs.push_back (*candidates[i].Output);
+        return shuffled (selected_outputs, r);
     }
 }
@@ -0,0 +1,96 @@
+#include <Cosmos/wallet/send.hpp>
+#include <Cosmos/database/proof.hpp>
+#include <Cosmos/network/outbox.hpp>
+
+namespace Cosmos {
+
+    namespace {
+        awaitable<sent> send_signed (controller &db, cached_remote_TXDB *txdb,
+            const std::string &wallet_name, list<Bitcoin::transaction> txs, list<account_diff> diffs) {
+
+            list<Bitcoin::TxID> txids;
+            for (const Bitcoin::transaction &tx : txs) txids <<= tx.id ();
+
+            // check that the diffs apply before we broadcast anything.
+            account before = db.get_wallet_account (wallet_name);
+            account::builder next {before};
+            for (const account_diff &d : diffs) next <<= d;
+
+            JSON note = JSON (outgoing_payment {wallet_name, before, diffs});
+
+            // with no network, the payment goes straight to the outbox.
+            if (txdb == nullptr) {
+                maybe<SPV::proof> proof = proof_builder {db} (txs);
+                if (!bool (proof) || !bool (queue_outgoing (db, *proof, note)))
+                    throw data::exception {} << "could not make a proof for a payment from wallet " << wallet_name;
+
+                DATA_LOG (normal) << "offline; the payment from wallet " << wallet_name << " will be broadcast later";
+                db.update_wallet_account (wallet_name, diffs);
+                co_return sent {txids, broadcast_tree_result {broadcast_result::QUEUED}};
+            }
+
+            maybe<SPV::proof> proof = proof_builder {*txdb} (txs);
+            if (!bool (proof)) throw data::exception {} << "could not make a proof for a payment from wallet " << wallet_name;
+
+            broadcast_tree_result result = co_await txdb->broadcast (*proof, maybe<JSON> {note});
+
+            if (result.Error == broadcast_result::QUEUED) {
+                DATA_LOG (normal) << "could not connect; the payment from wallet " << wallet_name << " will be broadcast later";
+                db.update_wallet_account (wallet_name, diffs);
+                co_return sent {txids, result};
+            }
+
+            // some txs may be accepted even if others are not.
+            list<account_diff> accepted;
+            for (const account_diff &d : diffs) {
+                auto sub = result.Sub.contains (d.TxID);
+                if (bool (sub) && bool (*sub)) accepted <<= d;
+            }
+
+            if (!data::empty (accepted)) db.update_wallet_account (wallet_name, accepted);
+
+            co_return sent {txids, result};
+        }
+
+        // txs that spend outputs of those before them.
+        template <typename planned> awaitable<sent> send_in_order (controller &db, cached_remote_TXDB *txdb,
+            const std::string &wallet_name, planned x) {
+
+            // each tx must be signed before the ones that spend it can be completed.
+            list<Bitcoin::transaction> txs;
+            list<account_diff> diffs;
+            for (uint32 i = 0; i < data::size (x.Transactions); i++) {
+                Bitcoin::transaction tx {Bitcoin::incomplete::transaction (x.Transactions[i].Transaction.sign (db))};
+                txs <<= tx;
+                diffs <<= x.complete (i, tx.id ());
+            }
+
+            co_return co_await send_signed (db, txdb, wallet_name, txs, diffs);
+        }
+    }
+
+    awaitable<sent> send (controller &db, cached_remote_TXDB *txdb,
+        const std::string &wallet_name, const spend::spent &x) {
+
+        list<Bitcoin::transaction> txs;
+        list<account_diff> diffs;
+        for (const spend::tx &t : x.Transactions) {
+            Bitcoin::transaction tx {Bitcoin::incomplete::transaction (t.Transaction.sign (db))};
+            txs <<= tx;
+            diffs <<= account_diff {tx.id (), t.Insert, t.Remove};
+        }
+
+        co_return co_await send_signed (db, txdb, wallet_name, txs, diffs);
+    }
+
+    awaitable<sent> send (controller &db, cached_remote_TXDB *txdb,
+        const std::string &wallet_name, spend_batch::planned x) {
+        co_return co_await send_in_order (db, txdb, wallet_name, x);
+    }
+
+    awaitable<sent> send (controller &db, cached_remote_TXDB *txdb,
+        const std::string &wallet_name, split::groups_result x) {
+        co_return co_await send_in_order (db, txdb, wallet_name, x);
+    }
+
+}
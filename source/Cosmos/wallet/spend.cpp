@@ -1,10 +1,24 @@
 #include <Cosmos/wallet/spend.hpp>
 #include <data/shuffle.hpp>
+#include <io/log.hpp>
 
 namespace Cosmos {
 
     namespace incomplete = Gigamonkey::Bitcoin::incomplete;
 
+    spend::tx spend::tx::first_spends (const Bitcoin::outpoint &op) const {
+        list<nosig::input> inputs;
+        for (nosig::input in : Transaction.Inputs) {
+            if (data::empty (inputs)) in.Reference = op;
+            inputs <<= in;
+        }
+
+        map<Bitcoin::index, Bitcoin::outpoint> remove;
+        for (const auto &[j, x] : Remove) remove = remove.insert (j, j == 0 ? op : x);
+
+        return tx {nosig::transaction {Transaction.Version, inputs, Transaction.Outputs, Transaction.LockTime}, Insert, remove};
+    }
+
     spend::spent spend::operator () (
         redeem red, account acc,
         key_source addresses,
@@ -12,12 +26,14 @@ namespace Cosmos {
         list<Bitcoin::output> to,
         satoshis_per_byte fees) const {
 
+        // the size and fee of the tx are kept up to date as we design it,
+        // so that we never need to go over the whole tx to work them out.
+        tx_size design {};
+        for (const Bitcoin::output &o : to) design.add_output (o);
+
         // TODO if we could we ought to estimate the size of the tx and
         // the fees required to spend it and include that in value_to_spend.
-        Bitcoin::satoshi value_to_spend = data::fold
-            ([] (Bitcoin::satoshi val, const Bitcoin::output &o) -> Bitcoin::satoshi {
-                return val + o.Value;
-            }, Bitcoin::satoshi {0}, to);
+        Bitcoin::satoshi value_to_spend = design.Sent;
 
         Bitcoin::satoshi value_available = acc.value ();
 
@@ -39,6 +55,22 @@ namespace Cosmos {
         Bitcoin::satoshi value_to_redeem =
             std::ceil (value_to_spend * std::uniform_real_distribution<double> {MinRedeemProportion, MaxRedeemProportion} (Random));
 
+        // if we can pay without change, we don't redeem extra.
+        maybe<selected> exact;
+        if (bool (Changeless)) {
+            select_changeless search = *Changeless;
+            // leave room for the number of inputs to grow.
+            search.OverheadSize = design.size () + 2;
+            exact = search.search (acc, value_to_spend, fees, Random);
+
+            // the search rounds the fee for each input separately, so we check the total.
+            if (bool (exact)) {
+                tx_size check = design;
+                for (const auto &[op, re] : *exact) check.add_input (re.Prevout.Value, re.expected_input_size ());
+                if (check.excess (fees) < 0) exact = {};
+            }
+        }
+
         // construct map of inputs removed from the account.
         map<Bitcoin::index, Bitcoin::outpoint> removed;
 
@@ -48,25 +80,23 @@ namespace Cosmos {
         // construct list of inputs and map of removed elements.
         size_t input_index = 0;
         // select outputs to redeem.
-        for (const auto &[op, re]: Select (acc, value_to_redeem, fees, Random)) {
+        for (const auto &[op, re]: bool (exact) ? *exact : Select (acc, value_to_redeem, fees, Random)) {
             inputs <<= nosig::input {
                 Bitcoin::prevout {op, re.Prevout},
                 red (re.Prevout, {}, re.UnlockScriptSoFar)
             };
             removed = removed.insert (input_index++, op);
+            design.add_input (re.Prevout.Value, re.expected_input_size ());
         }
 
-        nosig::transaction design_before_change {1, inputs, to, 0};
-
-        // how much do we need to make in change?
-        satoshis_per_byte fee_rate_before_change {design_before_change.fee (), design_before_change.expected_size ()};
+        // make change out of whatever is left after the fee, which
+        // is worked out exactly as each change output is added.
+        // What is left over from a changeless selection goes to the miner.
+        change ch = bool (exact) ? change {{}, addresses.Index, design} : Change (design, fees, addresses, Random);
 
-        // what change needs to be accounted for in order to make this tx?
-        Bitcoin::satoshi change_amount
-            {static_cast<long int> (floor (double (int64 (fee_rate_before_change.Satoshis)) - double (fees) * fee_rate_before_change.Bytes))};
-
-        // make change outputs.
-        change ch = Change (change_amount, fees, addresses, Random);
+        // Is the fee for this transaction sufficient?
+        if (ch.Size.excess (fees) < 0)
+            throw data::exception {3} << "failed to generate tx with sufficient fees";
 
         auto change_outputs = ch.outputs ();
 
@@ -75,12 +105,14 @@ namespace Cosmos {
 
         nosig::transaction final_design {1, inputs, shuffle (change_outputs + to, outputs_ordering), 0};
 
-        // Is the fee for this transaction sufficient?
-        if (final_design.fee_rate () < fees)
-            throw data::exception {3} << "failed to generate tx with sufficient fees";
+        // check the tx that we actually built rather than the design.
+        tx_size built = final_design.size ();
+        if (built.size () > ch.Size.size () || built.excess (fees) < 0)
+            throw data::exception {3} << "built tx has size " << built.size () << " and fee " << built.fee () <<
+                " but " << ch.Size.size () << " and " << built.required_fee (fees) << " were expected";
 
-        std::cout << " transaction design is complete. It has " << final_design.Inputs.size () << " inputs spending " << final_design.spent () << ", " <<
-            final_design.Outputs.size () << " outputs sending " << final_design.sent () << " with fees " << final_design.fee  () << std::endl;
+        DATA_LOG (normal) << "transaction design is complete. It has " << built.Inputs << " inputs spending " << built.Spent << ", " <<
+            built.Outputs << " outputs sending " << built.Sent << " with fees " << built.fee ();
 
         // the list of new entries to be added to account.
         map<Bitcoin::index, redeemable> inserted;
@@ -1,21 +1,26 @@
 #include <Cosmos/wallet/split.hpp>
+#include <Cosmos/random.hpp>
+#include <data/shuffle.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <thread>
 
 namespace Cosmos {
 
-    constexpr const uint32 output_size = 34;
+    constexpr const uint32 output_size = tx_size::PayToAddressOutputSize;
 
-    split::result_outputs split::construct_outputs (data::random::source &r, const key_source &k,
-        Bitcoin::satoshi split_value, double fee_rate) const {
+    std::vector<int64> split::output_values (data::random::source &r, Bitcoin::satoshi split_value, double fee_rate) const {
 
-        list<redeemable> outputs {};
+        std::vector<int64> values;
 
         int64 remaining_split_value = split_value;
 
-        key_source key = k;
-
         while (true) {
             // how many outputs will we have by the next iteration?
-            uint32 outputs_size_next = outputs.size () + 1;
+            uint32 outputs_size_next = values.size () + 1;
 
             // how many fees will we have accumulated by the next iteration?
             int64 expected_fees_next = ceil (fee_rate * (Bitcoin::var_int::size (outputs_size_next) + (outputs_size_next) * output_size));
@@ -37,22 +42,440 @@ namespace Cosmos {
                 expected_remainder:
                 random_value;
 
-            entry<Bitcoin::address, signing> last_address =
-                make_pay_to_address (*key);
-
-            outputs = outputs << redeemable {
-                Bitcoin::output {
-                    Bitcoin::satoshi {output_value},
-                    pay_to_address::script (last_address.Key.digest ())},
-                last_address.Value};
+            values.push_back (output_value);
 
-            if (we_are_done) return result_outputs {outputs, key.Index};
+            if (we_are_done) return values;
 
             remaining_split_value -= output_value;
+        }
+    }
+
+    redeemable pay_to_next_address (int64 value, const key_source &key) {
+        entry<Bitcoin::address, signing> address = make_pay_to_address (*key);
+        return redeemable {
+            Bitcoin::output {
+                Bitcoin::satoshi {value},
+                pay_to_address::script (address.Key.digest ())},
+            address.Value};
+    }
+
+    split::result_outputs split::construct_outputs (data::random::source &r, const key_source &k,
+        Bitcoin::satoshi split_value, double fee_rate) const {
+
+        list<redeemable> outputs {};
+
+        key_source key = k;
 
-            key = key.next ();
+        for (int64 value : output_values (r, split_value, fee_rate)) {
+            outputs = outputs << pay_to_next_address (value, key);
+            ++key;
         }
+
+        // last key used +1
+        return result_outputs {outputs, key.Index};
     }
+
+    account_diff split::groups_result::complete (uint32 index, const Bitcoin::TxID &txid) {
+        if (index >= data::size (Transactions)) throw data::exception {} << "no tx " << index << " in split";
+
+        list<spend::tx> txs;
+        account_diff diff;
+        uint32 i = 0;
+        for (const spend::tx &t : Transactions) {
+            if (i == index) diff = account_diff {txid, t.Insert, t.Remove};
+
+            const auto &parent = Parents[i];
+            txs <<= !bool (parent) || parent->first != index ? t : t.first_spends (Bitcoin::outpoint {txid, parent->second});
+
+            i++;
+        }
+
+        Transactions = txs;
+        return diff;
+    }
+
+    namespace {
+        using parent_output = maybe<std::pair<uint32, Bitcoin::index>>;
+
+        // the txs of a tree, root first. The root spends the outputs being split and
+        // every other tx spends an output of its parent, whose outpoint is filled
+        // in once the parent is signed. Parents are given by their place in the tree.
+        std::vector<std::pair<spend::tx, parent_output>> plant (redeem red,
+            const list<entry<Bitcoin::outpoint, redeemable>> &split_outputs,
+            const split::tree &t, data::random::source &r) {
+
+            // outputs are put in random order, so we need to know where each one went.
+            std::vector<data::cross<size_t>> orderings;
+            for (const auto &n : t.Transactions) orderings.push_back (random_ordering (n.Outputs.size (), r));
+
+            std::vector<std::pair<spend::tx, parent_output>> txs;
+            for (uint32 i = 0; i < t.Transactions.size (); i++) {
+                const split::tree::node &n = t.Transactions[i];
+
+                list<nosig::input> inputs;
+                map<Bitcoin::index, Bitcoin::outpoint> removed;
+                parent_output parent {};
+                if (bool (n.Parent)) {
+                    auto [p, j] = *n.Parent;
+                    const redeemable &spent = t.Transactions[p].Outputs[j];
+                    inputs <<= nosig::input {Bitcoin::prevout {Bitcoin::outpoint {}, spent.Prevout},
+                        red (spent.Prevout, {}, spent.UnlockScriptSoFar)};
+                    removed = removed.insert (Bitcoin::index {0}, Bitcoin::outpoint {});
+                    parent = std::pair<uint32, Bitcoin::index> {p, Bitcoin::index (orderings[p][j])};
+                } else {
+                    Bitcoin::index input_index = 0;
+                    for (const auto &[op, re] : split_outputs) {
+                        inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, red (re.Prevout, {}, re.UnlockScriptSoFar)};
+                        removed = removed.insert (input_index++, op);
+                    }
+                }
+
+                std::vector<Bitcoin::output> ordered (n.Outputs.size ());
+                map<Bitcoin::index, redeemable> inserted;
+                for (uint32 j = 0; j < n.Outputs.size (); j++) {
+                    ordered[orderings[i][j]] = n.Outputs[j].Prevout;
+                    inserted = inserted.insert (orderings[i][j], n.Outputs[j]);
+                }
+
+                list<Bitcoin::output> tx_outputs;
+                for (const Bitcoin::output &o : ordered) tx_outputs <<= o;
+
+                txs.push_back ({spend::tx {nosig::transaction {1, inputs, tx_outputs, 0}, inserted, removed}, parent});
+            }
+
+            return txs;
+        }
+    }
+
+    split::groups_result split::split_groups (redeem red, const list<group> &groups, const key_source &k,
+        const bytes &seed, satoshis_per_byte fees, const tree_options &o) const {
+
+        std::vector<group> gs;
+        for (const group &g : groups) gs.push_back (g);
+
+        // each group gets its own random stream.
+        std::vector<Cosmos::random::stream> streams;
+        for (const group &g : gs) {
+            bytes group_seed = seed;
+            group_seed.insert (group_seed.end (), g.ScriptHash.begin (), g.ScriptHash.end ());
+            streams.emplace_back (group_seed);
+        }
+
+        std::vector<std::vector<int64>> values (gs.size ());
+        std::vector<std::exception_ptr> errors (gs.size ());
+        std::vector<maybe<spend::tx>> txs (gs.size ());
+
+        // groups that are split with a tree and the value that goes into each tree.
+        std::vector<maybe<Bitcoin::satoshi>> trees (gs.size ());
+
+        uint32 thread_count = o.Threads != 0 ? o.Threads : std::max (1u, std::thread::hardware_concurrency ());
+        auto run = [&] (auto f) {
+            boost::asio::thread_pool pool {thread_count};
+            for (uint32 i = 0; i < gs.size (); i++) boost::asio::post (pool, [&f, &errors, i] () {
+                try {
+                    f (i);
+                } catch (...) {
+                    errors[i] = std::current_exception ();
+                }
+            });
+
+            pool.join ();
+            for (const auto &e : errors) if (e) std::rethrow_exception (e);
+        };
+
+        // first we choose the values of the outputs, so that we know how many keys each group needs.
+        run ([&] (uint32 i) {
+            Bitcoin::satoshi total {0};
+            uint64 inputs_size = 0;
+            for (const auto &e : gs[i].Outputs) {
+                total += e.Value.Prevout.Value;
+                inputs_size += e.Value.expected_input_size ();
+            }
+
+            uint64 tx_size_other_than_outputs = 4 + 4 + Bitcoin::var_int::size (gs[i].Outputs.size ()) + inputs_size;
+            Bitcoin::satoshi split_value = total - Bitcoin::satoshi {int64 (std::ceil (double (fees) * tx_size_other_than_outputs))};
+            values[i] = output_values (streams[i], split_value, double (fees));
+
+            uint64 size = tx_size_other_than_outputs + Bitcoin::var_int::size (values[i].size ()) + values[i].size () * output_size;
+            if (size > o.MaxTxSize || values[i].size () > o.MaxOutputsPerTx || (bool (o.MaxSatsPerTx) && total > *o.MaxSatsPerTx)) {
+                trees[i] = split_value;
+                values[i].clear ();
+            }
+        });
+
+        std::vector<uint32> first_key (gs.size ());
+        uint32 next_key = k.Index;
+        for (uint32 i = 0; i < gs.size (); i++) {
+            first_key[i] = next_key;
+            next_key += values[i].size ();
+        }
+
+        // then we derive keys and make the txs.
+        run ([&] (uint32 i) {
+            if (bool (trees[i])) return;
+
+            std::vector<redeemable> outputs;
+            outputs.reserve (values[i].size ());
+            for (uint32 j = 0; j < values[i].size (); j++)
+                outputs.push_back (pay_to_next_address (values[i][j], key_source {first_key[i] + j, k.Sequence}));
+
+            // randomly order the new outputs.
+            data::cross<size_t> ordering = random_ordering (outputs.size (), streams[i]);
+
+            list<nosig::input> inputs;
+            map<Bitcoin::index, Bitcoin::outpoint> removed;
+            Bitcoin::index input_index = 0;
+            for (const auto &[op, re] : gs[i].Outputs) {
+                inputs <<= nosig::input {Bitcoin::prevout {op, re.Prevout}, red (re.Prevout, {}, re.UnlockScriptSoFar)};
+                removed = removed.insert (input_index++, op);
+            }
+
+            std::vector<Bitcoin::output> ordered (outputs.size ());
+            map<Bitcoin::index, redeemable> inserted;
+            for (uint32 j = 0; j < outputs.size (); j++) {
+                ordered[ordering[j]] = outputs[j].Prevout;
+                inserted = inserted.insert (ordering[j], outputs[j]);
+            }
+
+            list<Bitcoin::output> tx_outputs;
+            for (const Bitcoin::output &o : ordered) tx_outputs <<= o;
+
+            txs[i] = spend::tx {nosig::transaction {1, inputs, tx_outputs, 0}, inserted, removed};
+        });
+
+        // trees derive their own keys on the pool, so we make them one at a time.
+        std::vector<std::vector<std::pair<spend::tx, parent_output>>> planted (gs.size ());
+        for (uint32 i = 0; i < gs.size (); i++) if (bool (trees[i])) {
+            tree t = construct_tree (streams[i], key_source {next_key, k.Sequence}, *trees[i], double (fees), o);
+            next_key = t.Last;
+            planted[i] = plant (red, gs[i].Outputs, t, streams[i]);
+        }
+
+        groups_result result {{}, {}, next_key};
+        for (uint32 i = 0; i < gs.size (); i++) {
+            if (!bool (trees[i])) {
+                result.Transactions <<= *txs[i];
+                result.Parents.push_back (parent_output {});
+                continue;
+            }
+
+            // parents within the tree are moved to where the tree starts.
+            uint32 root = result.Parents.size ();
+            for (const auto &[tx, parent] : planted[i]) {
+                result.Transactions <<= tx;
+                result.Parents.push_back (bool (parent) ?
+                    parent_output {std::pair<uint32, Bitcoin::index> {root + parent->first, parent->second}} :
+                    parent_output {});
+            }
+        }
+
+        return result;
+    }
+
+    namespace {
+
+        // a tx in the tree before keys are derived.
+        struct planned_tx {
+            std::vector<int64> Values;
+            std::vector<maybe<uint32>> Children;
+            int64 Required;
+        };
+
+        uint64 outputs_size (uint64 outputs) {
+            return Bitcoin::var_int::size (outputs) + outputs * output_size;
+        }
+
+        // The leaves come first and then each level above them, so the root is last.
+        std::vector<planned_tx> plan_levels (const std::vector<int64> &values, double fee_rate,
+            uint32 max_outputs_per_tx, const maybe<Bitcoin::satoshi> &max_sats_per_tx) {
+
+            // size of a tx in the tree other than its outputs. It has one input.
+            uint64 input_size = pay_to_address::redeem_expected_size (true) + 1 + 40;
+            uint64 tx_size_other_than_outputs = 4 + 4 + 1 + input_size;
+
+            auto fee = [fee_rate] (uint64 size) -> int64 {
+                return int64 (std::ceil (fee_rate * size));
+            };
+
+            std::vector<planned_tx> txs;
+
+            // put values into txs with as many in each as allowed.
+            auto group = [&] (const std::vector<int64> &level, bool leaves) -> std::vector<uint32> {
+                std::vector<uint32> made;
+                for (uint32 i = 0; i < level.size ();) {
+                    planned_tx tx {{}, {}, 0};
+                    int64 value = 0;
+                    for (; i < level.size () && tx.Values.size () < max_outputs_per_tx; i++) {
+                        if (leaves && bool (max_sats_per_tx) && tx.Values.size () > 0 &&
+                            value + level[i] > int64 (*max_sats_per_tx)) break;
+                        tx.Values.push_back (level[i]);
+                        value += level[i];
+                    }
+
+                    tx.Children.resize (tx.Values.size ());
+                    tx.Required = value + fee (tx_size_other_than_outputs + outputs_size (tx.Values.size ()));
+                    made.push_back (txs.size ());
+                    txs.push_back (tx);
+                }
+
+                return made;
+            };
+
+            std::vector<uint32> level = group (values, true);
+            while (level.size () > 1) {
+                std::vector<int64> required;
+                for (uint32 i : level) required.push_back (txs[i].Required);
+
+                uint32 first_child = level.front ();
+                level = group (required, false);
+
+                // the txs of the level below are in order, so we can match them up with these outputs.
+                uint32 child = first_child;
+                for (uint32 i : level) for (auto &c : txs[i].Children) c = child++;
+            }
+
+            // the root doesn't have an input of its own.
+            txs.back ().Required -= fee (tx_size_other_than_outputs);
+            return txs;
+        }
+    }
+
+    split::tree split::construct_tree (data::random::source &r, const key_source &k,
+        Bitcoin::satoshi split_value, double fee_rate, const tree_options &o) const {
+
+        uint64 input_size = pay_to_address::redeem_expected_size (true) + 1 + 40;
+
+        // outputs per tx are limited by the size of a tx.
+        uint32 max_outputs = std::min (uint64 (o.MaxOutputsPerTx),
+            (o.MaxTxSize - (4 + 4 + 1 + input_size + 9)) / output_size);
+        if (max_outputs < 2) throw data::exception {} << "max tx size is too small to split";
+
+        // roughly what each output costs in fees, including its share of the txs above it.
+        double expected_fee_per_output = fee_rate * (output_size + 2.0 * (input_size + output_size) / max_outputs);
+
+        // choose the values of the outputs.
+        std::vector<int64> values;
+        int64 total = 0;
+        while (total + expected_fee_per_output * (values.size () + 1) < int64 (split_value)) {
+            int64 value = int64 (LogTriangular (r) + .5);
+            values.push_back (value);
+            total += value;
+        }
+
+        // the last output gets whatever is left once we know the exact fees. Changing
+        // it can change the shape of the tree and thus the fees, so we go until it settles.
+        // If it doesn't, whatever is left over goes to fees.
+        std::vector<planned_tx> txs;
+        for (uint32 tries = 0; true; tries++) {
+            if (values.size () == 0) throw data::exception {} << "too few sats to split!";
+
+            txs = plan_levels (values, fee_rate, max_outputs, o.MaxSatsPerTx);
+            int64 remainder = int64 (split_value) - txs.back ().Required;
+            if (remainder == 0 || (remainder > 0 && tries >= o.MaxFeeTries)) break;
+
+            if (values.back () + remainder >= MinSatsPerOutput) values.back () += remainder;
+            else values.pop_back ();
+        }
+
+        // derive keys for every output in the tree, root first.
+        uint32 outputs = 0;
+        for (const planned_tx &tx : txs) outputs += tx.Values.size ();
+
+        std::vector<maybe<entry<Bitcoin::address, signing>>> derived (outputs);
+        {
+            uint32 threads = o.Threads != 0 ? o.Threads : std::max (1u, std::thread::hardware_concurrency ());
+            uint32 batch = std::max (1u, outputs / (threads * 4));
+            std::vector<std::exception_ptr> errors ((outputs + batch - 1) / batch);
+            boost::asio::thread_pool pool {threads};
+            for (uint32 begin = 0; begin < outputs; begin += batch)
+                boost::asio::post (pool, [&derived, &errors, &k, begin, batch, end = std::min (outputs, begin + batch)] () {
+                    try {
+                        for (uint32 i = begin; i < end; i++)
+                            derived[i] = make_pay_to_address (*key_source {k.Index + i, k.Sequence});
+                    } catch (...) {
+                        errors[begin / batch] = std::current_exception ();
+                    }
+                });
+
+            pool.join ();
+            for (const auto &e : errors) if (e) std::rethrow_exception (e);
+        }
+
+        // put the txs in order with the root first.
+        uint32 size = txs.size ();
+        auto reversed = [size] (uint32 i) -> uint32 {
+            return size - 1 - i;
+        };
+
+        tree t {std::vector<tree::node> (size), k.Index + outputs};
+        uint32 key_index = 0;
+        for (uint32 i = 0; i < size; i++) {
+            const planned_tx &planned = txs[reversed (i)];
+            tree::node &n = t.Transactions[i];
+
+            n.Outputs.reserve (planned.Values.size ());
+            n.Children.reserve (planned.Values.size ());
+            for (uint32 j = 0; j < planned.Values.size (); j++) {
+                const auto &d = *derived[key_index++];
+                n.Outputs.push_back (redeemable {
+                    Bitcoin::output {Bitcoin::satoshi {planned.Values[j]}, pay_to_address::script (d.Key.digest ())},
+                    d.Value});
+
+                if (bool (planned.Children[j])) {
+                    uint32 child = reversed (*planned.Children[j]);
+                    n.Children.push_back (child);
+                    t.Transactions[child].Parent = std::pair<uint32, uint32> {i, j};
+                } else n.Children.push_back ({});
+            }
+        }
+
+        return t;
+    }
+
+    change split_change_parameters::operator ()
+        (const tx_size &design, satoshis_per_byte fees, key_source x, data::random::source &r) const {
+
+        tx_size size = design;
+        Bitcoin::satoshi left = size.excess (fees) - size.output_fee (tx_size::PayToAddressOutputSize, fees);
+        if (left < MinimumCreateValue) return change {{}, x.Index, size};
+
+        // too little to split, so we make one output.
+        std::vector<int64> values = left < MinSatsPerOutput * 2 ?
+            std::vector<int64> {int64 (left)} :
+            output_values (r, size.excess (fees), double (fees));
+
+        // output_values estimates the fee for its outputs without the rest of
+        // the tx, so the last output takes the difference. If that leaves it
+        // with too little, we drop it and the one before it takes the rest.
+        Bitcoin::satoshi min_last = std::max (MinimumCreateValue, Bitcoin::satoshi {1});
+        while (true) {
+            tx_size before_last = size;
+            for (uint32 i = 0; i + 1 < values.size (); i++)
+                before_last.add_output (Bitcoin::satoshi {values[i]}, tx_size::PayToAddressOutputSize);
+
+            Bitcoin::satoshi last = before_last.excess (fees) - before_last.output_fee (tx_size::PayToAddressOutputSize, fees);
+            if (last >= min_last || values.size () == 1) {
+                values.back () = int64 (last);
+                break;
+            }
+
+            values.pop_back ();
+        }
+
+        if (values.back () < int64 (min_last)) return change {{}, x.Index, size};
+
+        list<redeemable> cx {};
+        for (uint32 i = 0; i < values.size (); i++) {
+            redeemable next = pay_to_next_address (values[i], x);
+            ++x;
+
+            size.add_output (next.Prevout);
+            cx <<= next;
+        }
+
+        return change {data::cross<redeemable> (cx), x.Index, size};
+    }
+
 /*
     split::result split::operator () (redeem ree, data::random::source &rand,
         keychain k, pubkeys p, address_sequence x,
@@ -15,6 +15,10 @@
 
 #include <Cosmos/options.hpp>
 #include <Cosmos/Diophant.hpp>
+#include <Cosmos/network/watcher.hpp>
+#include <Cosmos/network/p2p.hpp>
+#include <Cosmos/network/outbox.hpp>
+#include <Cosmos/wallet/refill.hpp>
 
 #include <io/random.hpp>
 #include <io/main.hpp>
@@ -27,6 +31,16 @@ using namespace Cosmos;
 
 std::atomic<bool> Shutdown {false};
 
+// looks for proofs of pending txs in the background.
+std::unique_ptr<Cosmos::confirmation_watcher> Watcher;
+
+// talks to nodes directly if --p2p is set.
+std::unique_ptr<Cosmos::p2p_client> P2P;
+
+// broadcasts payments that were made while we were offline.
+std::unique_ptr<Cosmos::outbox_flusher> Outbox;
+std::unique_ptr<Cosmos::pool_refiller> Refiller;
+
 bool ShutdownInProgress {false};
 std::mutex ShutdownMutex;
 
@@ -37,6 +51,10 @@ void shutdown () noexcept {
     if (ShutdownInProgress) return;
     std::cout << "\nShut down!" << std::endl;
     ShutdownInProgress = true;
+    if (Watcher != nullptr) Watcher->stop ();
+    if (P2P != nullptr) P2P->stop ();
+    if (Outbox != nullptr) Outbox->stop ();
+    if (Refiller != nullptr) Refiller->stop ();
     if (Server != nullptr) Server->close ();
 }
 
@@ -51,12 +69,15 @@ namespace io {
 
 // we only use this to detect unknown options for now.
 args::command input_schema {
-  set<std::string> {"offline", "accept_remote", "sqlite_in_memory", "ignore_user_entropy"},
+  set<std::string> {"offline", "accept_remote", "sqlite_in_memory", "ignore_user_entropy", "p2p"},
   schema::list::value<std::string> (),
       *schema::map::key<filepath> ("env") &&
       *schema::map::key<net::IP::TCP::endpoint> ("endpoint") &&
       *schema::map::key<net::IP::address> ("ip_address") &&
       *schema::map::key<uint32> ("port") &&
+      *schema::map::key<std::string> ("standin") &&
+      *schema::map::key<std::string> ("whatsonchain_mirror") &&
+      *schema::map::key<std::string> ("peers") &&
       *schema::map::key<std::string> ("nonce") &&
       *schema::map::key<std::string> ("seed")};
 
@@ -94,8 +115,30 @@ namespace io {
 // we use this to handle all concurrent programming.
 boost::asio::io_context IO;
 
+// have peers tell us about txs that pay to the outputs we have and
+// to the next few addresses in the sequences of every wallet.
+void watch_wallets (Cosmos::p2p_client &p2p, controller &db, uint32 look_ahead) {
+    for (const std::string &name : db.list_wallet_names ()) {
+        for (const auto &[_, r] : db.get_wallet_account (name))
+            p2p.watch (Gigamonkey::SHA2_256 (r.Prevout.Script));
+
+        for (const std::string &sequence : {"receive", "change"}) {
+            maybe<Cosmos::key_source> key = db.get_wallet_sequence (name, sequence);
+            if (!bool (key)) continue;
+
+            for (uint32 i = 0; i < look_ahead; i++, ++*key) p2p.watch (Gigamonkey::SHA2_256 (
+                pay_to_address::script (Cosmos::make_pay_to_address (**key).Key.digest ())));
+        }
+    }
+}
+
 ptr<controller> DB;
 std::unique_ptr<Cosmos::network> Network;
+// views of the same database that call the network with different
+// priorities. They share one broadcast queue.
+std::unique_ptr<Cosmos::cached_remote_TXDB> RemoteTXDB;
+std::unique_ptr<Cosmos::cached_remote_TXDB> BackgroundTXDB;
+std::unique_ptr<Cosmos::cached_remote_TXDB> RestoreTXDB;
 
 Cosmos::random::user_entropy UserEntropy;
 
@@ -159,11 +202,48 @@ void run (const options &program_options) {
 
     // set up network
     if (!program_options.local ()) {
-        Network = std::unique_ptr<Cosmos::network> (new Cosmos::network {IO.get_executor ()});
+        Network = std::unique_ptr<Cosmos::network> (new Cosmos::network {IO.get_executor (), program_options.network_endpoints ()});
 
         // TODO: check health of network
 
-        // TODO: update pending transactions
+        // requests from the user go first.
+        RemoteTXDB = std::unique_ptr<Cosmos::cached_remote_TXDB> {
+            new Cosmos::cached_remote_TXDB {*Network, *DB, 6, 16, Cosmos::priority::interactive}};
+
+        // restoring a wallet can take many calls, so it yields to the user.
+        RestoreTXDB = std::unique_ptr<Cosmos::cached_remote_TXDB> {
+            new Cosmos::cached_remote_TXDB {*Network, *DB, 6, 16, Cosmos::priority::restore, 600, RemoteTXDB->Broadcasts}};
+
+        // the watcher, the outbox and the refiller work in the background,
+        // so their calls yield to everything else.
+        BackgroundTXDB = std::unique_ptr<Cosmos::cached_remote_TXDB> {
+            new Cosmos::cached_remote_TXDB {*Network, *DB, 6, 16, Cosmos::priority::background, 600, RemoteTXDB->Broadcasts}};
+
+        Watcher = std::unique_ptr<Cosmos::confirmation_watcher> {new Cosmos::confirmation_watcher {*BackgroundTXDB}};
+        data::spawn (IO.get_executor (), [] () -> awaitable<void> {
+            co_await Watcher->run ();
+        });
+
+        Outbox = std::unique_ptr<Cosmos::outbox_flusher> {new Cosmos::outbox_flusher {*BackgroundTXDB, DB.get ()}};
+        data::spawn (IO.get_executor (), [] () -> awaitable<void> {
+            co_await Outbox->run ();
+        });
+
+        // keep the ready pools stocked while the server is idle.
+        Cosmos::spend_options spend_opts = program_options.spend_options ();
+        Refiller = std::unique_ptr<Cosmos::pool_refiller> {new Cosmos::pool_refiller
+            {*DB, *BackgroundTXDB, Cosmos::ready_pool {spend_opts}, spend_opts.FeeRate}};
+        data::spawn (IO.get_executor (), [] () -> awaitable<void> {
+            co_await Refiller->run ();
+        });
+
+        if (auto p2p = program_options.p2p_options (); bool (p2p)) {
+            P2P = std::unique_ptr<Cosmos::p2p_client> {new Cosmos::p2p_client {IO.get_executor (), *DB, *DB, *p2p}};
+            watch_wallets (*P2P, *DB, spend_opts.MaxLookAhead);
+            data::spawn (IO.get_executor (), [] () -> awaitable<void> {
+                co_await P2P->run ();
+            });
+        }
     }
 
     {
@@ -184,7 +264,7 @@ void run (const options &program_options) {
                 " to see the GUI.";
 
         Server = std::unique_ptr<net::HTTP::server> {new net::HTTP::server
-            (IO.get_executor (), endpoint, server {program_options.spend_options (), *DB, &UserEntropy})};
+            (IO.get_executor (), endpoint, server {program_options.spend_options (), *DB, &UserEntropy, RemoteTXDB.get (), RestoreTXDB.get ()})};
     }
 
     // We should be able to work with multiple threads now except
@@ -0,0 +1,102 @@
+#include <data/async.hpp>
+#include <net/HTTP_server.hpp>
+
+#include <io/arg_parser.hpp>
+#include <io/main.hpp>
+
+#include "standin/service.hpp"
+
+namespace args = io::args;
+namespace schema = data::schema;
+
+using error = io::error;
+
+// a local stand-in for the blockchain services that Cosmos uses,
+// so that network benchmarks can be run deterministically.
+//
+// example:
+//   CosmosStandIn --port=4568 --blocks=1000 --txs_per_block=100 --latency=50 --error_rate=.01
+//
+// and then run the wallet with --standin=127.0.0.1:4568
+
+boost::asio::io_context IO;
+
+std::unique_ptr<net::HTTP::server> Server;
+
+namespace io {
+    void signal_handler (int signal) {
+        if ((signal == SIGINT || signal == SIGTERM) && Server != nullptr) Server->close ();
+    }
+}
+
+args::command input_schema {
+    set<std::string> {},
+    schema::list::value<std::string> (),
+        *schema::map::key<net::IP::TCP::endpoint> ("endpoint") &&
+        *schema::map::key<uint32> ("port") &&
+        *schema::map::key<uint32> ("blocks") &&
+        *schema::map::key<uint32> ("txs_per_block") &&
+        *schema::map::key<uint32> ("addresses") &&
+        *schema::map::key<uint64> ("seed") &&
+        *schema::map::key<uint32> ("latency") &&
+        *schema::map::key<uint32> ("jitter") &&
+        *schema::map::key<double> ("error_rate") &&
+        *schema::map::key<uint32> ("rate_limit")};
+
+template <typename X> X get_option (const args::parsed &p, const std::string &key, X default_value) {
+    maybe<X> x;
+    p.get (key, x);
+    return bool (x) ? *x : default_value;
+}
+
+namespace io {
+    error main (std::span<const char *const> rr) {
+        try {
+            args::parsed p {static_cast<int> (rr.size ()), rr.data ()};
+            args::validate (p, input_schema);
+
+            maybe<net::IP::TCP::endpoint> endpoint;
+            p.get ("endpoint", endpoint);
+            if (!bool (endpoint)) endpoint = net::IP::TCP::endpoint
+                {net::IP::address {"127.0.0.1"}, static_cast<uint16> (get_option<uint32> (p, "port", 4568))};
+
+            if (!endpoint->valid ()) throw data::exception {} << "invalid tcp endpoint " << *endpoint;
+
+            uint64 seed = get_option<uint64> (p, "seed", 0);
+
+            DATA_LOG (note) << "generating synthetic chain";
+            synthetic_chain chain {
+                get_option<uint32> (p, "blocks", 1000),
+                get_option<uint32> (p, "txs_per_block", 100),
+                get_option<uint32> (p, "addresses", 1000), seed};
+
+            DATA_LOG (note) << "generated " << chain.Blocks.size () << " blocks and " << chain.Transactions.size () << " txs";
+            for (uint32 i = 0; i < 10 && i < chain.Addresses.size (); i++)
+                DATA_LOG (note) << "  address " << chain.Addresses[i];
+
+            standin_options options;
+            options.Latency = std::chrono::milliseconds {get_option<uint32> (p, "latency", 0)};
+            options.Jitter = std::chrono::milliseconds {get_option<uint32> (p, "jitter", 0)};
+            options.ErrorRate = get_option<double> (p, "error_rate", 0);
+            options.RateLimit = get_option<uint32> (p, "rate_limit", 0);
+            options.Seed = seed;
+
+            Server = std::unique_ptr<net::HTTP::server> {new net::HTTP::server
+                (IO.get_executor (), *endpoint, standin {chain, IO.get_executor (), options})};
+
+            DATA_LOG (note) << "stand-in service listening at " << *endpoint;
+
+            data::spawn (IO.get_executor (), [] () -> awaitable<void> {
+                while (co_await Server->accept ()) {}
+            });
+
+            IO.run ();
+            return error {};
+
+        } catch (const schema::unknown_key &k) {
+            return error {error::code::user_action, data::string::write ("unknown option ", k.Key)};
+        } catch (const std::exception &x) {
+            return error {error::code::operator_action, std::string {x.what ()}};
+        }
+    }
+}
@@ -4,7 +4,10 @@
 #include <gigamonkey/schema/bip_44.hpp>
 #include <gigamonkey/schema/bip_39.hpp>
 #include <Cosmos/network.hpp>
+#include <Cosmos/network/outbox.hpp>
+#include <Cosmos/database/proof.hpp>
 #include <Cosmos/wallet/split.hpp>
+#include <Cosmos/wallet/ready.hpp>
 #include "interface.hpp"
 
 namespace Cosmos {
@@ -66,13 +69,52 @@ namespace Cosmos {
         // accidentally invalidate them with this payment.
         auto *p = I.payments ();
         if (!bool (p)) throw exception {} << "could not load payments";
-        Cosmos::account pruned_account = *acc;
+        Cosmos::account::builder pruned_account {*acc};
         for (const auto &[_, offer] : p->Proposals) for (const auto diff : offer.Diff) pruned_account <<= diff;
 
-        return spend {
+        auto w = I.wallet ();
+        if (!bool (w)) throw exception {} << "could not load wallet";
+
+        // if we can, we pay with outputs from the ready pool and make no change.
+        auto *db = local_txdb ();
+        return ready_pool {opts}.pay (spend {
             select_down {4, 5000, .5, 5},
-            split_change_parameters {opts}, *get_casual_random ()}
-            (redeem_p2pkh_and_p2pk, *acc, opts.FeeRate);
+            split_change_parameters {opts}, *get_casual_random ()},
+            redeem_p2pkh_and_p2pk, pruned_account.freeze (),
+            [db] (const Bitcoin::outpoint &op) -> bool {
+                return db->transaction (op.Digest).confirmed ();
+            }, w->Addresses.change (), send_to, opts.FeeRate);
+    }
+
+    void refill_ready_pool (Interface::writable u, const spend_options &opts) {
+        auto w = u.get ().wallet ();
+        auto *db = dynamic_cast<controller *> (u.local_txdb ());
+        auto *p = u.get ().payments ();
+        if (!bool (w) || !bool (p) || db == nullptr) throw exception {} << "could not load wallet";
+
+        // outputs in pending payments are not ours to split.
+        Cosmos::account::builder pruned_account {w->Account};
+        for (const auto &[_, offer] : p->Proposals) for (const auto diff : offer.Diff) pruned_account <<= diff;
+
+        spend::spent refill = ready_pool {opts}.refill (redeem_p2pkh_and_p2pk, pruned_account.freeze (),
+            [db] (const Bitcoin::outpoint &op) -> bool {
+                return db->transaction (op.Digest).confirmed ();
+            }, w->Addresses.change (), opts.FeeRate, *get_casual_random ());
+
+        if (!refill.valid ()) return;
+
+        std::cout << "Refilling the ready pool" << std::endl;
+        list<std::pair<Bitcoin::transaction, account_diff>> txs;
+        for (const spend::tx &t : refill.Transactions) {
+            Bitcoin::transaction tx {Bitcoin::incomplete::transaction (t.Transaction.sign (*db))};
+            txs <<= std::pair<Bitcoin::transaction, account_diff> {tx, account_diff {tx.id (), t.Insert, t.Remove}};
+        }
+
+        // the keys are used whether or not the broadcast goes through.
+        u.set_wallet (wallet {w->Pubkeys, w->Addresses.update (w->Addresses.Change, refill.Addresses.Index), w->Account});
+
+        broadcast_tree_result success = u.broadcast (txs);
+        if (!success) std::cout << " could not refill the ready pool because " << success << std::endl;
     }
 
     void update_pending_transactions (Interface::writable u) {
@@ -82,6 +124,27 @@ namespace Cosmos {
         auto *p = u.get ().payments ();
         if (!bool (txdb) || !bool (w) || !bool (p)) throw exception {"could not connect to network and database"};
 
+        // the account with any rejected payments from the outbox undone.
+        Cosmos::account current = w->Account;
+
+        // broadcast anything that was paid while we were offline.
+        if (!data::empty (txdb->Local.get_outgoing ())) {
+            outbox_flusher flusher {*txdb};
+            auto flushed = synced (&outbox_flusher::flush, &flusher);
+            if (!flushed.Connected) std::cout << " could not connect to broadcast payments in the outbox." << std::endl;
+            else std::cout << " broadcast " << flushed.Broadcast << " payments from the outbox." << std::endl;
+
+            // undo the payments that were rejected.
+            for (const outgoing &o : flushed.Rejected) {
+                std::cout << " a payment in the outbox was rejected; undoing it." << std::endl;
+                Cosmos::account::builder undone {current};
+                for (const account_diff &d : outgoing_payment {o.Note}.undo (current)) undone <<= d;
+                current = undone.freeze ();
+            }
+
+            if (!data::empty (flushed.Rejected)) u.set_wallet (wallet {w->Pubkeys, w->Addresses, current});
+        }
+
         // all txs that have been updated with merkle proofs.
         list<Bitcoin::TxID> mined;
         auto unconfirmed = txdb->unconfirmed ();
@@ -94,7 +157,7 @@ namespace Cosmos {
         auto *h = u.history ();
 
         // look for payments that have been made which have been accepted by the network.
-        Cosmos::account pruned_account = w->Account;
+        Cosmos::account::builder pruned_account {current};
         map<string, payments::offer> new_proposals {};
         for (const auto &proposal : p->Proposals) {
             bool broadcast = true;
@@ -135,14 +198,47 @@ namespace Cosmos {
         Cosmos::wallet next_wallet = *w;
 
         // this will throw an exception if any of the diffs are incompatible.
-        for (const auto &[_, diff] : payment) next_wallet.Account <<= diff;
+        Cosmos::account::builder next_account {next_wallet.Account};
+        for (const auto &[_, diff] : payment) next_account <<= diff;
+        next_wallet.Account = next_account.freeze ();
+
+        // if we cannot connect, the payment goes in the outbox along with
+        // the diffs so that we know what to undo if it is rejected later.
+        list<account_diff> diffs = for_each ([] (const auto p) -> account_diff {
+            return p.second;
+        }, payment);
+
+        JSON note = JSON (outgoing_payment {{}, w->Account, diffs});
+
+        list<Bitcoin::transaction> txs = for_each ([] (const auto p) -> Bitcoin::transaction {
+            return p.first;
+        }, payment);
+
+        // with no network, we prepare the payment and leave it in the outbox.
+        if (txdb () == nullptr) {
+            auto *local = local_txdb ();
+            if (local == nullptr) throw exception {} << "could not load the database";
+
+            maybe<SPV::proof> proof = local->proofs () (txs);
+            if (!bool (proof) || !bool (queue_outgoing (*local, *proof, note)))
+                throw exception {} << "could not make a proof for the payment";
+
+            std::cout << "offline; the payment will be broadcast the next time we connect." << std::endl;
+            set_wallet (next_wallet);
+            return broadcast_tree_result {};
+        }
 
         // we assume that the proof exists and can be generated.
         auto success = synced (&cached_remote_TXDB::broadcast, txdb (),
-            *SPV::generate_proof (*txdb (),
-                for_each ([] (const auto p) -> Bitcoin::transaction {
-                    return p.first;
-                }, payment)));
+            *txdb ()->proofs () (txs), maybe<JSON> {note});
+
+        // we update the wallet right away for a queued payment so that
+        // its outputs are not spent again, and treat it as a success.
+        if (success.Error == broadcast_result::QUEUED) {
+            std::cout << "could not connect to the network; the payment will be broadcast later." << std::endl;
+            set_wallet (next_wallet);
+            return broadcast_tree_result {};
+        }
 
         // update wallet.
         if (bool (success)) set_wallet (next_wallet);
@@ -65,6 +65,7 @@ namespace Cosmos {
             Cosmos::cached_remote_TXDB *txdb ();
             SPV::database *spvdb ();
             Cosmos::price_data *price_data ();
+            Cosmos::local_price_data *local_price_data ();
 
             void set_key (const std::string &key_name, const key_expression &k) final override;
             void to_private (const std::string &key_name, const key_expression &k) final override;
@@ -139,6 +140,10 @@ namespace Cosmos {
 
     void update_pending_transactions (Interface::writable);
 
+    // make new outputs for the ready pool if it is running low.
+    // Call this when the user isn't waiting for anything.
+    void refill_ready_pool (Interface::writable, const spend_options &);
+
     void restore_wallet (Interface &e);
 
     void read_both_chains_options (Interface &, const arg_parser &p);
@@ -191,6 +196,11 @@ namespace Cosmos {
         return I.get_price_data ();
     }
 
+    local_price_data inline *Interface::writable::local_price_data () {
+        I.get_price_data ();
+        return I.LocalPriceData.get ();
+    }
+
     const local_TXDB inline *Interface::local_txdb () const {
         return const_cast<Interface *> (this)->get_local_txdb ();
     }
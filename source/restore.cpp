@@ -347,13 +347,18 @@ void command_restore (const arg_parser &p) {
     Interface e {};
 
     auto restore_from_pubkey = [&max_look_ahead, &w] (Cosmos::Interface::writable u) {
+        // a view of the database whose calls to the network are at restore priority.
+        auto *txdb = u.txdb ();
+        cached_remote_TXDB restore_txdb {txdb->Net, txdb->Local, txdb->ReorgDepth,
+            txdb->MaxParallelImports, priority::restore, txdb->MaxHistoryAge, txdb->Broadcasts};
+
         events history {};
         for (const auto &[name, sequence] : w.Addresses.Sequences) {
             std::cout << "checking address sequence " << name << std::endl;
-            auto restored = restore {*max_look_ahead, false} (*u.txdb (), sequence);
-            w.Account = fold ([] (const account a, const account_diff &d) -> account {
-                return a << d;
-            }, w.Account, restored.Account);
+            auto restored = restore {*max_look_ahead, false} (restore_txdb, sequence);
+            account::builder next_account {w.Account};
+            for (const account_diff &d : restored.Account) next_account <<= d;
+            w.Account = next_account.freeze ();
             history = history + restored.History;
             w.Addresses = w.Addresses.update (name, restored.Last);
             std::cout << "done checking address sequence " << name << std::endl;
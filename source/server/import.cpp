@@ -2,6 +2,7 @@
 #include "../Cosmos.hpp"
 #include "import.hpp"
 #include <gigamonkey/pay/BEEF.hpp>
+#include <Cosmos/database/import.hpp>
 
 using namespace Cosmos;
 
@@ -9,12 +10,49 @@ struct retriever {
 
 };
 
+namespace {
+    // we give the body to the importer this much at a time.
+    constexpr size_t import_chunk_size = 64 * 1024;
+
+    bool is_BEEF (const data::bytes &body) {
+        if (body.size () < 4) return false;
+        // BEEF version bytes, or the start of an atomic BEEF.
+        return (body[2] == 0xBE && body[3] == 0xEF && (body[0] == 0x01 || body[0] == 0x02) && body[1] == 0x00) ||
+            (body[0] == 0x01 && body[1] == 0x01 && body[2] == 0x01 && body[3] == 0x01);
+    }
+
+    net::HTTP::response import_BEEF (server &p, const data::bytes &body) {
+        // if we are online, headers that we don't have can be downloaded.
+        SPV::database &headers = p.TXDB != nullptr ? static_cast<SPV::database &> (*p.TXDB) : p.DB;
+
+        BEEF_importer importer {p.DB, headers};
+
+        try {
+            data::byte_slice rest {body};
+            while (rest.size () > 0) {
+                size_t n = std::min (rest.size (), import_chunk_size);
+                importer.feed (rest.range (0, n));
+                rest = rest.range (n, rest.size ());
+            }
+
+            return JSON_response (JSON (importer.finish ()));
+        } catch (const data::exception &x) {
+            return error_response (400, command::IMPORT, command::problem::invalid_parameter, x.what ());
+        }
+    }
+}
+
 net::HTTP::response handle_import (
     server &p, const Diophant::symbol &wallet_name,
     const dispatch<UTF8, UTF8> query,
     const maybe<net::HTTP::content> &content_type,
     const data::bytes &body) {
 
+    // a BEEF in the body is checked and imported as it is read
+    // rather than being parsed into memory all at once.
+    if (bool (content_type) && *content_type == net::HTTP::content::application_octet_stream && is_BEEF (body))
+        return import_BEEF (p, body);
+
     import_request_options opts {wallet_name, query, content_type, body};
 
     // TODO
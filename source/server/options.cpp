@@ -1,5 +1,6 @@
 #include "options.hpp"
 #include <Cosmos/REST/method.hpp>
+#include <sstream>
 
 using uint16 = data::uint16;
 
@@ -122,6 +123,43 @@ net::IP::TCP::endpoint options::endpoint () const {
     return net::IP::TCP::endpoint {this->ip_address (), this->port ()};
 }
 
+Cosmos::network_endpoints options::network_endpoints () const {
+    maybe<std::string> standin;
+    this->get ("standin", standin);
+    if (!bool (standin)) {
+        const char *val = std::getenv ("COSMOS_STANDIN");
+        if (bool (val)) standin = std::string {val};
+    }
+
+    Cosmos::network_endpoints endpoints {};
+    if (bool (standin)) {
+        DATA_LOG (warning) << "WARNING: using stand-in service at " << *standin << " instead of the real network.";
+        endpoints = Cosmos::network_endpoints::standin (*standin);
+    }
+
+    maybe<std::string> mirror;
+    this->get ("whatsonchain_mirror", mirror);
+    if (bool (mirror)) endpoints.WhatsOnChainMirror = Cosmos::host::read (*mirror);
+
+    return endpoints;
+}
+
+maybe<Cosmos::p2p_client::options> options::p2p_options () const {
+    if (!this->has ("p2p")) return {};
+
+    Cosmos::p2p_client::options o {};
+
+    maybe<std::string> peers;
+    this->get ("peers", peers);
+    if (bool (peers)) {
+        std::stringstream ss {*peers};
+        std::string peer;
+        while (std::getline (ss, peer, ',')) if (peer != "") o.Seeds <<= peer;
+    }
+
+    return o;
+}
+
 bool options::local () const {
     bool is_offline = this->offline ();
     bool accept_remote = has_accept_remote (*this);
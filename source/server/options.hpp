@@ -5,6 +5,8 @@
 #include <io/arg_parser.hpp>
 #include <Cosmos/REST/method.hpp>
 #include <Cosmos/types.hpp>
+#include <Cosmos/network.hpp>
+#include <Cosmos/network/p2p.hpp>
 
 namespace schema = data::schema;
 namespace args = io::args;
@@ -32,6 +34,15 @@ struct options : args::parsed {
 
     net::IP::TCP::endpoint endpoint () const;
 
+    // where to find remote services. With --standin=<host:port>
+    // everything goes to a local stand-in service instead. With
+    // --whatsonchain_mirror=<url>, slow lookups are tried there too.
+    Cosmos::network_endpoints network_endpoints () const;
+
+    // with --p2p we also connect to nodes directly. Nodes to start
+    // with can be given as --peers=<ip:port>,<ip:port>,...
+    maybe<Cosmos::p2p_client::options> p2p_options () const;
+
     Cosmos::spend_options spend_options () const;
 
     maybe<bytes> nonce () const;
@@ -4,6 +4,8 @@
 #include "key.hpp"
 #include "to_private.hpp"
 #include "import.hpp"
+#include "spend.hpp"
+#include "split.hpp"
 
 #include <Diophant/parse.hpp>
 #include <Diophant/symbol.hpp>
@@ -148,6 +150,13 @@ awaitable<net::HTTP::response> server::operator () (const net::HTTP::request &re
         Diophant::symbol wallet_name {path[1]};
         if (!data::valid (wallet_name)) co_return error_response (400, m, command::problem::invalid_wallet_name);
 
+        // spending and splitting go to the network, so they are the wallet methods that wait.
+        if (m == command::SPEND)
+            co_return co_await handle_spend (*this, req.Method, wallet_name, query, req.content_type (), req.Body);
+
+        if (m == command::SPLIT)
+            co_return co_await handle_split (*this, req.Method, wallet_name, query, req.content_type (), req.Body);
+
         co_return process_wallet_method (*this, req.Method, m, wallet_name, query, req.content_type (), req.Body);
 
     } catch (const command::exception &e) {
@@ -325,55 +334,6 @@ net::HTTP::response process_wallet_method (
         return handle_import (p, wallet_name, query, content_type, body);
     }
 
-    if (m == command::SPEND) {
-        if (http_method != net::HTTP::method::post)
-            return error_response (405, m, command::problem::invalid_method, "use post");
-
-        auto [to, value, fee_rate, min_change_value, unit,
-            map_redeem_proportion, min_reedeem_proportion,
-            max_value_per_tx, min_value_per_tx, mean_value_per_tx,
-            max_value_per_output, min_value_per_output, mean_value_per_output] = schema::validate<> (query,
-            schema::map::key<std::string> ("to") &&
-            schema::map::key<int64> ("value") &&
-            schema::map::key<satoshis_per_byte> ("fee_rate", p.SpendOptions.FeeRate) &&
-            schema::map::key<Bitcoin::satoshi> ("min_change_value", p.SpendOptions.MinChangeSats) &&
-            schema::map::key<std::string> ("unit", "Bitcoin") && // must be Bitcoin for now.
-            schema::map::key<double> ("max_redeem_proportion", p.SpendOptions.MaxRedeemProportion) &&
-            schema::map::key<double> ("min_redeem_proportion", p.SpendOptions.MinRedeemProportion) &&
-            schema::map::key<Bitcoin::satoshi> ("max_value_per_tx", p.SpendOptions.MaxSatsPerTx) &&
-            schema::map::key<Bitcoin::satoshi> ("min_value_per_tx", p.SpendOptions.MinSatsPerTx) &&
-            schema::map::key<double> ("mean_value_per_tx", p.SpendOptions.MeanSatsPerTx) &&
-            schema::map::key<Bitcoin::satoshi> ("max_value_per_output", p.SpendOptions.MaxSatsPerOutput) &&
-            schema::map::key<Bitcoin::satoshi> ("min_value_per_output", p.SpendOptions.MinSatsPerOutput) &&
-            schema::map::key<double> ("mean_value_per_output", p.SpendOptions.MeanSatsPerOutput));
-
-        if (unit != "Bitcoin" && unit != "BSV")
-            if (http_method != net::HTTP::method::put)
-                return error_response (405, m, command::problem::invalid_query,
-                    "We do not support units other than Bitcoin SV for now.");
-
-        // now we try to read who we are sending to.
-
-        Bitcoin::address pay_to_address;
-        HD::BIP_32::pubkey pay_to_xpub;
-
-        auto pay_to_param = data::get_value (query, UTF8 {"pay_to"});
-        if (bool (pay_to_param)) {
-            pay_to_address = Bitcoin::address {*pay_to_param};
-            pay_to_xpub = HD::BIP_32::pubkey {*pay_to_param};
-        } else return error_response (400, m, command::problem::invalid_query, "required parameter 'pay_to' not present");
-/*
-        if (pay_to_address.valid ()) {
-
-        Cosmos::spend_options spend_options = p.SpendOptions;
-        maybe<net::HTTP::response> error = read_spend_options (spend_options, query);
-        if (bool (error)) return *error;
-            return error_response (501, m, problem::unimplemented);
-        } else if (pay_to_xpub.valid ()) {
-            return error_response (501, m, problem::unimplemented);
-        } else return error_response (400, m, problem::invalid_query, "invalid parameter 'pay_to'");*/
-    }
-
     if (m == command::RESTORE) {
         if (http_method != net::HTTP::method::put)
             return error_response (405, m, command::problem::invalid_method, "use put");
@@ -390,13 +350,6 @@ net::HTTP::response process_wallet_method (
         return error_response (501, m, command::problem::unimplemented);
     }
 
-    if (m == command::SPLIT) {
-        if (http_method != net::HTTP::method::post)
-            return error_response (405, m, command::problem::invalid_method, "use post");
-
-        return error_response (501, m, command::problem::unimplemented);
-    }
-
     if (m == command::TAXES) {
         if (http_method != net::HTTP::method::get)
             return error_response (405, m, command::problem::invalid_method, "use get");
@@ -554,6 +507,11 @@ net::HTTP::response handle_restore (server &p,
     uint32 total_accounts = set_with_default (accounts_param, uint32 {1});
     uint32 max_lookup = set_with_default (max_lookup_param, uint32 {25});
 
+    // the history of the restored addresses is looked up through RestoreTXDB
+    // so that it does not hold up other requests from the user.
+    if (p.RestoreTXDB == nullptr)
+        return error_response (503, command::RESTORE, command::problem::failed, "cannot restore while offline");
+
     // somehow we need to get this key to be valid.
     HD::BIP_32::pubkey pk;
 
@@ -894,7 +852,7 @@ net::HTTP::response handle_restore (server &p,
 
 
 
-    // TODO restore the wallet
+    // TODO restore the wallet with p.RestoreTXDB
     throw data::unimplemented {"method RESTORE"};
 
 }
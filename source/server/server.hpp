@@ -24,8 +24,16 @@ struct server {
 
     Cosmos::random::user_entropy *UserEntropy;
 
-    server (const Cosmos::spend_options &x, controller &db, Cosmos::random::user_entropy *ue):
-        SpendOptions {x}, DB {db}, UserEntropy {ue} {}
+    // null if we are offline. Calls to the network made
+    // through this are at interactive priority.
+    Cosmos::cached_remote_TXDB *TXDB;
+
+    // the same database at restore priority, for restoring wallets.
+    Cosmos::cached_remote_TXDB *RestoreTXDB;
+
+    server (const Cosmos::spend_options &x, controller &db, Cosmos::random::user_entropy *ue,
+        Cosmos::cached_remote_TXDB *txdb = nullptr, Cosmos::cached_remote_TXDB *restore_txdb = nullptr):
+        SpendOptions {x}, DB {db}, UserEntropy {ue}, TXDB {txdb}, RestoreTXDB {restore_txdb} {}
 
     // handle an HTTP request.
     awaitable<net::HTTP::response> operator () (const net::HTTP::request &);
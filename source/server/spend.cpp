@@ -0,0 +1,147 @@
+#include "../Cosmos.hpp"
+#include "spend.hpp"
+#include <data/crypto/random.hpp>
+#include <Cosmos/wallet/send.hpp>
+#include <Cosmos/wallet/ready.hpp>
+
+using namespace Cosmos;
+
+namespace {
+    // nothing if the address or the value is no good.
+    maybe<Bitcoin::output> payee (const std::string &to, int64 value) {
+        Bitcoin::address pay_to {to};
+        if (!pay_to.valid () || value <= 0) return {};
+        return Bitcoin::output {Bitcoin::satoshi {value}, pay_to_address::script (pay_to.digest ())};
+    }
+
+    // a JSON array of objects with "to" and "value".
+    maybe<list<Bitcoin::output>> read_payees (const data::bytes &body) {
+        JSON j = JSON::parse (std::string (body.begin (), body.end ()), nullptr, false);
+        if (!j.is_array () || j.size () == 0) return {};
+
+        list<Bitcoin::output> payees;
+        for (const JSON &x : j) {
+            if (!x.is_object () || !x.contains ("to") || !x["to"].is_string () ||
+                !x.contains ("value") || !x["value"].is_number_integer ()) return {};
+
+            maybe<Bitcoin::output> o = payee (std::string (x["to"]), int64 (x["value"]));
+            if (!bool (o)) return {};
+            payees <<= *o;
+        }
+
+        return payees;
+    }
+}
+
+awaitable<net::HTTP::response> handle_spend (
+    server &p, net::HTTP::method http_method, const Diophant::symbol &wallet_name,
+    dispatch<UTF8, UTF8> query, const maybe<net::HTTP::content> &content_type, const data::bytes &body) {
+
+    command::method m = command::SPEND;
+
+    if (http_method != net::HTTP::method::post)
+        co_return error_response (405, m, command::problem::invalid_method, "use post");
+
+    auto [to, value, fee_rate, min_change_value, unit,
+        max_redeem_proportion, min_redeem_proportion,
+        max_value_per_tx, min_value_per_tx, mean_value_per_tx,
+        max_value_per_output, min_value_per_output, mean_value_per_output] = schema::validate<> (query,
+        *schema::map::key<std::string> ("to") &&
+        *schema::map::key<int64> ("value") &&
+        schema::map::key<satoshis_per_byte> ("fee_rate", p.SpendOptions.FeeRate) &&
+        schema::map::key<Bitcoin::satoshi> ("min_change_value", p.SpendOptions.MinChangeSats) &&
+        schema::map::key<std::string> ("unit", "Bitcoin") && // must be Bitcoin for now.
+        schema::map::key<double> ("max_redeem_proportion", p.SpendOptions.MaxRedeemProportion) &&
+        schema::map::key<double> ("min_redeem_proportion", p.SpendOptions.MinRedeemProportion) &&
+        schema::map::key<Bitcoin::satoshi> ("max_value_per_tx", p.SpendOptions.MaxSatsPerTx) &&
+        schema::map::key<Bitcoin::satoshi> ("min_value_per_tx", p.SpendOptions.MinSatsPerTx) &&
+        schema::map::key<double> ("mean_value_per_tx", p.SpendOptions.MeanSatsPerTx) &&
+        schema::map::key<Bitcoin::satoshi> ("max_value_per_output", p.SpendOptions.MaxSatsPerOutput) &&
+        schema::map::key<Bitcoin::satoshi> ("min_value_per_output", p.SpendOptions.MinSatsPerOutput) &&
+        schema::map::key<double> ("mean_value_per_output", p.SpendOptions.MeanSatsPerOutput));
+
+    if (unit != "Bitcoin" && unit != "BSV")
+        co_return error_response (400, m, command::problem::invalid_query,
+            "We do not support units other than Bitcoin SV for now.");
+
+    // one payee in the query or many in the body.
+    list<Bitcoin::output> payees;
+    if (bool (to)) {
+        if (!bool (value)) co_return error_response (400, m, command::problem::invalid_query, "missing parameter 'value'");
+
+        maybe<Bitcoin::output> o = payee (*to, *value);
+        if (!bool (o)) co_return error_response (400, m, command::problem::invalid_parameter, "invalid parameter 'to' or 'value'");
+        payees <<= *o;
+    } else {
+        if (!bool (content_type) || *content_type != net::HTTP::content::application_json)
+            co_return error_response (400, m, command::problem::invalid_query,
+                "put 'to' and 'value' in the query or a JSON list of payees in the body");
+
+        maybe<list<Bitcoin::output>> read = read_payees (body);
+        if (!bool (read)) co_return error_response (400, m, command::problem::invalid_parameter,
+            "the body should be a list of objects with 'to' and 'value'");
+        payees = *read;
+    }
+
+    maybe<key_source> change = p.DB.get_wallet_sequence (wallet_name, "change");
+    if (!bool (change)) co_return error_response (400, m, command::problem::invalid_parameter,
+        string::write ("wallet ", wallet_name, " has no change sequence"));
+
+    spend_options opts = p.SpendOptions;
+    opts.FeeRate = fee_rate;
+    opts.MinChangeSats = min_change_value;
+    opts.MaxSatsPerOutput = max_value_per_output;
+    opts.MinSatsPerOutput = min_value_per_output;
+    opts.MeanSatsPerOutput = mean_value_per_output;
+
+    spend spender {select_down {4, 5000, .5, 5}, split_change_parameters {opts}, data::crypto::random::get ()};
+    spender.MaxSatsPerTx = max_value_per_tx;
+    spender.MinSatsPerTx = min_value_per_tx;
+    spender.MeanSatsPerTx = mean_value_per_tx;
+    spender.MaxRedeemProportion = max_redeem_proportion;
+    spender.MinRedeemProportion = min_redeem_proportion;
+    spender.Changeless = select_changeless {opts.MinChangeSats, select_down {}};
+
+    spend::spent spent {};
+    maybe<spend_batch::planned> planned {};
+    key_source used {};
+
+    if (data::size (payees) == 1) {
+        // if we can, we pay with outputs from the ready pool and make no change.
+        spent = ready_pool {opts}.pay (spender, redeem_p2pkh_and_p2pk, p.DB.get_wallet_account (wallet_name),
+            [&p] (const Bitcoin::outpoint &op) -> bool {
+                return p.DB.transaction (op.Digest).confirmed ();
+            }, *change, payees, fee_rate);
+
+        if (!spent.valid ()) co_return error_response (500, m, command::problem::failed, "could not make a tx for this payment");
+        used = spent.Addresses;
+    } else {
+        // many payees are split up into a chain of txs.
+        planned = spend_batch {spender} (redeem_p2pkh_and_p2pk, p.DB.get_wallet_account (wallet_name), *change, payees, fee_rate);
+
+        if (!planned->valid ()) co_return error_response (500, m, command::problem::failed, "could not make txs for this payment");
+        used = planned->Addresses;
+    }
+
+    // the keys are used whether or not the broadcast goes through.
+    p.DB.set_wallet_sequence (wallet_name, Diophant::symbol {"change"}, used.Sequence, used.Index);
+
+    try {
+        // if we are offline, the payment goes in the outbox.
+        sent x = bool (planned) ?
+            co_await send (p.DB, p.TXDB, wallet_name, *planned) :
+            co_await send (p.DB, p.TXDB, wallet_name, spent);
+
+        if (!bool (x.Result) && x.Result.Error != broadcast_result::QUEUED)
+            co_return error_response (500, m, command::problem::failed, string::write ("broadcast failed: ", x.Result));
+
+        JSON::array_t txids;
+        for (const Bitcoin::TxID &txid : x.TxIDs) txids.push_back (write (txid));
+
+        co_return JSON_response (JSON::object_t {
+            {"txids", txids},
+            {"queued", x.Result.Error == broadcast_result::QUEUED}});
+    } catch (const account::cannot_apply_diff &) {
+        co_return error_response (409, m, command::problem::failed, "the wallet changed while the payment was being made");
+    }
+}
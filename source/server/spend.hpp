@@ -4,9 +4,14 @@
 #include "server.hpp"
 #include <Cosmos/options.hpp>
 
-net::HTTP::response handle_spend (
-    server &p, net::HTTP::method http_method, dispatch<UTF8, UTF8> query,
-    const maybe<net::HTTP::content> &content_type, const data::bytes &body);
+// * to          -- address to pay.
+// * value       -- number of satoshis to pay.
+// the rest are spend options, which default to those of the server.
+// To pay many addresses at once, leave out to and value and put a JSON
+// list of objects with to and value in the body.
 
-#endif
+awaitable<net::HTTP::response> handle_spend (
+    server &p, net::HTTP::method http_method, const Diophant::symbol &wallet_name,
+    dispatch<UTF8, UTF8> query, const maybe<net::HTTP::content> &content_type, const data::bytes &body);
 
+#endif
@@ -0,0 +1,89 @@
+#include "../Cosmos.hpp"
+#include "split.hpp"
+#include <data/crypto/random.hpp>
+#include <Cosmos/wallet/send.hpp>
+#include <Cosmos/wallet/split.hpp>
+
+using namespace Cosmos;
+
+awaitable<net::HTTP::response> handle_split (
+    server &p, net::HTTP::method http_method, const Diophant::symbol &wallet_name,
+    dispatch<UTF8, UTF8> query, const maybe<net::HTTP::content> &, const data::bytes &) {
+
+    command::method m = command::SPLIT;
+
+    if (http_method != net::HTTP::method::post)
+        co_return error_response (405, m, command::problem::invalid_method, "use post");
+
+    split::tree_options tree_opts {};
+    auto [fee_rate, max_value_per_output, min_value_per_output, mean_value_per_output, seed_hex,
+        max_tx_size, max_value_per_tx] = schema::validate<> (query,
+        schema::map::key<satoshis_per_byte> ("fee_rate", p.SpendOptions.FeeRate) &&
+        schema::map::key<Bitcoin::satoshi> ("max_value_per_output", p.SpendOptions.MaxSatsPerOutput) &&
+        schema::map::key<Bitcoin::satoshi> ("min_value_per_output", p.SpendOptions.MinSatsPerOutput) &&
+        schema::map::key<double> ("mean_value_per_output", p.SpendOptions.MeanSatsPerOutput) &&
+        schema::map::key<std::string> ("seed", std::string {}) &&
+        schema::map::key<uint64> ("max_tx_size", tree_opts.MaxTxSize) &&
+        *schema::map::key<Bitcoin::satoshi> ("max_value_per_tx"));
+
+    tree_opts.MaxTxSize = max_tx_size;
+    tree_opts.MaxSatsPerTx = max_value_per_tx;
+
+    bytes seed (32);
+    if (seed_hex != "") {
+        maybe<bytes> read = encoding::hex::read (seed_hex);
+        if (!bool (read) || read->size () == 0)
+            co_return error_response (400, m, command::problem::invalid_parameter, "invalid parameter 'seed'");
+        seed = *read;
+    } else data::crypto::random::get ().read (seed.data (), seed.size ());
+
+    if (p.TXDB == nullptr) co_return error_response (503, m, command::problem::failed, "cannot split while offline");
+
+    maybe<key_source> change = p.DB.get_wallet_sequence (wallet_name, "change");
+    if (!bool (change)) co_return error_response (400, m, command::problem::invalid_parameter,
+        string::write ("wallet ", wallet_name, " has no change sequence"));
+
+    // every script with an output that is too big, along with all the other
+    // outputs of that script, so that no script is left partly redeemed.
+    account acc = p.DB.get_wallet_account (wallet_name);
+    std::map<digest256, list<entry<Bitcoin::outpoint, redeemable>>> scripts;
+    for (const auto &[op, re] : acc)
+        if (re.Prevout.Value > max_value_per_output) scripts.try_emplace (Gigamonkey::SHA2_256 (re.Prevout.Script));
+
+    if (scripts.empty ()) co_return error_response (400, m, command::problem::failed, "nothing to split");
+
+    for (const auto &[op, re] : acc)
+        if (auto x = scripts.find (Gigamonkey::SHA2_256 (re.Prevout.Script)); x != scripts.end ())
+            x->second <<= entry<Bitcoin::outpoint, redeemable> {op, re};
+
+    list<split::group> groups;
+    for (const auto &[script_hash, outputs] : scripts) groups <<= split::group {script_hash, outputs};
+
+    split::groups_result planned = split {min_value_per_output, max_value_per_output, mean_value_per_output}.split_groups
+        (redeem_p2pkh_and_p2pk, groups, *change, seed, fee_rate, tree_opts);
+
+    DATA_LOG (normal) << "splitting " << groups.size () << " scripts in wallet " << wallet_name <<
+        " with seed " << encoding::hex::write (seed);
+
+    // the keys are used whether or not the broadcast goes through.
+    p.DB.set_wallet_sequence (wallet_name, Diophant::symbol {"change"}, change->Sequence, planned.Last);
+
+    try {
+        // the txs are signed one at a time on this thread, since they all use the same
+        // database, and in order, since txs in a tree spend the outputs of their parents.
+        sent x = co_await send (p.DB, p.TXDB, wallet_name, planned);
+
+        if (!bool (x.Result) && x.Result.Error != broadcast_result::QUEUED)
+            co_return error_response (500, m, command::problem::failed, string::write ("broadcast failed: ", x.Result));
+
+        JSON::array_t txids;
+        for (const Bitcoin::TxID &txid : x.TxIDs) txids.push_back (write (txid));
+
+        co_return JSON_response (JSON::object_t {
+            {"txids", txids},
+            {"queued", x.Result.Error == broadcast_result::QUEUED},
+            {"seed", encoding::hex::write (seed)}});
+    } catch (const account::cannot_apply_diff &) {
+        co_return error_response (409, m, command::problem::failed, "the wallet changed while the split was being made");
+    }
+}
@@ -4,10 +4,22 @@
 #include <net/HTTP.hpp>
 #include "server.hpp"
 
+// split every script in the wallet that has an output bigger than
+// max_value_per_output into outputs with log-distributed values.
+// * fee_rate              -- fee rate, defaulting to that of the server.
+// * max_value_per_output,
+//   min_value_per_output,
+//   mean_value_per_output -- as for spend.
+// * seed                  -- hex. Given the same seed and wallet, the
+//                            values and keys of the split are the same.
+//                            Random if not provided. The seed that was
+//                            used is returned with the txids.
+// * max_tx_size,
+//   max_value_per_tx      -- a script that would need a bigger tx than
+//                            this is split with a tree of txs instead.
 
-net::HTTP::response handle_split (
-    server &p, net::HTTP::method http_method, dispatch<UTF8, UTF8> query,
-    const maybe<net::HTTP::content> &content_type, const data::bytes &body);
+awaitable<net::HTTP::response> handle_split (
+    server &p, net::HTTP::method http_method, const Diophant::symbol &wallet_name,
+    dispatch<UTF8, UTF8> query, const maybe<net::HTTP::content> &content_type, const data::bytes &body);
 
 #endif
-
@@ -83,6 +83,58 @@ namespace Cosmos {
         }
     };
 
+    // split all scripts at once and broadcast the txs together. Each script gets
+    // its own random stream, so given the seed the result is reproducible.
+    void split_concurrently (Interface::writable u, const split &sp, priority_queue<top_splitable> top, const options &opts) {
+        auto w = *u.get ().wallet ();
+
+        list<split::group> groups;
+        for (; !top.empty (); top = rest (top)) groups <<= split::group {first (top).ScriptHash, first (top).Outputs};
+
+        bytes seed (32);
+        get_random ()->read (seed.data (), seed.size ());
+
+        // with the seed, the same split can be made again.
+        std::cout << "split seed: " << encoding::hex::write (seed) << std::endl;
+
+        auto planned = sp.split_groups (redeem_p2pkh_and_p2pk, groups, w.Addresses.change (), seed, opts.FeeRate, split::tree_options {});
+
+        auto *db = dynamic_cast<controller *> (u.local_txdb ());
+        if (db == nullptr) throw exception {} << "cannot sign without a database";
+
+        // the database has one SQLite connection, so we sign on this thread one tx at a time.
+        list<Bitcoin::transaction> txs;
+        account::builder new_account {w.Account};
+        size_t total_size {0};
+        Bitcoin::satoshi total_fee {0};
+        // txs in a tree spend the outputs of their parents, so they are signed in order.
+        for (uint32 i = 0; i < data::size (planned.Transactions); i++) {
+            const spend::tx &t = planned.Transactions[i];
+            Bitcoin::transaction tx {Bitcoin::incomplete::transaction (t.Transaction.sign (*db))};
+            txs <<= tx;
+            total_size += tx.serialized_size ();
+            total_fee += t.Transaction.fee ();
+            new_account <<= planned.complete (i, tx.id ());
+        }
+
+        std::cout << "Transactions have been generated!" << std::endl;
+        std::cout << "  number of transactions: " << txs.size () << std::endl;
+        std::cout << "  total size: " << total_size << std::endl;
+        std::cout << "  total fees: " << total_fee << std::endl;
+
+        if (!get_user_yes_or_no ("Do you want broadcast these transactions?")) throw exception {} << "program aborted";
+
+        maybe<SPV::proof> proof = u.txdb ()->proofs () (txs);
+        if (!bool (proof)) throw exception {} << "could not generate proof for split transactions";
+
+        std::cout << "broadcasting split transactions" << std::endl;
+        broadcast_tree_result success = synced (&cached_remote_TXDB::broadcast, u.txdb (), *proof);
+        if (!success) throw exception {} << "could not broadcast because " << success;
+        std::cout << "broadcast successful!" << std::endl;
+
+        u.set_wallet (wallet {w.Pubkeys, w.Addresses.update (w.Addresses.Change, planned.Last), new_account.freeze ()});
+    }
+
     priority_queue<top_splitable> get_top_splitable (splitable x) {
         priority_queue<top_splitable> top;
         for (const auto &e : x) {
@@ -105,6 +157,9 @@ void command_split (const arg_parser &p) {
 
     Cosmos::split split {opts.MinSatsPerOutput, opts.MaxSatsPerOutput, opts.MeanSatsPerOutput};
 
+    // split all scripts at once rather than one after another.
+    bool concurrent = p.has ("concurrent");
+
     splitable x;
 
     // the user may provide an address or xpub to split. If it is provided, we look for
@@ -267,7 +322,8 @@ void command_split (const arg_parser &p) {
 
     if (!get_user_yes_or_no ("Do you want to continue?")) throw exception {} << "program aborted";
 
-    e.update<void> ([&split, &top, &opts] (Cosmos::Interface::writable u) {
+    e.update<void> ([&split, &top, &opts, concurrent] (Cosmos::Interface::writable u) {
+        if (concurrent) return split_concurrently (u, split, top, opts);
 
         auto &txdb = *u.txdb ();
 
@@ -298,7 +354,7 @@ void command_split (const arg_parser &p) {
                 spend::spent spent = split (Gigamonkey::redeem_p2pkh_and_p2pk, *get_random (),
                     *u.get ().keys (), next.Wallet, t.Outputs, double (opts.FeeRate));
 
-                account new_account = next.Wallet.Account;
+                account::builder new_account {next.Wallet.Account};
 
                 std::cout << " Produced " << spent.Transactions.size () << " transactions " << std::endl;
                 list<Bitcoin::transaction> txs;
@@ -320,7 +376,7 @@ void command_split (const arg_parser &p) {
                 }
 
                 next = split_result {*SPV::generate_proof (*u.txdb (), txs),
-                    wallet {next.Wallet.Pubkeys, spent.Addresses, new_account}};
+                    wallet {next.Wallet.Pubkeys, spent.Addresses, new_account.freeze ()}};
 
                 split_txs <<= next;
 
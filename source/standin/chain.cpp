@@ -0,0 +1,254 @@
+#include "chain.hpp"
+#include <Cosmos/serialize.hpp>
+#include <random>
+
+namespace {
+
+    using namespace Cosmos::serialize;
+
+    // what the coinbase gives to the chain of txs in each block.
+    constexpr int64 chain_start_value = 5000000000;
+
+    // each tx in the chain pays a random amount less than this, plus a fee.
+    constexpr int64 min_payment = 10000;
+    constexpr int64 payment_range = 1000000;
+    constexpr int64 tx_fee = 50;
+
+    void write_script (bytes &b, const bytes &script) {
+        write_var_int (b, script.size ());
+        write_bytes (b, script);
+    }
+
+    data::byte_slice read_script (reader &r) {
+        return r.read (r.read_var_int ());
+    }
+
+    // we accept txs in either standard or extended format. This removes the
+    // extended data if present and collects the output scripts.
+    bytes read_standard (data::byte_slice tx, std::vector<bytes> &output_scripts) {
+        reader r {tx};
+        bytes standard;
+
+        write_bytes (standard, r.read (4));
+
+        static const byte marker[6] {0, 0, 0, 0, 0, 0xef};
+        bool extended = tx.size () >= 10 && std::equal (marker, marker + 6, tx.begin () + 4);
+        if (extended) r.read (6);
+
+        uint64 inputs = r.read_var_int ();
+        write_var_int (standard, inputs);
+        for (uint64 i = 0; i < inputs; i++) {
+            write_bytes (standard, r.read (36));
+            write_script (standard, bytes (read_script (r)));
+            write_bytes (standard, r.read (4));
+            if (extended) {
+                r.read (8);
+                read_script (r);
+            }
+        }
+
+        uint64 outputs = r.read_var_int ();
+        write_var_int (standard, outputs);
+        for (uint64 i = 0; i < outputs; i++) {
+            write_bytes (standard, r.read (8));
+            bytes script (read_script (r));
+            write_script (standard, script);
+            output_scripts.push_back (script);
+        }
+
+        write_bytes (standard, r.read (4));
+        if (!r.done ()) throw data::exception {} << "tx has extra bytes";
+        return standard;
+    }
+
+    digest256 hash_pair (const digest256 &a, const digest256 &b) {
+        bytes x;
+        write_bytes (x, data::byte_slice (a));
+        write_bytes (x, data::byte_slice (b));
+        return data::crypto::Bitcoin_256 (x);
+    }
+
+    // all levels of the merkle tree, starting with the leaves.
+    std::vector<std::vector<digest256>> merkle_levels (const std::vector<digest256> &leaves) {
+        std::vector<std::vector<digest256>> levels {leaves};
+        while (levels.back ().size () > 1) {
+            const auto &last = levels.back ();
+            std::vector<digest256> next;
+            for (size_t i = 0; i < last.size (); i += 2)
+                next.push_back (hash_pair (last[i], i + 1 < last.size () ? last[i + 1] : last[i]));
+            levels.push_back (next);
+        }
+
+        return levels;
+    }
+
+    bytes make_tx (const Bitcoin::outpoint &spend, const bytes &input_script, const list<Bitcoin::output> &outputs) {
+        bytes tx;
+        write_uint (tx, 1, 4);
+
+        write_var_int (tx, 1);
+        write_bytes (tx, data::byte_slice (spend.Digest));
+        write_uint (tx, uint32 (spend.Index), 4);
+        write_script (tx, input_script);
+        write_uint (tx, 0xffffffff, 4);
+
+        write_var_int (tx, outputs.size ());
+        for (const Bitcoin::output &o : outputs) {
+            write_uint (tx, uint64 (int64 (o.Value)), 8);
+            write_script (tx, o.Script);
+        }
+
+        write_uint (tx, 0, 4);
+        return tx;
+    }
+
+    std::set<std::string> script_keys (const bytes &script) {
+        digest256 d = Gigamonkey::SHA2_256 (script);
+        bytes raw (d.begin (), d.end ());
+        bytes reversed (d.rbegin (), d.rend ());
+        return {Cosmos::write (d), std::string (encoding::hex::write (raw)), std::string (encoding::hex::write (reversed))};
+    }
+}
+
+synthetic_chain::synthetic_chain (uint32 blocks, uint32 txs_per_block, uint32 addresses, uint64 seed) {
+    if (blocks == 0) throw data::exception {} << "at least one block is required";
+    if (addresses == 0) throw data::exception {} << "at least one address is required";
+    if (txs_per_block == 0) throw data::exception {} << "every block needs at least a coinbase tx";
+
+    // the chain of txs in a block must not run out of money.
+    if (int64 (txs_per_block) * (min_payment + payment_range + tx_fee) >= chain_start_value)
+        throw data::exception {} << "too many txs per block; there must be fewer than " <<
+            chain_start_value / (min_payment + payment_range + tx_fee);
+    std::mt19937_64 random {seed};
+
+    std::vector<bytes> scripts;
+    for (uint32 i = 0; i < addresses; i++) {
+        digest160 d;
+        for (byte &b : d) b = static_cast<byte> (random ());
+        Addresses.push_back (Bitcoin::address {Bitcoin::network::Main, d});
+        scripts.push_back (pay_to_address::script (d));
+    }
+
+    // a fake signature and pubkey so that txs are the size of real ones.
+    bytes input_script;
+    input_script.push_back (72);
+    input_script.resize (73, 0x30);
+    input_script.push_back (33);
+    input_script.resize (107, 0x02);
+
+    digest256 previous {};
+    for (uint64 height = 0; height < blocks; height++) {
+        std::vector<Bitcoin::TxID> txids;
+
+        // the coinbase pays to a miner address and to a chain of txs in this block.
+        uint32 miner = random () % addresses;
+        uint32 holder = random () % addresses;
+        Bitcoin::satoshi chain_value {chain_start_value};
+
+        // the height goes in the coinbase script so that every coinbase is different.
+        bytes coinbase_script = input_script;
+        write_uint (coinbase_script, height, 8);
+
+        bytes tx = make_tx (Bitcoin::outpoint {Bitcoin::TxID {}, 0xffffffff}, coinbase_script, {
+            Bitcoin::output {Bitcoin::satoshi {1250000000}, scripts[miner]},
+            Bitcoin::output {chain_value, scripts[holder]}});
+
+        // scripts whose history includes the next tx.
+        std::vector<bytes> touched {scripts[miner], scripts[holder]};
+
+        for (uint32 i = 0; i < txs_per_block; i++) {
+            Bitcoin::TxID txid = data::crypto::Bitcoin_256 (tx);
+            Transactions[txid] = tx;
+            Confirmed[txid] = {height, i};
+            txids.push_back (txid);
+            for (const bytes &script : touched) add_history (script, txid, {height});
+
+            uint32 payee = random () % addresses;
+            uint32 next_holder = random () % addresses;
+            Bitcoin::satoshi payment {int64 (min_payment + random () % payment_range)};
+            chain_value = chain_value - payment - Bitcoin::satoshi {tx_fee};
+
+            touched = {scripts[holder], scripts[payee], scripts[next_holder]};
+            tx = make_tx (Bitcoin::outpoint {txid, 1}, input_script, {
+                Bitcoin::output {payment, scripts[payee]},
+                Bitcoin::output {chain_value, scripts[next_holder]}});
+            holder = next_holder;
+        }
+
+        auto levels = merkle_levels (txids);
+
+        bytes header;
+        write_uint (header, 1, 4);
+        write_bytes (header, data::byte_slice (previous));
+        write_bytes (header, data::byte_slice (levels.back ()[0]));
+        write_uint (header, 1600000000 + 600 * height, 4);
+        // regtest difficulty, so that a valid nonce is quick to find.
+        write_uint (header, 0x207fffff, 4);
+        write_uint (header, 0, 4);
+
+        digest256 hash;
+        for (uint32 nonce = 0; true; nonce++) {
+            for (int j = 0; j < 4; j++) header[76 + j] = static_cast<byte> (nonce >> (8 * j));
+            hash = data::crypto::Bitcoin_256 (header);
+            if (hash[31] < 0x7f) break;
+        }
+
+        block b {hash, {}, height, txids};
+        std::copy (header.begin (), header.end (), b.Header.begin ());
+        Blocks.push_back (b);
+        ByHash[hash] = height;
+        previous = hash;
+    }
+}
+
+void synthetic_chain::add_history (const bytes &output_script, const Bitcoin::TxID &txid, maybe<uint64> height) {
+    std::set<std::string> keys = script_keys (output_script);
+    pay_to_address p2a {output_script};
+    if (p2a.valid ()) keys.insert (std::string (Bitcoin::address {Bitcoin::network::Main, p2a.Address}));
+
+    for (const std::string &key : keys) {
+        auto &h = History[key];
+        // the same tx can touch a script more than once.
+        if (h.size () > 0 && h.back ().TxID == txid) continue;
+        h.push_back (history_entry {txid, height});
+    }
+}
+
+Bitcoin::TxID synthetic_chain::submit (const bytes &tx) {
+    std::vector<bytes> output_scripts;
+    bytes standard = read_standard (tx, output_scripts);
+    Bitcoin::TxID txid = data::crypto::Bitcoin_256 (standard);
+    if (Transactions.contains (txid)) return txid;
+
+    Transactions[txid] = standard;
+    for (const bytes &script : output_scripts) add_history (script, txid, {});
+    return txid;
+}
+
+maybe<std::pair<uint64, uint32>> synthetic_chain::confirmation (const Bitcoin::TxID &txid) const {
+    auto c = Confirmed.find (txid);
+    if (c == Confirmed.end ()) return {};
+    return c->second;
+}
+
+std::vector<digest256> synthetic_chain::branch (const Bitcoin::TxID &txid) const {
+    auto c = confirmation (txid);
+    if (!bool (c)) return {};
+
+    auto levels = merkle_levels (Blocks[c->first].TxIDs);
+    std::vector<digest256> b;
+    uint32 index = c->second;
+    for (size_t i = 0; i + 1 < levels.size (); i++) {
+        uint32 sibling = index ^ 1;
+        b.push_back (sibling < levels[i].size () ? levels[i][sibling] : levels[i][index]);
+        index >>= 1;
+    }
+
+    return b;
+}
+
+const synthetic_chain::block *synthetic_chain::by_hash (const digest256 &hash) const {
+    auto b = ByHash.find (hash);
+    if (b == ByHash.end ()) return nullptr;
+    return &Blocks[b->second];
+}
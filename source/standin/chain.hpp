@@ -0,0 +1,60 @@
+#ifndef STANDIN_CHAIN
+#define STANDIN_CHAIN
+
+#include <Cosmos/database/write.hpp>
+
+// a deterministic chain of synthetic blocks and transactions that we
+// serve in place of the real network. Transactions are well formed
+// but their input scripts are not valid signatures, so this is only
+// useful for benchmarking the parts of the wallet that talk to the
+// network and the database.
+struct synthetic_chain {
+
+    struct block {
+        digest256 Hash;
+        byte_array<80> Header;
+        uint64 Height;
+        std::vector<Bitcoin::TxID> TxIDs;
+    };
+
+    struct history_entry {
+        Bitcoin::TxID TxID;
+        // none for txs in the mempool.
+        maybe<uint64> Height;
+    };
+
+    std::vector<block> Blocks;
+    std::map<digest256, uint64> ByHash;
+
+    std::map<Bitcoin::TxID, bytes> Transactions;
+
+    // block height and index of every confirmed tx.
+    std::map<Bitcoin::TxID, std::pair<uint64, uint32>> Confirmed;
+
+    // histories are indexed by address string and by script hash
+    // in both byte orders, since it's not always clear which is meant.
+    std::map<std::string, std::vector<history_entry>> History;
+
+    // the synthetic addresses, so that we can tell a client what to ask for.
+    std::vector<Bitcoin::address> Addresses;
+
+    // generate a chain with the given shape. The same seed always gives the same chain.
+    // Throws if there are no blocks or addresses or if there are too many txs per block
+    // for the value that the coinbase gives them.
+    synthetic_chain (uint32 blocks, uint32 txs_per_block, uint32 addresses, uint64 seed);
+
+    // txs submitted by a client are added to the mempool.
+    Bitcoin::TxID submit (const bytes &tx);
+
+    maybe<std::pair<uint64, uint32>> confirmation (const Bitcoin::TxID &) const;
+
+    // the merkle branch from a tx to the root of its block.
+    std::vector<digest256> branch (const Bitcoin::TxID &) const;
+
+    const block *by_hash (const digest256 &) const;
+
+private:
+    void add_history (const bytes &output_script, const Bitcoin::TxID &, maybe<uint64> height);
+};
+
+#endif
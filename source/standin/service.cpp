@@ -0,0 +1,413 @@
+#include "service.hpp"
+#include <cmath>
+
+namespace {
+
+    net::HTTP::response JSON_response (unsigned int status, const JSON &j) {
+        return net::HTTP::response (status, {{"content-type", "application/json"}}, bytes (data::string (j.dump ())));
+    }
+
+    net::HTTP::response text_response (const std::string &x) {
+        return net::HTTP::response (200, {{"content-type", "text/plain"}}, bytes (data::string (x)));
+    }
+
+    net::HTTP::response error_response (unsigned int status, const std::string &title) {
+        return JSON_response (status, JSON::object_t {{"status", status}, {"title", title}});
+    }
+
+    list<UTF8> normalize_path (list<UTF8> path) {
+        if (size (path) > 0 && data::first (path) == "") path = data::rest (path);
+        if (size (path) > 0 && path[size (path) - 1] == "") path = data::reverse (data::rest (data::reverse (path)));
+        return path;
+    }
+
+    list<UTF8> drop (list<UTF8> path, uint32 n) {
+        for (uint32 i = 0; i < n && size (path) > 0; i++) path = data::rest (path);
+        return path;
+    }
+
+    maybe<UTF8> query_param (const dispatch<UTF8, UTF8> &query, const UTF8 &key) {
+        for (const auto &e : query) if (e.Key == key) return e.Value;
+        return {};
+    }
+
+    maybe<Bitcoin::TxID> read_txid (const UTF8 &x) {
+        return data::encoding::read<Bitcoin::TxID> {} (x);
+    }
+
+    // a synthetic price that changes slowly from day to day.
+    double price_on (uint32 seconds) {
+        double day = seconds / 86400;
+        return 50 + 20 * std::sin (day / 30);
+    }
+
+    JSON write_block (const synthetic_chain &chain, const synthetic_chain::block &b) {
+        JSON::object_t j {
+            {"hash", Cosmos::write (b.Hash)},
+            {"height", b.Height},
+            {"confirmations", chain.Blocks.size () - b.Height},
+            {"txcount", b.TxIDs.size ()},
+            {"header", std::string (encoding::hex::write (bytes (b.Header)))}};
+
+        Bitcoin::header h {b.Header};
+        j["version"] = int32 (h.Version);
+        j["merkleroot"] = Cosmos::write (h.MerkleRoot);
+        j["time"] = uint32 (h.Timestamp);
+        j["nonce"] = uint32 (h.Nonce);
+        j["bits"] = "207fffff";
+        if (b.Height > 0) j["previousblockhash"] = Cosmos::write (h.Previous);
+        if (b.Height + 1 < chain.Blocks.size ()) j["nextblockhash"] = Cosmos::write (chain.Blocks[b.Height + 1].Hash);
+        return j;
+    }
+
+    JSON write_history (const synthetic_chain &chain, const std::string &key, int which, uint64 from_height = 0) {
+        JSON::array_t result;
+        auto h = chain.History.find (key);
+        if (h != chain.History.end ()) for (const auto &e : h->second) {
+            // which: 0 for all, 1 for confirmed, 2 for unconfirmed.
+            if (which == 1 && !bool (e.Height)) continue;
+            if (which == 2 && bool (e.Height)) continue;
+            if (which == 1 && *e.Height < from_height) continue;
+            // like WhatsOnChain, we give txs in the mempool a height of zero.
+            result.push_back (JSON::object_t {{"tx_hash", Cosmos::write (e.TxID)}, {"height", bool (e.Height) ? *e.Height : 0}});
+        }
+
+        return result;
+    }
+
+    JSON ARC_status (const synthetic_chain &chain, const Bitcoin::TxID &txid) {
+        JSON::object_t j {
+            {"txid", Cosmos::write (txid)},
+            {"status", 200},
+            {"title", "OK"},
+            {"extraInfo", ""},
+            {"timestamp", "2020-01-01T00:00:00Z"}};
+
+        if (auto c = chain.confirmation (txid); bool (c)) {
+            j["txStatus"] = "MINED";
+            j["blockHash"] = Cosmos::write (chain.Blocks[c->first].Hash);
+            j["blockHeight"] = c->first;
+        } else j["txStatus"] = "SEEN_ON_NETWORK";
+
+        return j;
+    }
+
+    // ARC accepts raw bytes, hex, or JSON objects with a rawTx field.
+    list<bytes> read_submitted (const bytes &body) {
+        if (body.size () == 0) return {};
+
+        if (body[0] == '{' || body[0] == '[') {
+            JSON j = JSON::parse (std::string (body.begin (), body.end ()));
+            if (j.is_object ()) j = JSON::array_t {j};
+
+            list<bytes> txs;
+            for (const JSON &tx : j) {
+                maybe<bytes> b = encoding::hex::read (std::string (tx["rawTx"]));
+                if (!bool (b)) throw data::exception {} << "invalid hex";
+                txs <<= *b;
+            }
+
+            return txs;
+        }
+
+        std::string text (body.begin (), body.end ());
+        if (maybe<bytes> b = encoding::hex::read (text); bool (b)) return {*b};
+
+        // newline separated hex for multiple txs.
+        list<bytes> txs;
+        std::stringstream ss {text};
+        std::string line;
+        bool all_hex = true;
+        while (std::getline (ss, line)) {
+            if (line.size () == 0) continue;
+            maybe<bytes> b = encoding::hex::read (line);
+            if (!bool (b)) {
+                all_hex = false;
+                break;
+            }
+
+            txs <<= *b;
+        }
+
+        if (all_hex && size (txs) > 0) return txs;
+        return {body};
+    }
+}
+
+awaitable<net::HTTP::response> standin::operator () (const net::HTTP::request &req) {
+    DATA_LOG (debug) << "stand-in responding to request " << req;
+
+    std::chrono::milliseconds delay = State->Options.Latency;
+    if (State->Options.Jitter.count () > 0)
+        delay += std::chrono::milliseconds {State->Random () % State->Options.Jitter.count ()};
+
+    if (delay.count () > 0) {
+        net::asio::steady_timer timer {IO};
+        timer.expires_after (delay);
+        co_await timer.async_wait (net::asio::use_awaitable);
+    }
+
+    if (rate_limited ()) co_return error_response (429, "Too Many Requests");
+
+    if (State->Options.ErrorRate > 0 &&
+        std::uniform_real_distribution<double> {0, 1} (State->Random) < State->Options.ErrorRate)
+        co_return error_response (503, "Service Unavailable");
+
+    try {
+        co_return respond (req);
+    } catch (const std::exception &x) {
+        DATA_LOG (warning) << "stand-in could not respond to request: " << x.what ();
+        co_return error_response (400, x.what ());
+    }
+}
+
+bool standin::rate_limited () {
+    if (State->Options.RateLimit == 0) return false;
+
+    auto now = std::chrono::steady_clock::now ();
+    double elapsed = std::chrono::duration<double> (now - State->LastRefill).count ();
+    State->LastRefill = now;
+    State->Tokens = std::min<double> (State->Options.RateLimit, State->Tokens + elapsed * State->Options.RateLimit);
+
+    if (State->Tokens < 1) return true;
+    State->Tokens -= 1;
+    return false;
+}
+
+net::HTTP::response standin::respond (const net::HTTP::request &req) {
+    list<UTF8> path = normalize_path (req.Target.path ().read ('/'));
+
+    dispatch<UTF8, UTF8> query;
+    if (maybe<dispatch<UTF8, UTF8>> qm = req.Target.query_map (); bool (qm)) query = *qm;
+
+    if (size (path) >= 3 && path[0] == "v1" && path[1] == "bsv" && path[2] == "main")
+        return WhatsOnChain (req.Method, drop (path, 3), query, req.Body);
+
+    if (size (path) >= 2 && path[0] == "v1") return ARC (req.Method, drop (path, 1), req.Body);
+
+    if (size (path) >= 1 && path[0] == "mapi") return MAPI (req.Method, drop (path, 1));
+
+    if (size (path) >= 2 && path[0] == "api" && path[1] == "v3") return CoinGecko (drop (path, 2), query);
+
+    // WhatsOnChain without the version prefix.
+    if (size (path) >= 1) return WhatsOnChain (req.Method, path, query, req.Body);
+
+    return error_response (404, "Not Found");
+}
+
+net::HTTP::response standin::WhatsOnChain (net::HTTP::method method, list<UTF8> path, dispatch<UTF8, UTF8> query, const bytes &body) {
+    uint32 n = size (path);
+    if (n == 0) return error_response (404, "Not Found");
+
+    if (n == 2 && path[0] == "chain" && path[1] == "info") {
+        const auto &tip = Chain.Blocks.back ();
+        return JSON_response (200, JSON::object_t {
+            {"chain", "main"},
+            {"blocks", tip.Height},
+            {"headers", tip.Height},
+            {"bestblockhash", Cosmos::write (tip.Hash)}});
+    }
+
+    if (path[0] == "block") {
+        const synthetic_chain::block *b = nullptr;
+
+        if (n == 3 && path[1] == "height") {
+            uint64 height = std::stoull (path[2]);
+            if (height < Chain.Blocks.size ()) b = &Chain.Blocks[height];
+        } else if (n == 3 && path[1] == "hash") {
+            if (auto h = read_txid (path[2]); bool (h)) b = Chain.by_hash (*h);
+        } else if (n == 3 && path[2] == "header") {
+            if (auto h = read_txid (path[1]); bool (h)) b = Chain.by_hash (*h);
+        } else if (n == 2 && path[1] == "headers") {
+            JSON::array_t headers;
+            for (uint64 i = Chain.Blocks.size (); i > 0 && headers.size () < 10; i--)
+                headers.push_back (write_block (Chain, Chain.Blocks[i - 1]));
+            return JSON_response (200, headers);
+        }
+
+        if (b == nullptr) return error_response (404, "Not Found");
+        return JSON_response (200, write_block (Chain, *b));
+    }
+
+    if (n == 2 && path[0] == "txs" && path[1] == "status" && method == net::HTTP::method::post) {
+        JSON j = JSON::parse (std::string (body.begin (), body.end ()));
+        JSON::array_t statuses;
+        for (const JSON &t : j["txids"]) {
+            maybe<Bitcoin::TxID> txid = read_txid (std::string (t));
+            if (!bool (txid) || !Chain.Transactions.contains (*txid)) {
+                statuses.push_back (JSON::object_t {{"txid", t}, {"error", "unknown"}});
+                continue;
+            }
+
+            JSON::object_t status {{"txid", t}};
+            if (auto c = Chain.confirmation (*txid); bool (c)) {
+                status["blockhash"] = Cosmos::write (Chain.Blocks[c->first].Hash);
+                status["blockheight"] = c->first;
+                status["confirmations"] = Chain.Blocks.size () - c->first;
+            }
+
+            statuses.push_back (status);
+        }
+
+        return JSON_response (200, statuses);
+    }
+
+    if (path[0] == "tx") {
+        if (n == 2 && path[1] == "raw" && method == net::HTTP::method::post) {
+            JSON j = JSON::parse (std::string (body.begin (), body.end ()));
+            maybe<bytes> tx = encoding::hex::read (std::string (j["txhex"]));
+            if (!bool (tx)) return error_response (400, "invalid hex");
+            return JSON_response (200, Cosmos::write (Chain.submit (*tx)));
+        }
+
+        maybe<Bitcoin::TxID> txid = n >= 2 ? read_txid (path[n == 3 && path[1] == "hash" ? 2 : 1]) : maybe<Bitcoin::TxID> {};
+        if (!bool (txid)) return error_response (404, "Not Found");
+
+        auto tx = Chain.Transactions.find (*txid);
+        if (tx == Chain.Transactions.end ()) return error_response (404, "Not Found");
+
+        if (n == 3 && path[2] == "hex") return text_response (std::string (encoding::hex::write (tx->second)));
+
+        if (n == 3 && path[1] == "hash") {
+            JSON::object_t j {{"txid", Cosmos::write (*txid)}, {"hex", std::string (encoding::hex::write (tx->second))}};
+            if (auto c = Chain.confirmation (*txid); bool (c)) {
+                j["blockhash"] = Cosmos::write (Chain.Blocks[c->first].Hash);
+                j["blockheight"] = c->first;
+                j["confirmations"] = Chain.Blocks.size () - c->first;
+            }
+
+            return JSON_response (200, j);
+        }
+
+        if (n == 4 && path[2] == "proof" && path[3] == "tsc") {
+            auto c = Chain.confirmation (*txid);
+            if (!bool (c)) return JSON_response (200, nullptr);
+
+            JSON::array_t nodes;
+            for (const digest256 &d : Chain.branch (*txid)) nodes.push_back (Cosmos::write (d));
+
+            return JSON_response (200, JSON::array_t {JSON::object_t {
+                {"index", c->second},
+                {"txOrId", Cosmos::write (*txid)},
+                {"target", Cosmos::write (Chain.Blocks[c->first].Hash)},
+                {"nodes", nodes}}});
+        }
+
+        return error_response (404, "Not Found");
+    }
+
+    if ((path[0] == "address" || path[0] == "script") && n >= 3) {
+        std::string key = path[1];
+        UTF8 last = path[n - 1];
+        if (last != "history") return error_response (404, "Not Found");
+
+        if (n == 3) return JSON_response (200, write_history (Chain, key, 0));
+
+        int which = path[2] == "confirmed" ? 1 : path[2] == "unconfirmed" ? 2 : -1;
+        if (which < 0) return error_response (404, "Not Found");
+
+        maybe<UTF8> from = query_param (query, "height");
+
+        return JSON_response (200, JSON::object_t {
+            {path[0] == "address" ? "address" : "script", key},
+            {"result", write_history (Chain, key, which, bool (from) ? std::stoull (*from) : 0)},
+            {"error", ""}});
+    }
+
+    return error_response (404, "Not Found");
+}
+
+net::HTTP::response standin::ARC (net::HTTP::method method, list<UTF8> path, const bytes &body) {
+    uint32 n = size (path);
+
+    if (n == 1 && path[0] == "policy") return JSON_response (200, JSON::object_t {
+        {"timestamp", "2020-01-01T00:00:00Z"},
+        {"policy", JSON::object_t {
+            {"maxscriptsizepolicy", 100000000},
+            {"maxtxsizepolicy", 100000000},
+            {"miningFee", JSON::object_t {{"satoshis", 1}, {"bytes", 1000}}}}}});
+
+    if (n == 2 && path[0] == "tx" && method == net::HTTP::method::get) {
+        maybe<Bitcoin::TxID> txid = read_txid (path[1]);
+        if (!bool (txid) || !Chain.Transactions.contains (*txid)) return error_response (404, "Not Found");
+        return JSON_response (200, ARC_status (Chain, *txid));
+    }
+
+    if (n == 1 && (path[0] == "tx" || path[0] == "txs") && method == net::HTTP::method::post) {
+        list<bytes> txs = read_submitted (body);
+        if (size (txs) == 0) return error_response (400, "no transaction provided");
+
+        JSON::array_t statuses;
+        for (const bytes &tx : txs) try {
+            statuses.push_back (ARC_status (Chain, Chain.submit (tx)));
+        } catch (const std::exception &x) {
+            if (path[0] == "tx") return error_response (463, "Malformed transaction");
+            statuses.push_back (JSON::object_t {{"status", 463}, {"title", "Malformed transaction"}, {"extraInfo", x.what ()}});
+        }
+
+        if (path[0] == "tx") return JSON_response (200, statuses[0]);
+        return JSON_response (200, statuses);
+    }
+
+    return error_response (404, "Not Found");
+}
+
+net::HTTP::response standin::MAPI (net::HTTP::method, list<UTF8> path) {
+    if (size (path) != 1 || path[0] != "feeQuote") return error_response (404, "Not Found");
+
+    const auto &tip = Chain.Blocks.back ();
+    JSON::object_t fee {{"satoshis", 1}, {"bytes", 1000}};
+    JSON payload = JSON::object_t {
+        {"apiVersion", "1.4.0"},
+        {"timestamp", "2020-01-01T00:00:00.000Z"},
+        {"expiryTime", "2100-01-01T00:00:00.000Z"},
+        {"minerId", nullptr},
+        {"currentHighestBlockHash", Cosmos::write (tip.Hash)},
+        {"currentHighestBlockHeight", tip.Height},
+        {"fees", JSON::array_t {
+            JSON::object_t {{"feeType", "standard"}, {"miningFee", fee}, {"relayFee", fee}},
+            JSON::object_t {{"feeType", "data"}, {"miningFee", fee}, {"relayFee", fee}}}}};
+
+    return JSON_response (200, JSON::object_t {
+        {"payload", payload.dump ()},
+        {"signature", nullptr},
+        {"publicKey", nullptr},
+        {"encoding", "UTF-8"},
+        {"mimetype", "application/json"}});
+}
+
+net::HTTP::response standin::CoinGecko (list<UTF8> path, dispatch<UTF8, UTF8> query) {
+    uint32 n = size (path);
+    if (n < 3 || path[0] != "coins" || path[1] != "bitcoin-cash-sv") return error_response (404, "Not Found");
+
+    if (n == 3 && path[2] == "history") {
+        maybe<UTF8> date = query_param (query, "date");
+        if (!bool (date)) return error_response (400, "date required");
+
+        std::tm time {};
+        if (std::sscanf (date->c_str (), "%d-%d-%d", &time.tm_mday, &time.tm_mon, &time.tm_year) != 3)
+            return error_response (400, "invalid date");
+        time.tm_mon -= 1;
+        time.tm_year -= 1900;
+
+        return JSON_response (200, JSON::object_t {{"market_data", JSON::object_t {
+            {"current_price", JSON::object_t {{"usd", price_on (uint32 (timegm (&time)))}}}}}});
+    }
+
+    if (n == 4 && path[2] == "market_chart" && path[3] == "range") {
+        maybe<UTF8> from = query_param (query, "from");
+        maybe<UTF8> to = query_param (query, "to");
+        if (!bool (from) || !bool (to)) return error_response (400, "from and to required");
+
+        uint32 begin = std::stoul (*from);
+        uint32 end = std::stoul (*to);
+
+        JSON::array_t prices;
+        for (uint64 day = begin - begin % 86400; day <= end; day += 86400)
+            prices.push_back (JSON::array_t {day * 1000, price_on (day)});
+
+        return JSON_response (200, JSON::object_t {{"prices", prices}});
+    }
+
+    return error_response (404, "Not Found");
+}
@@ -0,0 +1,62 @@
+#ifndef STANDIN_SERVICE
+#define STANDIN_SERVICE
+
+#include <random>
+#include <net/HTTP.hpp>
+#include "chain.hpp"
+
+// how the stand-in service should misbehave.
+struct standin_options {
+    // every response is delayed by Latency plus a random amount up to Jitter.
+    std::chrono::milliseconds Latency {0};
+    std::chrono::milliseconds Jitter {0};
+
+    // the proportion of requests that get a 503 response.
+    double ErrorRate {0};
+
+    // requests per second allowed before we respond with 429. Zero means no limit.
+    uint32 RateLimit {0};
+
+    uint64 Seed {0};
+};
+
+// serve the parts of the WhatsOnChain, ARC, MAPI, and CoinGecko
+// APIs that Cosmos uses, all from a synthetic chain at one address.
+struct standin {
+
+    standin (synthetic_chain &chain, data::exec io, const standin_options &o):
+        Chain {chain}, IO {io}, State {std::make_shared<state> (o)} {}
+
+    // handle an HTTP request.
+    awaitable<net::HTTP::response> operator () (const net::HTTP::request &);
+
+private:
+    synthetic_chain &Chain;
+    data::exec IO;
+
+    // shared between copies of this handler.
+    struct state {
+        standin_options Options;
+        std::mt19937_64 Random;
+
+        // a token bucket for the rate limit.
+        double Tokens;
+        std::chrono::steady_clock::time_point LastRefill;
+
+        state (const standin_options &o): Options {o}, Random {o.Seed},
+            Tokens (o.RateLimit), LastRefill {std::chrono::steady_clock::now ()} {}
+    };
+
+    ptr<state> State;
+
+    net::HTTP::response respond (const net::HTTP::request &);
+
+    net::HTTP::response WhatsOnChain (net::HTTP::method, list<UTF8> path, dispatch<UTF8, UTF8> query, const bytes &body);
+    net::HTTP::response ARC (net::HTTP::method, list<UTF8> path, const bytes &body);
+    net::HTTP::response MAPI (net::HTTP::method, list<UTF8> path);
+    net::HTTP::response CoinGecko (list<UTF8> path, dispatch<UTF8, UTF8> query);
+
+    bool rate_limited ();
+};
+
+#endif
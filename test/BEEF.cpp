@@ -0,0 +1,93 @@
+#include <Cosmos/database/import.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    Bitcoin::transaction test_tx (byte n) {
+        Bitcoin::TxID prev;
+        prev[0] = n;
+        return Bitcoin::transaction {1,
+            list<Bitcoin::input> {Bitcoin::input {Bitcoin::outpoint {prev, 0}, bytes {}}},
+            list<Bitcoin::output> {Bitcoin::output {Bitcoin::satoshi {1000 + n}, bytes {}}}, 0};
+    }
+
+    // BRC-62 with no BUMPs.
+    bytes test_BEEF_V1 (list<Bitcoin::transaction> txs) {
+        bytes b {0x01, 0x00, 0xBE, 0xEF, 0x00, byte (txs.size ())};
+        for (const Bitcoin::transaction &tx : txs) {
+            bytes raw = tx.write ();
+            b.insert (b.end (), raw.begin (), raw.end ());
+            // no BUMP.
+            b.push_back (0x00);
+        }
+
+        return b;
+    }
+
+    list<BEEF_stream::tx> read_txs (const list<BEEF_stream::element> &elements) {
+        list<BEEF_stream::tx> txs;
+        for (const auto &e : elements) {
+            EXPECT_TRUE (e.is<BEEF_stream::tx> ());
+            if (e.is<BEEF_stream::tx> ()) txs <<= e.get<BEEF_stream::tx> ();
+        }
+
+        return txs;
+    }
+
+    TEST (BEEF, StreamWhole) {
+        list<Bitcoin::transaction> txs {test_tx (1), test_tx (2)};
+
+        BEEF_stream stream {};
+        list<BEEF_stream::tx> read = read_txs (stream.feed (test_BEEF_V1 (txs)));
+
+        EXPECT_TRUE (stream.complete ());
+        ASSERT_EQ (read.size (), 2);
+        EXPECT_EQ (read[0].TxID, txs[0].id ());
+        EXPECT_EQ (read[1].TxID, txs[1].id ());
+        EXPECT_TRUE (bool (read[0].Transaction));
+        EXPECT_FALSE (bool (read[0].BUMPIndex));
+    }
+
+    // we should get the same txs no matter how the bytes are broken up.
+    TEST (BEEF, StreamByteAtATime) {
+        list<Bitcoin::transaction> txs {test_tx (1), test_tx (2), test_tx (3)};
+        bytes beef = test_BEEF_V1 (txs);
+
+        BEEF_stream stream {};
+        list<BEEF_stream::tx> read;
+        for (size_t i = 0; i < beef.size (); i++) {
+            EXPECT_FALSE (stream.complete ());
+            for (const auto &tx : read_txs (stream.feed (data::byte_slice {beef.data () + i, 1}))) read <<= tx;
+        }
+
+        EXPECT_TRUE (stream.complete ());
+        ASSERT_EQ (read.size (), 3);
+        for (uint32 i = 0; i < 3; i++) EXPECT_EQ (read[i].TxID, txs[i].id ());
+    }
+
+    // a txid with no tx, which is allowed in BRC-96.
+    TEST (BEEF, StreamTxIDOnly) {
+        Bitcoin::TxID txid;
+        txid[0] = 7;
+
+        bytes beef {0x02, 0x00, 0xBE, 0xEF, 0x00, 0x01, 0x02};
+        beef.insert (beef.end (), txid.begin (), txid.end ());
+
+        BEEF_stream stream {};
+        list<BEEF_stream::tx> read = read_txs (stream.feed (beef));
+
+        EXPECT_TRUE (stream.complete ());
+        ASSERT_EQ (read.size (), 1);
+        EXPECT_EQ (read[0].TxID, txid);
+        EXPECT_FALSE (bool (read[0].Transaction));
+    }
+
+    TEST (BEEF, StreamInvalid) {
+        EXPECT_THROW (BEEF_stream {}.feed (bytes {0x01, 0x00, 0xBE, 0xEE, 0x00, 0x00}), data::exception);
+
+        bytes extra = test_BEEF_V1 ({test_tx (1)});
+        extra.push_back (0x00);
+        EXPECT_THROW (BEEF_stream {}.feed (extra), data::exception);
+    }
+
+}
@@ -0,0 +1,131 @@
+#include <Cosmos/wallet/account.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    Bitcoin::outpoint test_outpoint (byte b, uint32 index = 0) {
+        Bitcoin::TxID txid;
+        txid[0] = b;
+        return Bitcoin::outpoint {txid, index};
+    }
+
+    redeemable test_redeemable (int64 value, uint64 expected_size = 107) {
+        return redeemable {Bitcoin::output {Bitcoin::satoshi {value}, bytes {}}, {}, expected_size};
+    }
+
+    // the totals kept by insert and remove must match those worked out from scratch.
+    void expect_totals (const account &a) {
+        Bitcoin::satoshi value {0};
+        uint64 count = 0;
+        uint64 expected_size = 0;
+        Bitcoin::satoshi max {0};
+        for (const auto &[key, re] : a) {
+            value += re.Prevout.Value;
+            count++;
+            expected_size += re.expected_input_size ();
+            if (re.Prevout.Value > max) max = re.Prevout.Value;
+        }
+
+        EXPECT_EQ (a.value (), value);
+        EXPECT_EQ (a.count (), count);
+        EXPECT_EQ (a.inputs_expected_size (), expected_size);
+        EXPECT_EQ (a.details ().Max.value (), max);
+        if (count > 0) EXPECT_EQ (a.details ().Max.value (), a.contains (a.details ().Max.Key)->Prevout.Value);
+    }
+
+    TEST (Account, Totals) {
+        account a {};
+        expect_totals (a);
+
+        int64 values[] {5000, 1000, 8000, 3000, 8000, 2000, 13000};
+        for (uint32 i = 0; i < std::size (values); i++) {
+            a = a.insert (test_outpoint (byte (i + 1)), test_redeemable (values[i], 100 + i));
+            expect_totals (a);
+        }
+
+        // the old account is unchanged.
+        account b = a.remove (test_outpoint (7));
+        EXPECT_EQ (a.value (), Bitcoin::satoshi {40000});
+        EXPECT_EQ (b.value (), Bitcoin::satoshi {27000});
+
+        // remove the biggest repeatedly, and some others.
+        for (byte x : {7, 3, 1, 5, 2}) {
+            b = b.remove (test_outpoint (x));
+            expect_totals (b);
+        }
+
+        // removing something that isn't there does nothing.
+        expect_totals (b.remove (test_outpoint (100)));
+
+        // inserting an outpoint that is already there replaces it.
+        b = b.insert (test_outpoint (4), test_redeemable (20000));
+        EXPECT_EQ (b.count (), 2u);
+        expect_totals (b);
+
+        b = b.remove (test_outpoint (4)).remove (test_outpoint (6));
+        EXPECT_TRUE (b.empty ());
+        expect_totals (b);
+
+        // an account read from JSON works out its totals when they are needed.
+        expect_totals (account {JSON (a)});
+    }
+
+    std::map<Bitcoin::outpoint, int64> values (const account &a) {
+        std::map<Bitcoin::outpoint, int64> v;
+        for (const auto &[key, re] : a) v[key] = int64 (re.Prevout.Value);
+        return v;
+    }
+
+    account_diff test_diff (byte txid, list<int64> insert, list<Bitcoin::outpoint> remove) {
+        map<Bitcoin::index, redeemable> ins;
+        Bitcoin::index i = 0;
+        for (int64 v : insert) ins = ins.insert (i++, test_redeemable (v));
+
+        map<Bitcoin::index, Bitcoin::outpoint> rem;
+        i = 0;
+        for (const Bitcoin::outpoint &o : remove) rem = rem.insert (i++, o);
+
+        return account_diff {test_outpoint (txid).Digest, ins, rem};
+    }
+
+    TEST (Account, Builder) {
+        // a small base, so that freeze makes a new account, and
+        // a big one, so that it makes the changes one at a time.
+        for (uint32 base_size : {2, 100}) {
+            account base {};
+            for (uint32 i = 0; i < base_size; i++) base = base.insert (test_outpoint (200, i), test_redeemable (1000 + i));
+
+            list<account_diff> diffs {
+                test_diff (1, {5000, 6000, 7000}, {test_outpoint (200, 0)}),
+                // spend an output made in this batch and one from the base.
+                test_diff (2, {8000}, {test_outpoint (1, 1), test_outpoint (200, 1)}),
+                test_diff (3, {}, {test_outpoint (2, 0)})};
+
+            account expected = base;
+            account::builder b {base};
+            for (const account_diff &d : diffs) {
+                expected <<= d;
+                b <<= d;
+            }
+
+            account built = b.freeze ();
+            EXPECT_EQ (values (built), values (expected)) << "base size " << base_size;
+            expect_totals (built);
+
+            // a diff that removes something we don't have leaves the builder unchanged.
+            EXPECT_THROW (b <<= test_diff (4, {9000}, {test_outpoint (2, 0)}), account::cannot_apply_diff);
+            EXPECT_EQ (values (b.freeze ()), values (expected));
+        }
+
+        // an output of the base that is replaced and then removed is gone.
+        account base = account {}.insert (test_outpoint (1), test_redeemable (1000));
+        account::builder b {base};
+        b.insert (test_outpoint (1), test_redeemable (2000));
+        b <<= test_diff (2, {3000}, {test_outpoint (1)});
+        account built = b.freeze ();
+        EXPECT_FALSE (bool (built.contains (test_outpoint (1))));
+        EXPECT_EQ (built.count (), 1u);
+        expect_totals (built);
+    }
+
+}
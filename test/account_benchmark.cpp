@@ -0,0 +1,59 @@
+#include "benchmark.hpp"
+
+// a history in which each tx spends some outputs of the txs before it
+// and makes new ones, like a wallet that has been used for a while.
+list<account_diff> random_history (uint32 txs, uint32 outputs_per_tx, data::random::source &r) {
+    list<account_diff> diffs;
+    std::vector<Bitcoin::outpoint> unspent;
+    for (uint32 i = 0; i < txs; i++) {
+        Bitcoin::TxID txid;
+        r.read (txid.data (), txid.size ());
+
+        map<Bitcoin::index, Bitcoin::outpoint> remove;
+        for (uint32 j = 0; j < 2 && unspent.size () > 0; j++) {
+            uint32 k = std::uniform_int_distribution<uint32> {0, uint32 (unspent.size () - 1)} (r);
+            remove = remove.insert (j, unspent[k]);
+            unspent[k] = unspent.back ();
+            unspent.pop_back ();
+        }
+
+        map<Bitcoin::index, redeemable> insert;
+        for (uint32 j = 0; j < outputs_per_tx; j++) {
+            insert = insert.insert (j, redeemable {Bitcoin::output {Bitcoin::satoshi {1000 + j}, bytes {}}, {}, 107});
+            unspent.push_back (Bitcoin::outpoint {txid, j});
+        }
+
+        diffs <<= account_diff {txid, insert, remove};
+    }
+
+    return diffs;
+}
+
+void benchmark (const char *name, const list<account_diff> &diffs) {
+    account one_at_a_time {};
+    int64 persistent = microseconds ([&] () {
+        for (const account_diff &d : diffs) one_at_a_time <<= d;
+    });
+
+    account built {};
+    int64 transient = microseconds ([&] () {
+        account::builder b {built};
+        for (const account_diff &d : diffs) b <<= d;
+        built = b.freeze ();
+    });
+
+    std::cout << name << ": " << one_at_a_time.size () << " outputs\n  operator <<=    " << persistent <<
+        " us\n  account::builder " << transient << " us" << std::endl;
+}
+
+int main (int arg_count, char **arg_values) {
+    xorshift r {0x2545f4914f6cdd1d};
+
+    // like the result of a split.
+    benchmark ("10 txs with 500 outputs each", random_history (10, 500, r));
+
+    // like replaying a long history.
+    benchmark ("20000 txs with 3 outputs each", random_history (20000, 3, r));
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include "benchmark.hpp"
+#include <Cosmos/wallet/batch.hpp>
+#include <Cosmos/wallet/split.hpp>
+#include <Cosmos/Diophant.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    namespace {
+        account batch_account () {
+            account acc {};
+            for (uint32 i = 0; i < 40; i++) {
+                Bitcoin::TxID txid;
+                txid[0] = byte (i + 1);
+                acc = acc.insert (Bitcoin::outpoint {txid, i},
+                    redeemable {Bitcoin::output {Bitcoin::satoshi {100000}, bytes {}}, {}, 107});
+            }
+
+            return acc;
+        }
+
+        key_source batch_keys () {
+            return key_source {0, key_sequence {
+                key_expression {HD::BIP_32::secret::from_seed (bytes (32, 1))},
+                key_derivation {"@ key index -> key / index"}}};
+        }
+
+        list<Bitcoin::output> batch_payees (uint32 n) {
+            list<Bitcoin::output> payees;
+            for (uint32 i = 0; i < n; i++) {
+                digest160 d;
+                d[0] = byte (i + 1);
+                payees <<= Bitcoin::output {Bitcoin::satoshi {50000}, pay_to_address::script (d)};
+            }
+
+            return payees;
+        }
+
+        nosig::script no_redeem (const Bitcoin::output &, list<nosig::sigop>, const bytes &) {
+            return {};
+        }
+
+        // all that is left goes into one change output.
+        change one_change (const tx_size &design, satoshis_per_byte fees, key_source k, data::random::source &) {
+            redeemable r = pay_to_next_address (int64 (design.excess (fees) -
+                design.output_fee (tx_size::PayToAddressOutputSize, fees)), k);
+            tx_size size = design;
+            size.add_output (r.Prevout);
+            return change {data::cross<redeemable> {r}, k.Index + 1, size};
+        }
+    }
+
+    TEST (Batch, Plan) {
+        diophant::initialize (nullptr);
+
+        account acc = batch_account ();
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 10};
+        xorshift r {13};
+
+        spend_batch batch {spend {select_down {3, Bitcoin::satoshi {1000}, .1, .1}, one_change, r}};
+        batch.MaxTxSize = 1000;
+        batch.ChangeReserveSize = tx_size::PayToAddressOutputSize;
+
+        spend_batch::planned x = batch (no_redeem, acc, batch_keys (), batch_payees (30), fees);
+
+        ASSERT_TRUE (x.valid ());
+        uint32 count = data::size (x.Transactions);
+        ASSERT_GT (count, 1);
+        ASSERT_EQ (data::size (x.Carried), count - 1);
+
+        uint32 paid = 0;
+        for (uint32 i = 0; i < count; i++) {
+            const spend::tx &t = x.Transactions[i];
+            tx_size built = t.Transaction.size ();
+
+            // every tx fits and pays enough fees.
+            EXPECT_LE (built.size (), batch.MaxTxSize);
+            EXPECT_GE (built.excess (fees), 0);
+
+            for (const Bitcoin::output &o : t.Transaction.Outputs) if (o.Value == Bitcoin::satoshi {50000}) paid++;
+
+            // the carried output is one of ours.
+            if (i + 1 < count) {
+                Bitcoin::index carried = x.Carried[i];
+                auto inserted = t.Insert.contains (carried);
+                ASSERT_TRUE (bool (inserted));
+                EXPECT_EQ (inserted->Prevout, t.Transaction.Outputs[carried]);
+            }
+        }
+
+        EXPECT_EQ (paid, 30);
+
+        // the txids would come from signing.
+        account::builder next {acc};
+        for (uint32 i = 0; i < count; i++) {
+            Bitcoin::TxID txid;
+            txid[0] = 0xff;
+            txid[1] = byte (i);
+
+            account_diff diff = x.complete (i, txid);
+            EXPECT_EQ (diff.TxID, txid);
+
+            if (i + 1 < count) {
+                Bitcoin::outpoint carried {txid, x.Carried[i]};
+                const spend::tx &t = x.Transactions[i + 1];
+                EXPECT_EQ (t.Transaction.Inputs[0].Reference, carried);
+                EXPECT_EQ (*t.Remove.contains (0), carried);
+            }
+
+            // the next tx removes the carried output, so this only works if it was linked.
+            EXPECT_NO_THROW (next <<= diff);
+        }
+
+        // all that was spent went to the payees, to the miners, or back to us.
+        account after = next.freeze ();
+        int64 fee = 0;
+        for (const spend::tx &t : x.Transactions) fee += int64 (t.Transaction.size ().fee ());
+        EXPECT_EQ (int64 (acc.value ()) - int64 (after.value ()), 30 * 50000 + fee);
+    }
+
+    TEST (Batch, Limits) {
+        diophant::initialize (nullptr);
+
+        account acc = batch_account ();
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 10};
+        xorshift r {17};
+
+        spend_batch batch {spend {select_down {3, Bitcoin::satoshi {1000}, .1, .1}, one_change, r}};
+        batch.ChangeReserveSize = tx_size::PayToAddressOutputSize;
+
+        // a tx too small for even one payee.
+        batch.MaxTxSize = 100;
+        EXPECT_THROW (batch (no_redeem, acc, batch_keys (), batch_payees (3), fees), data::exception);
+
+        // more in fees than we will pay.
+        batch.MaxTxSize = 1000;
+        batch.MaxFee = Bitcoin::satoshi {1};
+        EXPECT_THROW (batch (no_redeem, acc, batch_keys (), batch_payees (3), fees), data::exception);
+
+        // more than we have.
+        batch.MaxFee = {};
+        EXPECT_THROW (batch (no_redeem, acc, batch_keys (), batch_payees (100), fees), data::exception);
+    }
+
+}
@@ -0,0 +1,49 @@
+#ifndef COSMOS_TEST_BENCHMARK
+#define COSMOS_TEST_BENCHMARK
+
+#include <Cosmos/wallet/account.hpp>
+#include <chrono>
+#include <iostream>
+
+using namespace Cosmos;
+
+// fast and deterministic, so that runs can be compared.
+struct xorshift final : data::random::source {
+    uint64 State;
+
+    xorshift (uint64 seed): State {seed} {}
+
+    void read (byte *result, size_t remaining) final override {
+        while (remaining > 0) {
+            State ^= State << 13;
+            State ^= State >> 7;
+            State ^= State << 17;
+            size_t n = remaining > 8 ? 8 : remaining;
+            for (size_t i = 0; i < n; i++) result[i] = byte (State >> (8 * i));
+            result += n;
+            remaining -= n;
+        }
+    }
+};
+
+account inline random_account (uint32 outputs, data::random::source &r) {
+    account acc {};
+    std::uniform_int_distribution<int64> values {1000, 10000000};
+    for (uint32 i = 0; i < outputs; i++) {
+        Bitcoin::TxID txid;
+        r.read (txid.data (), txid.size ());
+        // a mix of p2pkh and p2pk inputs.
+        acc = acc.insert (Bitcoin::outpoint {txid, i % 4},
+            redeemable {Bitcoin::output {Bitcoin::satoshi {values (r)}, bytes {}}, {}, i % 3 == 0 ? 73 : 107});
+    }
+
+    return acc;
+}
+
+template <typename fun> int64 inline microseconds (fun f) {
+    auto start = std::chrono::steady_clock::now ();
+    f ();
+    return std::chrono::duration_cast<std::chrono::microseconds> (std::chrono::steady_clock::now () - start).count ();
+}
+
+#endif
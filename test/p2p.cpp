@@ -0,0 +1,180 @@
+#include <Cosmos/network/p2p.hpp>
+#include <Cosmos/database/memory/database.hpp>
+#include <Cosmos/serialize.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    namespace {
+        using tcp = net::asio::ip::tcp;
+        using namespace serialize;
+
+        struct test_peers : peer_store {
+            std::map<std::string, peer_record> Records;
+
+            list<peer_record> peers (uint32 max) final override {
+                list<peer_record> r;
+                for (const auto &[_, p] : Records) if (r.size () < max) r <<= p;
+                return r;
+            }
+
+            maybe<peer_record> peer (const std::string &address) final override {
+                auto x = Records.find (address);
+                if (x == Records.end ()) return {};
+                return x->second;
+            }
+
+            void set_peer (const peer_record &p) final override {
+                Records[p.Address] = p;
+            }
+        };
+
+        // a node that does just enough of the protocol to relay a tx.
+        struct standin_node {
+            tcp::socket Socket;
+            uint32 Magic;
+
+            static uint32 checksum (data::byte_slice payload) {
+                digest256 d = data::crypto::Bitcoin_256 (payload);
+                return reader {data::byte_slice (d)}.read_uint (4);
+            }
+
+            awaitable<void> send (const std::string &command, const bytes &payload) {
+                bytes msg;
+                write_uint (msg, Magic, 4);
+                for (size_t i = 0; i < 12; i++) msg.push_back (i < command.size () ? byte (command[i]) : byte (0));
+                write_uint (msg, payload.size (), 4);
+                write_uint (msg, checksum (payload), 4);
+                write_bytes (msg, payload);
+                co_await net::asio::async_write (Socket, net::asio::buffer (msg.data (), msg.size ()), net::asio::use_awaitable);
+            }
+
+            // return the command of the next message.
+            awaitable<std::string> receive () {
+                bytes header (24);
+                co_await net::asio::async_read (Socket, net::asio::buffer (header.data (), header.size ()), net::asio::use_awaitable);
+
+                reader r {header};
+                EXPECT_EQ (r.read_uint (4), Magic);
+
+                std::string command;
+                for (byte b : r.read (12)) if (b != 0) command.push_back (char (b));
+
+                bytes payload (r.read_uint (4));
+                if (payload.size () > 0) co_await net::asio::async_read (Socket,
+                    net::asio::buffer (payload.data (), payload.size ()), net::asio::use_awaitable);
+
+                co_return command;
+            }
+        };
+
+        bytes version () {
+            bytes b;
+            write_uint (b, 70016, 4);
+            // services and time.
+            write_uint (b, 0, 8);
+            write_uint (b, 0, 8);
+            // addresses of the receiver and the sender.
+            for (int i = 0; i < 2 * 26; i++) b.push_back (0);
+            // nonce, empty user agent, start height, and relay.
+            write_uint (b, 1, 8);
+            write_var_int (b, 0);
+            write_uint (b, 0, 4);
+            b.push_back (1);
+            return b;
+        }
+
+        // accept one connection, announce the tx, and send it when it is asked for.
+        awaitable<bool> relay (tcp::acceptor &acceptor, uint32 magic, Bitcoin::transaction tx) {
+            standin_node node {co_await acceptor.async_accept (net::asio::use_awaitable), magic};
+
+            // the client speaks first.
+            std::string first = co_await node.receive ();
+            EXPECT_EQ (first, "version");
+            co_await node.send ("version", version ());
+            co_await node.send ("verack", bytes {});
+
+            bytes inv;
+            write_var_int (inv, 1);
+            // a tx.
+            write_uint (inv, 1, 4);
+            write_bytes (inv, data::byte_slice (tx.id ()));
+            co_await node.send ("inv", inv);
+
+            // the client may send verack and getheaders first.
+            while (co_await node.receive () != "getdata");
+            co_await node.send ("tx", tx.write ());
+
+            // messages are handled in order, so once we have a pong the client has seen the tx.
+            co_await node.send ("ping", bytes (8, 0));
+            while (co_await node.receive () != "pong");
+
+            co_return true;
+        }
+    }
+
+    TEST (P2P, RelayWatchedTx) {
+        net::asio::io_context io;
+        tcp::acceptor acceptor {io, tcp::endpoint {net::asio::ip::make_address ("127.0.0.1"), 0}};
+        std::string address = data::string::write ("127.0.0.1:", acceptor.local_endpoint ().port ());
+
+        memory_local_TXDB db {};
+        test_peers peers {};
+
+        p2p_client::options o {};
+        o.MaxPeers = 1;
+        o.Seeds = {address};
+        p2p_client client {io.get_executor (), db, peers, o};
+
+        Bitcoin::TxID prev;
+        prev[0] = 1;
+        Bitcoin::outpoint spent {prev, 0};
+        Bitcoin::output paid {Bitcoin::satoshi {1000}, pay_to_address::script (digest160 {})};
+        Bitcoin::transaction tx {1,
+            list<Bitcoin::input> {Bitcoin::input {spent, bytes {}}},
+            list<Bitcoin::output> {paid}, 0};
+
+        client.watch (Gigamonkey::SHA2_256 (paid.Script));
+
+        // don't hang if something goes wrong.
+        net::asio::steady_timer timeout {io, std::chrono::seconds {10}};
+        timeout.async_wait ([&] (const boost::system::error_code &ec) {
+            if (ec) return;
+            ADD_FAILURE () << "timed out";
+            client.stop ();
+            io.stop ();
+        });
+
+        bool relayed = false;
+        net::asio::co_spawn (io, [&] () -> awaitable<void> {
+            try {
+                relayed = co_await relay (acceptor, o.Magic, tx);
+            } catch (const std::exception &x) {
+                ADD_FAILURE () << "stand-in node failed: " << x.what ();
+            }
+
+            client.stop ();
+            timeout.cancel ();
+        }, net::asio::detached);
+
+        net::asio::co_spawn (io, client.run (), net::asio::detached);
+
+        io.run ();
+
+        EXPECT_TRUE (relayed);
+        EXPECT_NE (db.transaction (tx.id ()).Transaction, nullptr);
+
+        // the tx was indexed so that it shows up in the history of its script.
+        auto indexed = db.ScriptIndex.find (Gigamonkey::SHA2_256 (paid.Script));
+        ASSERT_NE (indexed, db.ScriptIndex.end ());
+        EXPECT_EQ (indexed->second.size (), 1);
+        EXPECT_TRUE (db.RedeemIndex.contains (spent));
+
+        // the peer was useful to us.
+        maybe<peer_record> record = peers.peer (address);
+        ASSERT_TRUE (bool (record));
+        EXPECT_TRUE (record->Success);
+        EXPECT_GT (record->FriendshipScore, 0);
+    }
+
+}
@@ -0,0 +1,236 @@
+#include "benchmark.hpp"
+#include <Cosmos/wallet/select.hpp>
+#include <Cosmos/wallet/spend.hpp>
+#include <Cosmos/math/fenwick_tree.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    TEST (Select, FenwickTree) {
+        xorshift r {1};
+        std::uniform_int_distribution<int64> values {0, 100};
+
+        std::vector<int64> x (37);
+        for (int64 &v : x) v = values (r);
+
+        math::fenwick_tree<int64> tree {x};
+        ASSERT_EQ (tree.size (), x.size ());
+
+        for (uint32 round = 0; round < 3; round++) {
+            int64 total = 0;
+            for (size_t i = 0; i <= x.size (); i++) {
+                EXPECT_EQ (tree.prefix (i), total);
+                if (i < x.size ()) total += x[i];
+            }
+
+            for (size_t b = 0; b < x.size (); b += 5)
+                for (size_t e = b; e <= x.size (); e += 3)
+                    EXPECT_EQ (tree.sum (b, e), tree.prefix (e) - tree.prefix (b));
+
+            // find is the inverse of prefix.
+            for (int64 y = 0; y < total; y += 7) {
+                size_t i = tree.find (y);
+                ASSERT_LT (i, x.size ());
+                EXPECT_LE (tree.prefix (i), y);
+                EXPECT_GT (tree.prefix (i + 1), y);
+            }
+
+            EXPECT_EQ (tree.find (total), x.size ());
+
+            // change some elements, including setting some to zero.
+            for (size_t i = round; i < x.size (); i += 4) {
+                int64 next = i % 3 == 0 ? 0 : values (r);
+                tree.add (i, next - x[i]);
+                x[i] = next;
+            }
+        }
+    }
+
+    // outputs with values from a Fibonacci sequence and two groups of input sizes.
+    account test_account (std::vector<Bitcoin::outpoint> &outpoints) {
+        account acc {};
+        int64 values[] {1000, 2000, 3000, 5000, 8000, 13000, 21000, 34000, 55000};
+        for (uint32 i = 0; i < std::size (values); i++) {
+            Bitcoin::TxID txid;
+            txid[0] = byte (i + 1);
+            outpoints.push_back (Bitcoin::outpoint {txid, i});
+            acc = acc.insert (outpoints.back (),
+                redeemable {Bitcoin::output {Bitcoin::satoshi {values[i]}, bytes {}}, {}, i % 2 == 0 ? 107 : 73});
+        }
+
+        return acc;
+    }
+
+    // how drop_down chose outputs to remove before it used Fenwick trees.
+    // It goes through every output on every step.
+    std::set<Bitcoin::outpoint> reference_drop_down (const account &acc, Bitcoin::satoshi value_to_spend,
+        satoshis_per_byte fees, double optimal_outputs_per_spend, double min_change_value, double min_change_fraction,
+        data::random::source &r) {
+
+        std::map<Bitcoin::outpoint, redeemable> result;
+        double spent_value = 0;
+        uint64 inputs_expected_size = 0;
+        for (const auto &[key, value] : acc) {
+            result[key] = value;
+            spent_value += double (value.Prevout.Value);
+            inputs_expected_size += value.expected_input_size ();
+        }
+
+        while (true) {
+            std::vector<std::pair<double, Bitcoin::outpoint>> removable;
+            for (const auto &[key, value] : result) {
+                double output_value = double (value.Prevout.Value);
+                double removed_spent_value = spent_value - output_value;
+                double removed_val_with_fee = double (value_to_spend) +
+                    double (fees) * double (inputs_expected_size - value.expected_input_size ());
+                if (removed_spent_value <= removed_val_with_fee + min_change_value ||
+                    removed_spent_value <= removed_val_with_fee * (min_change_fraction + 1)) continue;
+                double optimal_value_per_output = removed_val_with_fee / optimal_outputs_per_spend;
+                removable.push_back ({output_value > optimal_value_per_output ?
+                    output_value / optimal_value_per_output :
+                    optimal_value_per_output / output_value, key});
+            }
+
+            if (removable.empty ()) break;
+
+            double total = 0;
+            for (const auto &[weight, _] : removable) total += weight;
+            double x = std::uniform_real_distribution<double> {0, total} (r);
+            auto it = removable.begin ();
+            while (it + 1 != removable.end () && x >= it->first) {
+                x -= it->first;
+                it++;
+            }
+
+            const redeemable &removed = result[it->second];
+            spent_value -= double (removed.Prevout.Value);
+            inputs_expected_size -= removed.expected_input_size ();
+            result.erase (it->second);
+        }
+
+        std::set<Bitcoin::outpoint> selected;
+        for (const auto &[key, _] : result) selected.insert (key);
+        return selected;
+    }
+
+    // the Fenwick trees must not change how likely each output is to be selected.
+    TEST (Select, DropDownDistribution) {
+        std::vector<Bitcoin::outpoint> outpoints;
+        account acc = test_account (outpoints);
+
+        Bitcoin::satoshi value_to_spend {30000};
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 1000};
+        select_down sel {3, Bitcoin::satoshi {1000}, .1, .1};
+
+        constexpr uint32 trials = 20000;
+        std::map<Bitcoin::outpoint, uint32> count_new;
+        std::map<Bitcoin::outpoint, uint32> count_reference;
+
+        xorshift r {0x2545f4914f6cdd1d};
+        for (uint32 i = 0; i < trials; i++) {
+            for (const auto &[key, _] : sel (acc, value_to_spend, fees, r)) count_new[key]++;
+            for (const auto &key : reference_drop_down (acc, value_to_spend, fees, 3, 1000, .1, r)) count_reference[key]++;
+        }
+
+        for (const auto &op : outpoints)
+            EXPECT_NEAR (double (count_new[op]) / trials, double (count_reference[op]) / trials, .02) << "output " << op;
+    }
+
+    TEST (Select, UpBiggest) {
+        std::vector<Bitcoin::outpoint> outpoints;
+        account acc = test_account (outpoints);
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 1000};
+        xorshift r {3};
+
+        // the two biggest outputs are enough and the biggest alone is not.
+        selected x = select_up_biggest {Bitcoin::satoshi {1000}, .1, .1} (acc, Bitcoin::satoshi {60000}, fees, r);
+        std::set<Bitcoin::outpoint> got;
+        for (const auto &[key, _] : x) got.insert (key);
+        EXPECT_EQ (got, (std::set<Bitcoin::outpoint> {outpoints[7], outpoints[8]}));
+
+        EXPECT_THROW (select_up_biggest {Bitcoin::satoshi {1000}, .1, .1} (acc, Bitcoin::satoshi {200000}, fees, r), data::exception);
+    }
+
+    TEST (Select, UpRandom) {
+        std::vector<Bitcoin::outpoint> outpoints;
+        account acc = test_account (outpoints);
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 1000};
+        xorshift r {5};
+
+        // every output is taken at most once and there is always enough.
+        std::map<Bitcoin::outpoint, uint32> count;
+        for (uint32 i = 0; i < 1000; i++) {
+            selected x = select_up_random {Bitcoin::satoshi {1000}, .1, .1} (acc, Bitcoin::satoshi {40000}, fees, r);
+            std::set<Bitcoin::outpoint> got;
+            int64 total = 0;
+            for (const auto &[key, value] : x) {
+                EXPECT_TRUE (got.insert (key).second);
+                ASSERT_TRUE (bool (acc.contains (key)));
+                total += int64 (value.Prevout.Value);
+                count[key]++;
+            }
+
+            EXPECT_GE (total, 40000);
+        }
+
+        // and every output can be chosen.
+        for (const auto &op : outpoints) EXPECT_GT (count[op], 0) << "output " << op;
+    }
+
+    TEST (Select, Changeless) {
+        std::vector<Bitcoin::outpoint> outpoints;
+        account acc = test_account (outpoints);
+        satoshis_per_byte no_fees {Bitcoin::satoshi {0}, 1000};
+        xorshift r {7};
+
+        // with no fee and no waste, the outputs must add up exactly.
+        select_changeless exact {Bitcoin::satoshi {0}, select_down {3, Bitcoin::satoshi {1000}, .1, .1}, 0};
+        for (int64 value : {16000, 1000, 40000, 142000}) {
+            maybe<selected> x = exact.search (acc, Bitcoin::satoshi {value}, no_fees, r);
+            ASSERT_TRUE (bool (x)) << "value " << value;
+            int64 total = 0;
+            for (const auto &[_, re] : *x) total += int64 (re.Prevout.Value);
+            EXPECT_EQ (total, value);
+        }
+
+        // too small or too big.
+        EXPECT_FALSE (bool (exact.search (acc, Bitcoin::satoshi {500}, no_fees, r)));
+        EXPECT_FALSE (bool (exact.search (acc, Bitcoin::satoshi {200000}, no_fees, r)));
+
+        // the default overhead is that of a tx with one pay to address output.
+        EXPECT_EQ (select_changeless {}.OverheadSize, 44);
+    }
+
+    // spend looks for value_to_spend itself rather than redeeming extra.
+    TEST (Select, SpendChangeless) {
+        std::vector<Bitcoin::outpoint> outpoints;
+        account acc = test_account (outpoints);
+        satoshis_per_byte no_fees {Bitcoin::satoshi {0}, 1000};
+        xorshift r {11};
+
+        redeem red = [] (const Bitcoin::output &, list<nosig::sigop>, const bytes &) -> nosig::script {
+            return {};
+        };
+
+        make_change no_change = [] (const tx_size &design, satoshis_per_byte, key_source, data::random::source &) -> change {
+            ADD_FAILURE () << "change should not have been made";
+            return change {{}, 0, design};
+        };
+
+        spend spender {select_down {3, Bitcoin::satoshi {1000}, .1, .1}, no_change, r};
+        spender.Changeless = select_changeless {Bitcoin::satoshi {0}, select_down {3, Bitcoin::satoshi {1000}, .1, .1}};
+
+        Bitcoin::output to {Bitcoin::satoshi {16000}, bytes {}};
+        spend::spent x = spender (red, acc, key_source {}, list<Bitcoin::output> {to}, no_fees);
+
+        ASSERT_EQ (x.Transactions.size (), 1);
+        const spend::tx &tx = x.Transactions[0];
+        EXPECT_EQ (tx.Transaction.Outputs.size (), 1);
+        EXPECT_TRUE (data::empty (tx.Insert));
+
+        int64 total = 0;
+        for (const auto &[_, op] : tx.Remove) total += int64 (acc.contains (op)->Prevout.Value);
+        EXPECT_EQ (total, 16000);
+    }
+
+}
@@ -0,0 +1,31 @@
+#include "benchmark.hpp"
+#include <Cosmos/wallet/select.hpp>
+
+void benchmark (const char *name, select sel, data::random::source &r) {
+    std::cout << name << std::endl;
+    for (uint32 outputs : {1000, 10000, 100000}) {
+        account acc = random_account (outputs, r);
+        Bitcoin::satoshi value = acc.value () / 3;
+
+        constexpr int rounds = 5;
+        size_t selected = 0;
+        int64 us = microseconds ([&] () {
+            for (int i = 0; i < rounds; i++) selected += data::size (sel (acc, value, satoshis_per_byte {Bitcoin::satoshi {1}, 10}, r));
+        });
+
+        std::cout << "  " << outputs << " outputs: " << us / rounds << " us per selection, " <<
+            double (selected) / rounds << " outputs selected" << std::endl;
+    }
+}
+
+int main (int arg_count, char **arg_values) {
+    xorshift r {0x2545f4914f6cdd1d};
+
+    benchmark ("select_down", select_down {5, Bitcoin::satoshi {1000}, .1, .5}, r);
+    benchmark ("select_up_biggest", select_up_biggest {Bitcoin::satoshi {1000}, .1, .5}, r);
+    benchmark ("select_up_random", select_up_random {Bitcoin::satoshi {1000}, .1, .5}, r);
+    benchmark ("select_up_and_down", select_up_and_down {5, Bitcoin::satoshi {1000}, .1, .5}, r);
+    benchmark ("select_changeless", select_changeless {Bitcoin::satoshi {500}, select_down {5, Bitcoin::satoshi {1000}, .1, .5}}, r);
+
+    return 0;
+}
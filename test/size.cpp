@@ -0,0 +1,66 @@
+#include <Cosmos/wallet/size.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    TEST (Size, CountSize) {
+        EXPECT_EQ (tx_size::count_size (0), 1);
+        EXPECT_EQ (tx_size::count_size (0xfc), 1);
+        EXPECT_EQ (tx_size::count_size (0xfd), 3);
+        EXPECT_EQ (tx_size::count_size (0xffff), 3);
+        EXPECT_EQ (tx_size::count_size (0x10000), 5);
+        EXPECT_EQ (tx_size::count_size (0xffffffff), 5);
+        EXPECT_EQ (tx_size::count_size (0x100000000), 9);
+
+        EXPECT_EQ (tx_size::pay_to_address_size (1, 1), 44);
+        EXPECT_EQ (tx_size::pay_to_address_size (2, 0xfd), 80);
+        EXPECT_EQ (tx_size {}.size (), 10);
+    }
+
+    TEST (Size, Fee) {
+        tx_size design {};
+        design.add_input (Bitcoin::satoshi {1000}, 148);
+        design.add_output (Bitcoin::satoshi {900}, tx_size::PayToAddressOutputSize);
+
+        EXPECT_EQ (design.size (), 192);
+        EXPECT_EQ (int64 (design.fee ()), 100);
+
+        // the required fee is rounded up.
+        EXPECT_EQ (int64 (design.required_fee (satoshis_per_byte {Bitcoin::satoshi {1}, 1})), 192);
+        EXPECT_EQ (int64 (design.required_fee (satoshis_per_byte {Bitcoin::satoshi {1}, 3})), 64);
+        EXPECT_EQ (int64 (design.required_fee (satoshis_per_byte {Bitcoin::satoshi {1}, 5})), 39);
+        EXPECT_EQ (int64 (design.required_fee (satoshis_per_byte {Bitcoin::satoshi {1}, 1000})), 1);
+        EXPECT_EQ (int64 (design.required_fee (satoshis_per_byte {Bitcoin::satoshi {0}, 1000})), 0);
+
+        EXPECT_EQ (int64 (design.excess (satoshis_per_byte {Bitcoin::satoshi {1}, 1000})), 99);
+        EXPECT_EQ (int64 (design.excess (satoshis_per_byte {Bitcoin::satoshi {1}, 1})), -92);
+
+        // an output or input is the same as adding it and taking the difference in the required fee.
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 5};
+        EXPECT_EQ (int64 (design.output_fee (34, fees)), 7);
+        EXPECT_EQ (int64 (design.input_fee (148, fees)), 29);
+
+        tx_size with_input = design;
+        with_input.add_input (Bitcoin::satoshi {500}, 148);
+        EXPECT_EQ (int64 (with_input.required_fee (fees) - design.required_fee (fees)), int64 (design.input_fee (148, fees)));
+
+        // removing an input undoes adding it.
+        with_input.remove_input (Bitcoin::satoshi {500}, 148);
+        EXPECT_EQ (with_input.Inputs, design.Inputs);
+        EXPECT_EQ (with_input.InputsSize, design.InputsSize);
+        EXPECT_EQ (int64 (with_input.Spent), int64 (design.Spent));
+    }
+
+    TEST (Size, CountGrowth) {
+        tx_size design {};
+        for (int i = 0; i < 0xfc; i++) design.add_output (Bitcoin::satoshi {1}, tx_size::PayToAddressOutputSize);
+
+        // the next output makes the number of outputs take two more bytes.
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 1};
+        EXPECT_EQ (int64 (design.output_fee (tx_size::PayToAddressOutputSize, fees)), 36);
+
+        design.add_output (Bitcoin::satoshi {1}, tx_size::PayToAddressOutputSize);
+        EXPECT_EQ (int64 (design.output_fee (tx_size::PayToAddressOutputSize, fees)), 34);
+    }
+
+}
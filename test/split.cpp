@@ -0,0 +1,105 @@
+#include "benchmark.hpp"
+#include <Cosmos/wallet/split.hpp>
+#include <Cosmos/Diophant.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    namespace {
+        key_source split_keys () {
+            return key_source {0, key_sequence {
+                key_expression {HD::BIP_32::secret::from_seed (bytes (32, 2))},
+                key_derivation {"@ key index -> key / index"}}};
+        }
+
+        nosig::script no_redeem (const Bitcoin::output &, list<nosig::sigop>, const bytes &) {
+            return {};
+        }
+
+        split::group split_group (byte n, int64 value) {
+            Bitcoin::TxID txid;
+            txid[0] = n;
+            bytes script {n};
+            return split::group {Gigamonkey::SHA2_256 (script), {entry<Bitcoin::outpoint, redeemable> {
+                Bitcoin::outpoint {txid, 0}, redeemable {Bitcoin::output {Bitcoin::satoshi {value}, script}, {}, 107}}}};
+        }
+    }
+
+    // a group too big for one tx is split with a tree and a small one with one tx.
+    TEST (Split, Tree) {
+        diophant::initialize (nullptr);
+
+        list<split::group> groups {split_group (1, 200000), split_group (2, 8000)};
+        account acc {};
+        for (const split::group &g : groups) for (const auto &[op, re] : g.Outputs) acc = acc.insert (op, re);
+
+        split sp {Bitcoin::satoshi {1000}, Bitcoin::satoshi {5000}, 2000.};
+        satoshis_per_byte fees {Bitcoin::satoshi {1}, 10};
+        bytes seed (32, 7);
+
+        split::tree_options o {};
+        o.MaxOutputsPerTx = 8;
+        o.MaxSatsPerTx = Bitcoin::satoshi {10000};
+        o.Threads = 2;
+
+        split::groups_result x = sp.split_groups (no_redeem, groups, split_keys (), seed, fees, o);
+
+        uint32 count = data::size (x.Transactions);
+        ASSERT_GT (count, 2);
+        ASSERT_EQ (x.Parents.size (), count);
+
+        // the root of the tree and the tx of the small group spend outputs of the wallet.
+        EXPECT_FALSE (bool (x.Parents[0]));
+        EXPECT_FALSE (bool (x.Parents[count - 1]));
+
+        std::set<std::pair<uint32, Bitcoin::index>> spent;
+        for (uint32 i = 1; i + 1 < count; i++) {
+            ASSERT_TRUE (bool (x.Parents[i]));
+            // parents come first.
+            EXPECT_LT (x.Parents[i]->first, i);
+            EXPECT_TRUE (spent.insert (*x.Parents[i]).second);
+        }
+
+        uint32 outputs = 0;
+        for (uint32 i = 0; i < count; i++) {
+            const spend::tx &t = x.Transactions[i];
+            tx_size built = t.Transaction.size ();
+            EXPECT_GE (built.excess (fees), 0);
+            EXPECT_LE (built.Outputs, o.MaxOutputsPerTx);
+            outputs += built.Outputs;
+
+            // the leaves of the tree hold no more than MaxSatsPerTx.
+            bool leaf = true;
+            for (uint32 j = 0; j < built.Outputs; j++) if (spent.contains ({i, j})) leaf = false;
+            if (leaf) EXPECT_LE (built.Sent, *o.MaxSatsPerTx);
+        }
+
+        // every output has its own key.
+        EXPECT_EQ (x.Last, outputs);
+
+        // the same seed gives the same split.
+        split::groups_result y = sp.split_groups (no_redeem, groups, split_keys (), seed, fees, o);
+        ASSERT_EQ (data::size (y.Transactions), count);
+        for (uint32 i = 0; i < count; i++)
+            EXPECT_EQ (x.Transactions[i].Transaction.Outputs, y.Transactions[i].Transaction.Outputs);
+
+        // the txids would come from signing.
+        account::builder next {acc};
+        int64 fee = 0;
+        for (uint32 i = 0; i < count; i++) {
+            fee += int64 (x.Transactions[i].Transaction.size ().fee ());
+
+            Bitcoin::TxID txid;
+            txid[0] = 0xff;
+            txid[1] = byte (i);
+
+            // outputs spent within the tree are removed again, so this only works if they were linked.
+            EXPECT_NO_THROW (next <<= x.complete (i, txid));
+        }
+
+        account after = next.freeze ();
+        EXPECT_EQ (int64 (acc.value ()) - int64 (after.value ()), fee);
+        EXPECT_EQ (after.count (), outputs - spent.size ());
+    }
+
+}
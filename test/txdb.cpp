@@ -0,0 +1,82 @@
+#include <Cosmos/database/memory/database.hpp>
+#include <Cosmos/database/SQLite/SQLite.hpp>
+#include <Cosmos/serialize.hpp>
+#include "gtest/gtest.h"
+
+namespace Cosmos {
+
+    namespace {
+        using namespace serialize;
+
+        Bitcoin::transaction mined_tx (byte n) {
+            Bitcoin::TxID prev;
+            prev[0] = n;
+            return Bitcoin::transaction {1,
+                list<Bitcoin::input> {Bitcoin::input {Bitcoin::outpoint {prev, 0}, bytes {}}},
+                list<Bitcoin::output> {Bitcoin::output {Bitcoin::satoshi {1000 + n}, bytes {}}}, 0};
+        }
+
+        Bitcoin::header block_with_root (const digest256 &root) {
+            bytes raw;
+            write_uint (raw, 1, 4);
+            write_bytes (raw, data::byte_slice (digest256 {}));
+            write_bytes (raw, data::byte_slice (root));
+            write_uint (raw, 1700000000, 4);
+            write_uint (raw, 0x1d00ffff, 4);
+            write_uint (raw, 0, 4);
+            return Bitcoin::header {data::slice<data::byte, 80> {raw.data ()}};
+        }
+
+        // two good proofs in a block go in even though they come with bad ones.
+        void test_insert_proofs (local_TXDB &db) {
+            Bitcoin::transaction a = mined_tx (1);
+            Bitcoin::transaction b = mined_tx (2);
+            Bitcoin::transaction c = mined_tx (3);
+            Bitcoin::transaction d = mined_tx (4);
+            for (const auto &tx : {a, b, c, d}) db.insert (tx);
+
+            Bitcoin::TxID id_a = a.id ();
+            Bitcoin::TxID id_b = b.id ();
+            Bitcoin::TxID id_c = c.id ();
+            Bitcoin::TxID id_d = d.id ();
+
+            // a and b are the two txs in a block that we have the header of.
+            Merkle::branch branch_a {id_a, Merkle::path {0, Merkle::digests {id_b}}};
+            Merkle::branch branch_b {id_b, Merkle::path {1, Merkle::digests {id_a}}};
+            digest256 root = branch_a.root ();
+            db.insert (N {1}, block_with_root (root));
+
+            std::vector<Merkle::proof> proofs {
+                Merkle::proof {branch_a, root},
+                // c claims to be in the same block but its path doesn't lead there.
+                Merkle::proof {Merkle::branch {id_c, Merkle::path {0, Merkle::digests {id_b}}}, root},
+                Merkle::proof {branch_b, root},
+                // d is alone in a block that we don't know about.
+                Merkle::proof {Merkle::branch {id_d, Merkle::path {0, Merkle::digests {}}}, id_d}};
+
+            list<Bitcoin::TxID> rejected = db.insert_proofs (proofs);
+            std::set<Bitcoin::TxID> rejected_set (rejected.begin (), rejected.end ());
+
+            EXPECT_EQ (rejected.size (), 2);
+            EXPECT_TRUE (rejected_set.contains (id_c));
+            EXPECT_TRUE (rejected_set.contains (id_d));
+
+            EXPECT_TRUE (db.transaction (id_a).confirmed ());
+            EXPECT_TRUE (db.transaction (id_b).confirmed ());
+            EXPECT_FALSE (db.transaction (id_c).confirmed ());
+            EXPECT_FALSE (db.transaction (id_d).confirmed ());
+        }
+    }
+
+    TEST (TXDB, InsertProofsMemory) {
+        memory_local_TXDB db {};
+        test_insert_proofs (db);
+    }
+
+    TEST (TXDB, InsertProofsSQLite) {
+        ptr<controller> db = SQLite::load ({});
+        ASSERT_NE (db, nullptr);
+        test_insert_proofs (*db);
+    }
+
+}